@@ -0,0 +1,177 @@
+#pragma once
+
+/// Нативная замена Arduino-ESP32
+/// Время виртуальное (hal::Clock), периферия эмулируется в пространстве имён hal
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Print.h"
+#include "esp32-hal-timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "hal/Adc.hpp"
+#include "hal/Clock.hpp"
+#include "hal/Gpio.hpp"
+#include "hal/Ledc.hpp"
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#if not defined(M_TWOPI)
+#define M_TWOPI (M_PI * 2.0)
+#endif
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define digitalPinToInterrupt(p) (p)
+
+enum gpio_num_t {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7,
+    GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15,
+    GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23,
+    GPIO_NUM_25 = 25, GPIO_NUM_26, GPIO_NUM_27,
+    GPIO_NUM_32 = 32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39,
+};
+
+inline unsigned long micros() { return static_cast<unsigned long>(hal::Clock::now()); }
+
+inline unsigned long millis() { return static_cast<unsigned long>(hal::Clock::now() / 1000); }
+
+inline void delayMicroseconds(uint32_t us) { hal::Clock::advance(us); }
+
+inline void delay(uint32_t ms) { hal::Rtos::delay(static_cast<uint64_t>(ms) * 1000); }
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline void attachInterruptArg(uint8_t pin, hal::Gpio::Isr isr, void *arg, int mode) {
+    if (pin >= hal::Gpio::pins_total) { return; }
+    hal::Gpio::handlers[pin] = {isr, arg, mode};
+}
+
+inline void detachInterrupt(uint8_t pin) {
+    if (pin >= hal::Gpio::pins_total) { return; }
+    hal::Gpio::handlers[pin] = {};
+}
+
+enum adc_attenuation_t {
+    ADC_0db,
+    ADC_2_5db,
+    ADC_6db,
+    ADC_11db,
+};
+
+inline void analogSetPinAttenuation(uint8_t, adc_attenuation_t) {}
+
+inline uint32_t analogReadMilliVolts(uint8_t pin) {
+    if (pin >= hal::Adc::pins_total) { return 0; }
+    hal::Adc::reads += 1;
+    return hal::Adc::millivolts[pin];
+}
+
+inline uint32_t ledcSetup(uint8_t channel, uint32_t frequency, uint8_t resolution_bits) {
+    if (channel >= hal::Ledc::channels_total) { return 0; }
+    auto &c = hal::Ledc::channels[channel];
+    c.frequency = frequency;
+    c.resolution_bits = resolution_bits;
+    return frequency;
+}
+
+inline void ledcAttachPin(uint8_t pin, uint8_t channel) {
+    if (pin >= hal::Ledc::pins_total or channel >= hal::Ledc::channels_total) { return; }
+    hal::Ledc::pin_channel[pin] = static_cast<int8_t>(channel);
+}
+
+inline void ledcWrite(uint8_t channel, uint32_t duty) {
+    if (channel >= hal::Ledc::channels_total) { return; }
+    auto &c = hal::Ledc::channels[channel];
+    c.duty = duty;
+    c.writes += 1;
+}
+
+struct HardwareSerial final : Print {
+
+    /// Отключить вывод (например, при профилировании)
+    bool muted{false};
+
+    /// Принимаемые байты (NativeMain: --serial-input), читаются по одному
+    std::string input{};
+    size_t input_position{0};
+
+    void begin(unsigned long) {}
+
+    int available() const { return static_cast<int>(input.size() - input_position); }
+
+    int read() {
+        if (available() <= 0) { return -1; }
+        return static_cast<uint8_t>(input[input_position++]);
+    }
+
+    size_t write(uint8_t c) override {
+        if (muted) { return 1; }
+        return std::fputc(c, stdout) == EOF ? 0 : 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        if (muted) { return size; }
+        return std::fwrite(buffer, 1, size, stdout);
+    }
+
+    using Print::write;
+};
+
+inline HardwareSerial Serial{};
+
+struct EspClass final {
+
+    /// Частота эмулируемого ядра
+    /// МГц
+    static constexpr uint32_t cpu_freq_mhz = 240;
+
+    /// Счётчик тактов по реальному времени процесса: математика занимает реальное время, а не виртуальное
+    uint32_t getCycleCount() const {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        return static_cast<uint32_t>(static_cast<uint64_t>(ns) * cpu_freq_mhz / 1000);
+    }
+
+    uint32_t getCpuFreqMHz() const { return cpu_freq_mhz; }
+
+    [[noreturn]] void restart() {
+        std::fprintf(stderr, "[native] ESP.restart() at %llu us\n", static_cast<unsigned long long>(hal::Clock::now()));
+        std::exit(EXIT_FAILURE);
+    }
+};
+
+inline EspClass ESP{};
+
+void setup();
+
+void loop();
@@ -0,0 +1,302 @@
+#pragma once
+
+/// Нативная замена SparkFun ICM_20948_SPI
+/// Показания берутся из hal::Imu::source, каждая SPI транзакция тратит виртуальное время
+
+#include <cmath>
+#include <cstdint>
+#include <deque>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "hal/Clock.hpp"
+#include "hal/Gpio.hpp"
+#include "hal/Imu.hpp"
+
+enum ICM_20948_Status_e {
+    ICM_20948_Stat_Ok = 0x00,
+    ICM_20948_Stat_Err,
+    ICM_20948_Stat_NotImpl,
+    ICM_20948_Stat_ParamErr,
+    ICM_20948_Stat_WrongID,
+    ICM_20948_Stat_InvalSensor,
+    ICM_20948_Stat_NoData,
+    ICM_20948_Stat_SensorNotSupported,
+};
+
+enum ICM_20948_InternalSensorID_bm {
+    ICM_20948_Internal_Acc = (1 << 0),
+    ICM_20948_Internal_Gyr = (1 << 1),
+    ICM_20948_Internal_Mag = (1 << 2),
+    ICM_20948_Internal_Tmp = (1 << 3),
+    ICM_20948_Internal_Mst = (1 << 4),
+};
+
+enum ICM_20948_ACCEL_CONFIG_FS_SEL_e {
+    gpm2 = 0x00,
+    gpm4,
+    gpm8,
+    gpm16,
+};
+
+enum ICM_20948_GYRO_CONFIG_1_FS_SEL_e {
+    dps250 = 0x00,
+    dps500,
+    dps1000,
+    dps2000,
+};
+
+struct ICM_20948_fss_t {
+    uint8_t a: 2;
+    uint8_t g: 2;
+    uint8_t reserved_0: 4;
+};
+
+struct ICM_20948_smplrt_t {
+    uint16_t g;
+    uint16_t a;
+};
+
+class ICM_20948_SPI {
+
+    /// Базовая частота выборки при включённом DLPF
+    /// Гц
+    static constexpr uint32_t dlpf_base_rate = 1125;
+
+    /// Частота выборки гироскопа без DLPF
+    /// Гц
+    static constexpr uint32_t gyro_bypass_rate = 9000;
+
+    bool gyro_dlpf{false};
+    uint16_t gyro_divider{0};
+    uint64_t last_read_tick{UINT64_MAX};
+    hal::Imu::Sample sample{};
+
+    bool interrupt_enabled{false};
+    bool interrupt_latch{false};
+    bool interrupt_pending{false};
+    int tick_timer{-1};
+
+    /// Регистры банка 0, используемые FIFO
+    static constexpr uint8_t reg_user_ctrl = 0x03;
+    static constexpr uint8_t reg_fifo_en_2 = 0x67;
+    static constexpr uint8_t reg_fifo_rst = 0x68;
+    static constexpr uint8_t reg_fifo_count_h = 0x70;
+    static constexpr uint8_t reg_fifo_r_w = 0x72;
+
+    static constexpr size_t fifo_capacity = 512;
+    static constexpr uint8_t fifo_accel_gyro = 0x1E;
+
+    uint8_t bank{0};
+    uint8_t user_ctrl{0};
+    uint8_t fifo_en_2{0};
+    std::deque<uint8_t> fifo{};
+
+public:
+
+    ICM_20948_Status_e status{ICM_20948_Stat_Ok};
+
+    ICM_20948_Status_e begin(uint8_t, SPIClass &, uint32_t frequency = 7000000) {
+        hal::Imu::spi_frequency = frequency;
+        status = ICM_20948_Stat_Ok;
+        restartTicks();
+        return status;
+    }
+
+    ICM_20948_Status_e setFullScale(uint8_t, ICM_20948_fss_t) { return transfer(2); }
+
+    ICM_20948_Status_e enableDLPF(uint8_t sensors, bool enable) {
+        if (sensors & ICM_20948_Internal_Gyr) {
+            gyro_dlpf = enable;
+            restartTicks();
+        }
+        return transfer(2);
+    }
+
+    ICM_20948_Status_e setSampleRate(uint8_t sensors, ICM_20948_smplrt_t rate) {
+        if (sensors & ICM_20948_Internal_Gyr) {
+            gyro_divider = rate.g;
+            restartTicks();
+        }
+        return transfer(2);
+    }
+
+    /// Период выборки эмулируемого датчика
+    /// Мкс
+    uint64_t samplePeriod() const {
+        const uint32_t rate = gyro_dlpf ? dlpf_base_rate / (1 + gyro_divider) : gyro_bypass_rate;
+        return 1000000 / rate;
+    }
+
+    ICM_20948_Status_e cfgIntActiveLow(bool) { return transfer(2); }
+
+    ICM_20948_Status_e cfgIntOpenDrain(bool) { return transfer(2); }
+
+    ICM_20948_Status_e cfgIntLatch(bool latching) {
+        interrupt_latch = latching;
+        return transfer(2);
+    }
+
+    ICM_20948_Status_e cfgIntAnyReadToClear(bool) { return transfer(2); }
+
+    /// Включает RAW_DATA_0_RDY на выводе INT: фронт на hal::Imu::interrupt_pin на каждый отсчёт
+    ICM_20948_Status_e intEnableRawDataReady(bool enable) {
+        interrupt_enabled = enable;
+        return transfer(2);
+    }
+
+    ICM_20948_Status_e setBank(uint8_t value) {
+        if (bank == value) { return ICM_20948_Stat_Ok; }
+        bank = value;
+        return transfer(1);
+    }
+
+    /// Запись регистров: эмулируется только управление FIFO
+    ICM_20948_Status_e write(uint8_t reg, uint8_t *data, uint32_t len) {
+        if (bank == 0 and len > 0) {
+            switch (reg) {
+                case reg_user_ctrl:
+                    user_ctrl = data[0];
+                    break;
+
+                case reg_fifo_en_2:
+                    fifo_en_2 = data[0];
+                    break;
+
+                case reg_fifo_rst:
+                    if (data[0] != 0) { fifo.clear(); }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        return transfer(1 + len);
+    }
+
+    /// Чтение регистров: эмулируются FIFO_COUNT и FIFO_R_W
+    ICM_20948_Status_e read(uint8_t reg, uint8_t *data, uint32_t len) {
+        transfer(1 + len);
+
+        if (bank != 0) { return ICM_20948_Stat_NotImpl; }
+
+        switch (reg) {
+            case reg_user_ctrl:
+                if (len >= 1) { data[0] = user_ctrl; }
+                return ICM_20948_Stat_Ok;
+
+            case reg_fifo_count_h:
+                if (len >= 2) {
+                    data[0] = static_cast<uint8_t>(fifo.size() >> 8);
+                    data[1] = static_cast<uint8_t>(fifo.size());
+                }
+                interrupt_pending = false;
+                return ICM_20948_Stat_Ok;
+
+            case reg_fifo_r_w:
+                for (uint32_t i = 0; i < len; i++) {
+                    if (fifo.empty()) {
+                        data[i] = 0xFF;
+                        continue;
+                    }
+                    data[i] = fifo.front();
+                    fifo.pop_front();
+                }
+                hal::Imu::stats.samples_read += len / frame_size;
+                return ICM_20948_Stat_Ok;
+
+            default:
+                return ICM_20948_Stat_NotImpl;
+        }
+    }
+
+    bool dataReady() {
+        transfer(1);
+        return currentTick() != last_read_tick;
+    }
+
+    ICM_20948_Status_e getAGMT() {
+        transfer(23);
+
+        const auto tick = currentTick();
+
+        if (last_read_tick != UINT64_MAX and tick > last_read_tick + 1) {
+            hal::Imu::stats.samples_missed += static_cast<uint32_t>(tick - last_read_tick - 1);
+        }
+
+        last_read_tick = tick;
+        interrupt_pending = false;
+        sample = hal::Imu::source(tick * samplePeriod());
+        hal::Imu::stats.samples_read += 1;
+        return ICM_20948_Stat_Ok;
+    }
+
+    float accX() const { return sample.acc[0]; }
+
+    float accY() const { return sample.acc[1]; }
+
+    float accZ() const { return sample.acc[2]; }
+
+    float gyrX() const { return sample.gyr[0]; }
+
+    float gyrY() const { return sample.gyr[1]; }
+
+    float gyrZ() const { return sample.gyr[2]; }
+
+private:
+
+    /// Кадр FIFO: ACCEL_XOUT_H .. GYRO_ZOUT_L, big-endian
+    static constexpr size_t frame_size = 12;
+
+    void restartTicks() {
+        hal::Clock::cancel(tick_timer);
+
+        const auto period = samplePeriod();
+        tick_timer = hal::Clock::schedule((currentTick() + 1) * period, period, [](void *context) {
+            static_cast<ICM_20948_SPI *>(context)->onSampleTick();
+        }, this);
+    }
+
+    static void pushWord(std::deque<uint8_t> &fifo, float value) {
+        const auto raw = static_cast<int16_t>(std::lround(std::fmax(-32768.0f, std::fmin(32767.0f, value))));
+        fifo.push_back(static_cast<uint8_t>(static_cast<uint16_t>(raw) >> 8));
+        fifo.push_back(static_cast<uint8_t>(raw));
+    }
+
+    void pushFifoFrame() {
+        if (fifo.size() + frame_size > fifo_capacity) {
+            hal::Imu::stats.samples_missed += 1;
+            return;
+        }
+
+        const auto s = hal::Imu::source(hal::Clock::now());
+
+        // ±2 G: 16384 LSB / G; ±2000 dps: 16.4 LSB / dps
+        for (const float a: s.acc) { pushWord(fifo, a * 16.384f); }
+        for (const float g: s.gyr) { pushWord(fifo, g * 16.4f); }
+    }
+
+    void onSampleTick() {
+        if ((user_ctrl & 0x40) and (fifo_en_2 & fifo_accel_gyro) == fifo_accel_gyro) {
+            pushFifoFrame();
+        }
+
+        if (not interrupt_enabled) { return; }
+
+        if (interrupt_latch and interrupt_pending) { return; }
+
+        interrupt_pending = true;
+        hal::Imu::stats.interrupts += 1;
+        hal::Gpio::trigger(hal::Imu::interrupt_pin);
+    }
+
+    uint64_t currentTick() const { return hal::Clock::now() / samplePeriod(); }
+
+    static ICM_20948_Status_e transfer(uint32_t bytes) {
+        hal::Imu::stats.spi_transactions += 1;
+        hal::Imu::stats.spi_bytes += bytes;
+        hal::Clock::advance(hal::Imu::transactionCost(bytes));
+        return ICM_20948_Stat_Ok;
+    }
+};
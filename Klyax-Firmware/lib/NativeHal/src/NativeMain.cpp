@@ -0,0 +1,134 @@
+/// Точка входа нативной сборки: setup() и loop() прошивки в процессе Linux
+/// Как в Arduino-ESP32, setup() и loop() выполняются задачей loopTask (ядро 1, приоритет 1),
+/// созданные прошивкой задачи выполняет кооперативный планировщик hal::Rtos
+/// Свои аргументы и отчёты прошивка и SITL добавляют через hal::Native (src/sitl/Runner.cpp)
+///
+/// Аргументы:
+///   --duration <s>  Виртуальная длительность прогона (по умолчанию 10)
+///   --quiet         Не выводить Serial
+///   --serial-input <path>   Содержимое файла - принятые Serial байты (команды прошивки, например thrust-lut)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Arduino.h"
+#include "freertos/task.h"
+#include "hal/Clock.hpp"
+#include "hal/Native.hpp"
+
+
+namespace {
+
+struct Options {
+    double duration_s{10.0};
+    bool quiet{false};
+    const char *serial_input_path{nullptr};
+};
+
+Options options{};
+
+bool parseOptions(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (std::strcmp(arg, "--duration") == 0 and has_value) {
+            options.duration_s = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--serial-input") == 0 and has_value) {
+            options.serial_input_path = argv[++i];
+        } else if (std::strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        } else if (const hal::Native::Option *option = hal::Native::findOption(arg)) {
+            if (option->has_value and not has_value) {
+                std::fprintf(stderr, "%s: value expected\n", arg);
+                return false;
+            }
+
+            const char *value = option->has_value ? argv[++i] : nullptr;
+
+            if (not option->handler(value)) {
+                std::fprintf(stderr, "%s: invalid value %s\n", arg, value == nullptr ? "" : value);
+                return false;
+            }
+        } else {
+            std::fprintf(stderr, "unknown argument: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readSerialInput(const char *path) {
+    std::FILE *file = std::fopen(path, "rb");
+    if (file == nullptr) {
+        std::fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+
+    char buffer[256];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) { Serial.input.append(buffer, n); }
+    std::fclose(file);
+    return true;
+}
+
+/// Аналог loopTask из Arduino-ESP32
+void loopTask(void *) {
+    setup();
+    hal::Native::afterSetup();
+
+    while (true) {
+        loop();
+        taskYIELD();
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    if (not parseOptions(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+
+    Serial.muted = options.quiet;
+
+    if (options.serial_input_path != nullptr and not readSerialInput(options.serial_input_path)) {
+        return EXIT_FAILURE;
+    }
+
+    if (not hal::Native::start()) {
+        return EXIT_FAILURE;
+    }
+
+    xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, 1);
+
+    const auto start_us = hal::Clock::now();
+    const auto end_us = start_us + static_cast<uint64_t>(options.duration_s * 1e6);
+    const auto wall_start = std::chrono::steady_clock::now();
+
+    hal::Rtos::run(end_us);
+
+    const auto wall_end = std::chrono::steady_clock::now();
+    const double wall_ms = std::chrono::duration<double, std::milli>(wall_end - wall_start).count();
+    const double virtual_s = static_cast<double>(hal::Clock::now() - start_us) * 1e-6;
+
+    std::fprintf(
+        stderr,
+        "[native] %.3f s virtual, %.1f ms wall, x%.0f real time\n",
+        virtual_s, wall_ms, virtual_s * 1e3 / wall_ms
+    );
+
+    for (const auto &task: hal::Rtos::allTasks()) {
+        std::fprintf(
+            stderr,
+            "[native] task %-9s core %d, priority %2u, %llu resumes%s\n",
+            task->name, task->core, task->priority, static_cast<unsigned long long>(task->resumes),
+            task->state == hal::Task::State::Deleted ? " (deleted)" : ""
+        );
+    }
+
+    hal::Native::report();
+
+    return hal::Native::exit_status;
+}
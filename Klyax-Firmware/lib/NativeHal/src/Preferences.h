@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/// Нативная замена Preferences (NVS) с хранением в памяти процесса
+class Preferences final {
+
+    using Namespace = std::map<std::string, std::vector<uint8_t>>;
+
+    static std::map<std::string, Namespace> &storage() {
+        static std::map<std::string, Namespace> instance{};
+        return instance;
+    }
+
+    Namespace *current{nullptr};
+    bool read_only{true};
+
+public:
+
+    bool begin(const char *name, bool read_only_mode = false) {
+        current = &storage()[name];
+        read_only = read_only_mode;
+        return true;
+    }
+
+    void end() { current = nullptr; }
+
+    size_t getBytesLength(const char *key) {
+        if (current == nullptr) { return 0; }
+        const auto it = current->find(key);
+        return it == current->end() ? 0 : it->second.size();
+    }
+
+    size_t getBytes(const char *key, void *buffer, size_t max_len) {
+        if (current == nullptr) { return 0; }
+        const auto it = current->find(key);
+        if (it == current->end() or it->second.size() > max_len) { return 0; }
+        std::memcpy(buffer, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putBytes(const char *key, const void *value, size_t len) {
+        if (current == nullptr or read_only) { return 0; }
+        const auto bytes = static_cast<const uint8_t *>(value);
+        (*current)[key].assign(bytes, bytes + len);
+        return len;
+    }
+
+    bool remove(const char *key) {
+        if (current == nullptr or read_only) { return false; }
+        return current->erase(key) != 0;
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+
+/// Нативная замена Print из Arduino-ESP32
+class Print {
+
+public:
+
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            if (write(*buffer++) == 0) { break; }
+            n += 1;
+        }
+        return n;
+    }
+
+    size_t write(const char *buffer, size_t size) {
+        return write(reinterpret_cast<const uint8_t *>(buffer), size);
+    }
+
+    size_t write(const char *str) {
+        if (str == nullptr) { return 0; }
+        return write(str, std::strlen(str));
+    }
+
+    size_t print(const char *str) { return write(str); }
+
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+
+    size_t print(int value) { return printf("%d", value); }
+
+    size_t print(unsigned int value) { return printf("%u", value); }
+
+    size_t print(long value) { return printf("%ld", value); }
+
+    size_t print(unsigned long value) { return printf("%lu", value); }
+
+    size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+
+        va_list args;
+        va_start(args, format);
+        const int len = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+
+        if (len <= 0) { return 0; }
+
+        const auto size = static_cast<size_t>(len) < sizeof(buffer) ? static_cast<size_t>(len) : sizeof(buffer) - 1;
+        return write(buffer, size);
+    }
+};
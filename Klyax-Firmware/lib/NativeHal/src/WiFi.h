@@ -0,0 +1,13 @@
+#pragma once
+
+
+enum wifi_mode_t {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+};
+
+struct WiFiClass final {
+    static bool mode(wifi_mode_t) { return true; }
+};
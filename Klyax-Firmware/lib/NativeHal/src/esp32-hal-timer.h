@@ -0,0 +1,55 @@
+#pragma once
+
+/// Нативная замена аппаратных таймеров Arduino-ESP32 (API 2.x) поверх hal::Clock
+
+#include <cstdint>
+
+#include "hal/Clock.hpp"
+
+struct hw_timer_t {
+    uint16_t divider;
+    void (*isr)();
+    uint64_t alarm_value;
+    bool autoreload;
+    int clock_timer;
+};
+
+/// Частота тактирования таймеров (APB)
+/// Гц
+#define APB_CLK_FREQ 80000000
+
+inline hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool) {
+    static hw_timer_t timers[4]{};
+    if (num >= 4) { return nullptr; }
+    auto &t = timers[num];
+    t.divider = divider;
+    t.clock_timer = -1;
+    return &t;
+}
+
+inline void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(), bool) { timer->isr = isr; }
+
+inline void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload) {
+    timer->alarm_value = alarm_value;
+    timer->autoreload = autoreload;
+}
+
+inline void timerAlarmDisable(hw_timer_t *timer) {
+    hal::Clock::cancel(timer->clock_timer);
+    timer->clock_timer = -1;
+}
+
+inline void timerAlarmEnable(hw_timer_t *timer) {
+    timerAlarmDisable(timer);
+
+    const uint64_t period_us = timer->alarm_value * timer->divider / (APB_CLK_FREQ / 1000000);
+
+    timer->clock_timer = hal::Clock::schedule(
+        hal::Clock::now() + period_us,
+        timer->autoreload ? period_us : 0,
+        [](void *context) { static_cast<hw_timer_t *>(context)->isr(); },
+        timer
+    );
+}
+
+inline void timerWrite(hw_timer_t *, uint64_t) {}
@@ -0,0 +1,84 @@
+#pragma once
+
+/// Нативная замена esp_partition: единственный раздел данных blackbox в hal::Flash
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "hal/Clock.hpp"
+#include "hal/Flash.hpp"
+
+using esp_err_t = int;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+enum esp_partition_type_t {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+};
+
+enum esp_partition_subtype_t {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+};
+
+struct esp_partition_t {
+    esp_partition_type_t type;
+    uint8_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+};
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) {
+    static const esp_partition_t blackbox{ESP_PARTITION_TYPE_DATA, 0x40, 0x1F0000, hal::Flash::blackbox_size, "blackbox"};
+
+    if (type != ESP_PARTITION_TYPE_DATA) { return nullptr; }
+    if (label != nullptr and std::strcmp(label, blackbox.label) != 0) { return nullptr; }
+    return &blackbox;
+}
+
+inline bool esp_partition_range_valid(const esp_partition_t *partition, size_t offset, size_t size) {
+    return partition != nullptr and offset <= partition->size and size <= partition->size - offset;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size) {
+    if (not esp_partition_range_valid(partition, offset, size)) { return ESP_ERR_INVALID_SIZE; }
+    std::memcpy(dst, hal::Flash::blackbox.data() + offset, size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size) {
+    if (not esp_partition_range_valid(partition, offset, size)) { return ESP_ERR_INVALID_SIZE; }
+
+    const auto *bytes = static_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < size; i++) {
+        hal::Flash::blackbox[offset + i] &= bytes[i];
+    }
+
+    hal::Flash::bytes_written += size;
+
+    // Кэш отключён на время записи: другие задачи (и управляющая на ядре 1) стоят
+    for (size_t page_start = offset; page_start < offset + size;) {
+        const size_t page_end = std::min(offset + size, (page_start / 256 + 1) * 256);
+        hal::Clock::advance(hal::Flash::programCost(static_cast<uint32_t>(page_end - page_start)));
+        page_start = page_end;
+    }
+
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    if (offset % SPI_FLASH_SEC_SIZE != 0 or size % SPI_FLASH_SEC_SIZE != 0) { return ESP_ERR_INVALID_ARG; }
+    if (not esp_partition_range_valid(partition, offset, size)) { return ESP_ERR_INVALID_SIZE; }
+
+    std::memset(hal::Flash::blackbox.data() + offset, 0xFF, size);
+    hal::Flash::sectors_erased += size / SPI_FLASH_SEC_SIZE;
+    return ESP_OK;
+}
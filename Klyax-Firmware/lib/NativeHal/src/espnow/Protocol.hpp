@@ -0,0 +1,96 @@
+#pragma once
+
+/// Нативная замена Fresh-EspNow
+/// Исходящие кадры передаются в hal::EspNow::on_send, входящие доставляет hal::EspNow::deliver
+
+#include <array>
+#include <cstdint>
+
+#include "hal/EspNow.hpp"
+
+
+namespace rs {
+
+using u8 = uint8_t;
+
+template<typename E> struct Result {
+    bool ok;
+    E error;
+
+    bool fail() const { return not ok; }
+};
+
+}
+
+namespace espnow {
+
+using Mac = hal::EspNow::Mac;
+
+enum class Error : uint8_t {
+    None,
+    NotInitialized,
+    PeerListFull,
+    TooLargeMessage,
+};
+
+using Result = rs::Result<Error>;
+
+struct Peer final {
+    static Result add(const Mac &mac) {
+        hal::EspNow::peer = mac;
+        hal::EspNow::has_peer = true;
+        return {true, Error::None};
+    }
+};
+
+struct Protocol final {
+
+    using ReceiveHandler = hal::EspNow::ReceiveHandler;
+
+    static constexpr rs::u8 max_message_size = 250;
+
+    static Protocol &instance() {
+        static Protocol instance{};
+        return instance;
+    }
+
+    static Result init() { return {true, Error::None}; }
+
+    Result setReceiveHandler(ReceiveHandler handler) {
+        hal::EspNow::receive_handler = handler;
+        return {true, Error::None};
+    }
+
+    static Result send(const Mac &mac, const void *data, rs::u8 size) {
+        if (size > max_message_size) { return {false, Error::TooLargeMessage}; }
+        hal::EspNow::sent_frames += 1;
+        if (hal::EspNow::on_send != nullptr) {
+            hal::EspNow::on_send(mac, data, size);
+        }
+        return {true, Error::None};
+    }
+
+    static Result send(const Mac &mac, const void *data, size_t size) {
+        return send(mac, data, static_cast<rs::u8>(size));
+    }
+};
+
+}
+
+namespace rs {
+
+inline const char *toString(espnow::Error error) {
+    switch (error) {
+        case espnow::Error::None:
+            return "None";
+        case espnow::Error::NotInitialized:
+            return "NotInitialized";
+        case espnow::Error::PeerListFull:
+            return "PeerListFull";
+        case espnow::Error::TooLargeMessage:
+            return "TooLargeMessage";
+    }
+    return "Unknown";
+}
+
+}
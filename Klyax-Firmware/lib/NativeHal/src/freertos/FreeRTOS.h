@@ -0,0 +1,23 @@
+#pragma once
+
+/// Нативная замена FreeRTOS: задачи, уведомления и семафоры поверх виртуальных часов (hal::Rtos)
+
+#include <cstdint>
+
+#include "hal/Rtos.hpp"
+
+using BaseType_t = int;
+using UBaseType_t = unsigned int;
+using TickType_t = uint32_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY UINT32_MAX
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms) * configTICK_RATE_HZ / 1000)
+
+#define portYIELD_FROM_ISR(...)
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+using StaticSemaphore_t = hal::Semaphore;
+using SemaphoreHandle_t = hal::Semaphore *;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+    *buffer = {};
+    return buffer;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    return hal::Rtos::take(*semaphore, ticks_to_wait) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    hal::Rtos::give(*semaphore);
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *higher_priority_task_woken) {
+    hal::Rtos::give(*semaphore);
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdTRUE;
+    }
+    return pdTRUE;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+using TaskHandle_t = hal::Task *;
+using TaskFunction_t = void (*)(void *);
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return &hal::Rtos::currentTask(); }
+
+inline BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char *name,
+    uint32_t stack_depth,
+    void *parameter,
+    UBaseType_t priority,
+    TaskHandle_t *created_task,
+    BaseType_t core
+) {
+    const auto task = hal::Rtos::create(function, name, stack_depth, parameter, priority, core);
+    if (created_task != nullptr) {
+        *created_task = task;
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr or task == xTaskGetCurrentTaskHandle()) {
+        hal::Rtos::deleteCurrent();
+        return;
+    }
+    task->state = hal::Task::State::Deleted;
+}
+
+inline void vTaskDelay(TickType_t ticks) { hal::Rtos::delay(static_cast<uint64_t>(ticks) * hal::Rtos::tick_us); }
+
+inline void taskYIELD() { hal::Rtos::yield(); }
+
+inline BaseType_t xPortGetCoreID() { return hal::Rtos::currentTask().core; }
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    return hal::Rtos::notifyTake(clear_on_exit != pdFALSE, ticks_to_wait);
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    hal::Rtos::notify(*task);
+    return pdPASS;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+    hal::Rtos::notify(*task);
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdTRUE;
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace hal {
+
+/// Эмуляция ADC: напряжение на выводах задаёт модель (SITL)
+struct Adc final {
+    static constexpr auto pins_total = 40;
+
+    /// мВ на выводе
+    static inline uint16_t millivolts[pins_total]{};
+
+    static inline uint32_t reads{0};
+};
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+namespace hal {
+
+/// Виртуальные часы нативной сборки
+/// Время идёт только когда прошивка его "тратит": delay, SPI транзакции, ожидание событий
+struct Clock final {
+
+    using Callback = void (*)(void *context);
+
+private:
+
+    struct Timer {
+        uint64_t deadline_us;
+        uint64_t period_us;
+        Callback callback;
+        void *context;
+        bool active;
+    };
+
+    static inline uint64_t now_us{0};
+    static inline std::vector<Timer> timers{};
+
+public:
+
+    /// Текущее виртуальное время
+    /// Мкс
+    static uint64_t now() noexcept { return now_us; }
+
+    /// Запланировать периодический вызов
+    /// period_us == 0 - однократный вызов
+    /// Возвращает идентификатор таймера
+    static int schedule(uint64_t first_us, uint64_t period_us, Callback callback, void *context = nullptr) {
+        timers.push_back(Timer{
+            .deadline_us = first_us,
+            .period_us = period_us,
+            .callback = callback,
+            .context = context,
+            .active = true,
+        });
+        return static_cast<int>(timers.size()) - 1;
+    }
+
+    static void cancel(int id) noexcept {
+        if (id < 0 or id >= static_cast<int>(timers.size())) { return; }
+        timers[id].active = false;
+    }
+
+    /// Ближайший момент срабатывания таймера
+    /// UINT64_MAX если таймеров нет
+    static uint64_t nextDeadline() noexcept {
+        uint64_t deadline = UINT64_MAX;
+
+        for (const auto &t: timers) {
+            if (t.active and t.deadline_us < deadline) {
+                deadline = t.deadline_us;
+            }
+        }
+
+        return deadline;
+    }
+
+    /// Продвинуть время на delta_us, вызывая таймеры по порядку
+    static void advance(uint64_t delta_us) { advanceTo(now_us + delta_us); }
+
+    /// Продвинуть время до target_us, вызывая таймеры по порядку
+    static void advanceTo(uint64_t target_us) {
+        while (true) {
+            Timer *next = nullptr;
+
+            for (auto &t: timers) {
+                if (t.active and t.deadline_us <= target_us and (next == nullptr or t.deadline_us < next->deadline_us)) {
+                    next = &t;
+                }
+            }
+
+            if (next == nullptr) { break; }
+
+            if (next->deadline_us > now_us) {
+                now_us = next->deadline_us;
+            }
+
+            if (next->period_us == 0) {
+                next->active = false;
+            } else {
+                next->deadline_us += next->period_us;
+            }
+
+            // Указатель может стать невалидным, если обработчик добавит таймер
+            const auto callback = next->callback;
+            const auto context = next->context;
+            callback(context);
+        }
+
+        if (target_us > now_us) {
+            now_us = target_us;
+        }
+    }
+};
+
+}
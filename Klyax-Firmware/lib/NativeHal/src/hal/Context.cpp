@@ -0,0 +1,87 @@
+#include "hal/Context.hpp"
+
+
+#if defined(__x86_64__)
+
+#if defined(__APPLE__)
+#define HAL_CONTEXT_SWITCH "_hal_context_switch"
+#else
+#define HAL_CONTEXT_SWITCH "hal_context_switch"
+#endif
+
+/// Сохраняет rbp, rbx, r12-r15, MXCSR и управляющее слово x87 на стеке, указатель стека - в *save,
+/// затем восстанавливает то же со стека load и возвращается по адресу на его вершине
+extern "C" void hal_context_switch(void **save, void *load);
+
+asm(
+    ".text\n"
+    ".globl " HAL_CONTEXT_SWITCH "\n"
+    HAL_CONTEXT_SWITCH ":\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+);
+
+namespace hal {
+
+void Context::prepare(uint8_t *stack, size_t size, void (*entry)()) {
+    // Значения после сброса: все исключения замаскированы, округление к ближайшему
+    constexpr uint64_t mxcsr = 0x1F80;
+    constexpr uint64_t x87_control = 0x037F;
+
+    const auto top = reinterpret_cast<uintptr_t>(stack + size) & ~static_cast<uintptr_t>(15);
+    auto *frame = reinterpret_cast<uint64_t *>(top) - 9;
+
+    // Снизу вверх: MXCSR и x87, r15, r14, r13, r12, rbx, rbp, адрес возврата, пустой адрес возврата entry()
+    // После ret указатель стека = 8 mod 16, как при входе в функцию через call
+    frame[0] = mxcsr | x87_control << 32;
+    for (int i = 1; i <= 6; i++) { frame[i] = 0; }
+    frame[7] = reinterpret_cast<uint64_t>(entry);
+    frame[8] = 0;
+
+    stack_pointer = frame;
+}
+
+void Context::swap(Context &from, Context &to) {
+    hal_context_switch(&from.stack_pointer, to.stack_pointer);
+}
+
+}
+
+#else
+
+namespace hal {
+
+void Context::prepare(uint8_t *stack, size_t size, void (*entry)()) {
+    getcontext(&context);
+    context.uc_stack.ss_sp = stack;
+    context.uc_stack.ss_size = size;
+    context.uc_link = nullptr;
+    makecontext(&context, entry, 0);
+}
+
+void Context::swap(Context &from, Context &to) {
+    swapcontext(&from.context, &to.context);
+}
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if not defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+
+namespace hal {
+
+/// Контекст выполнения задачи Rtos
+/// На x86-64 переключение сохраняет только регистры, которые по ABI сохраняет вызываемая функция.
+/// swapcontext вдобавок сохраняет маску сигналов системным вызовом: треть времени нативного прогона
+struct Context final {
+
+#if defined(__x86_64__)
+    void *stack_pointer{nullptr};
+#else
+    ucontext_t context{};
+#endif
+
+    /// Первое переключение на контекст вызывает entry() на стеке [stack, stack + size)
+    /// entry() не должна возвращаться
+    void prepare(uint8_t *stack, size_t size, void (*entry)());
+
+    /// Сохранить выполняющийся контекст в from и продолжить to
+    static void swap(Context &from, Context &to);
+};
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+
+namespace hal {
+
+/// Эмуляция радиоканала ESP-NOW
+struct EspNow final {
+    using Mac = std::array<uint8_t, 6>;
+    using ReceiveHandler = void (*)(const Mac &mac, const void *data, uint8_t size);
+    using SendHandler = void (*)(const Mac &mac, const void *data, uint8_t size);
+
+    static inline ReceiveHandler receive_handler{nullptr};
+    static inline SendHandler on_send{nullptr};
+    static inline Mac peer{};
+    static inline bool has_peer{false};
+    static inline uint32_t sent_frames{0};
+
+    /// Доставить кадр от зарегистрированного пира
+    static void deliver(const void *data, uint8_t size) {
+        if (receive_handler == nullptr or not has_peer) { return; }
+        receive_handler(peer, data, size);
+    }
+};
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+namespace hal {
+
+/// Эмуляция раздела данных во FLASH
+/// Стирание заполняет 0xFF, запись только сбрасывает биты, как у NOR FLASH
+struct Flash final {
+
+    static constexpr uint32_t sector_size = 4096;
+
+    /// Совпадает с разделом blackbox в partitions.csv
+    static constexpr uint32_t blackbox_size = 0x200000;
+
+    static inline std::vector<uint8_t> blackbox = std::vector<uint8_t>(blackbox_size, 0xFF);
+
+    static inline uint32_t bytes_written{0};
+    static inline uint32_t sectors_erased{0};
+
+    /// Программирование первого и каждого следующего байта страницы (W25Q32: tBP1 30 мкс, tBP2 2.5 мкс)
+    /// и накладные расходы драйвера (отключение кэша, команды)
+    /// Мкс
+    static inline double first_byte_us{30.0};
+    static inline double next_byte_us{2.5};
+    static inline double overhead_us{20.0};
+
+    /// Стоимость записи в виртуальном времени: пока идёт запись, кэш обоих ядер отключён
+    /// Запись не пересекает границу страницы 256 Б
+    /// Мкс
+    static uint64_t programCost(uint32_t bytes) noexcept {
+        if (bytes == 0) { return 0; }
+        return static_cast<uint64_t>(overhead_us + first_byte_us + next_byte_us * (bytes - 1) + 0.5);
+    }
+
+    /// Сохранить содержимое раздела в файл (как esptool.py read_flash)
+    static bool dump(const char *path) {
+        std::FILE *file = std::fopen(path, "wb");
+        if (file == nullptr) { return false; }
+
+        const auto written = std::fwrite(blackbox.data(), 1, blackbox.size(), file);
+        std::fclose(file);
+        return written == blackbox.size();
+    }
+};
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace hal {
+
+/// Эмуляция прерываний GPIO
+struct Gpio final {
+    static constexpr auto pins_total = 40;
+
+    using Isr = void (*)(void *arg);
+
+    struct Handler {
+        Isr isr;
+        void *arg;
+        int mode;
+    };
+
+    static inline Handler handlers[pins_total]{};
+
+    /// Фронт на выводе: вызвать подключённый обработчик
+    static void trigger(uint8_t pin) {
+        if (pin >= pins_total) { return; }
+        const auto &h = handlers[pin];
+        if (h.isr != nullptr) {
+            h.isr(h.arg);
+        }
+    }
+};
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace hal {
+
+/// Источник данных эмулируемого ICM-20948
+struct Imu final {
+
+    /// Сырые показания в единицах библиотеки SparkFun
+    struct Sample {
+        /// mG
+        float acc[3];
+        /// Градусы / секунду
+        float gyr[3];
+    };
+
+    /// Показание в момент времени t_us
+    using Source = Sample (*)(uint64_t t_us);
+
+    struct Stats {
+        uint32_t spi_transactions;
+        uint32_t spi_bytes;
+        uint32_t samples_read;
+        uint32_t samples_missed;
+        uint32_t interrupts;
+    };
+
+    /// Покоящийся горизонтальный аппарат
+    static Sample restSource(uint64_t) noexcept {
+        return Sample{
+            .acc = {0.0f, 0.0f, 1000.0f},
+            .gyr = {0.0f, 0.0f, 0.0f},
+        };
+    }
+
+    static inline Source source{restSource};
+
+    /// Вывод ESP32, к которому подключён INT датчика
+    static inline uint8_t interrupt_pin{4};
+    static inline Stats stats{};
+
+    /// Частота SPI шины, Гц
+    static inline uint32_t spi_frequency{7000000};
+
+    /// Накладные расходы одной транзакции (CS, команда, драйвер)
+    /// Мкс
+    static inline uint32_t spi_overhead_us{2};
+
+    /// Стоимость SPI транзакции в виртуальном времени
+    /// Мкс
+    static uint64_t transactionCost(uint32_t bytes) noexcept {
+        return spi_overhead_us + (static_cast<uint64_t>(bytes) * 8 * 1000000 + spi_frequency - 1) / spi_frequency;
+    }
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace hal {
+
+/// Эмуляция LEDC: хранит последние скважности каналов
+struct Ledc final {
+    static constexpr auto channels_total = 16;
+    static constexpr auto pins_total = 40;
+
+    struct Channel {
+        uint32_t frequency;
+        uint8_t resolution_bits;
+        uint32_t duty;
+        uint32_t writes;
+    };
+
+    static inline Channel channels[channels_total]{};
+    static inline int8_t pin_channel[pins_total]{
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    };
+
+    /// Скважность на выводе в долях [0.0 .. 1.0]
+    static float dutyOnPin(uint8_t pin) noexcept {
+        if (pin >= pins_total or pin_channel[pin] < 0) { return 0.0f; }
+        const auto &c = channels[pin_channel[pin]];
+        if (c.resolution_bits == 0) { return 0.0f; }
+        return static_cast<float>(c.duty) / static_cast<float>((1u << c.resolution_bits) - 1);
+    }
+};
+
+}
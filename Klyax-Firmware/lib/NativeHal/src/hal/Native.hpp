@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace hal {
+
+/// Расширения точки входа нативной сборки (NativeMain)
+/// Прошивка или SITL регистрируют свои аргументы, запуск и отчёты статическими объектами,
+/// сама точка входа о прошивке ничего не знает: тесты собираются без этих расширений
+struct Native final {
+
+    /// Обработчик аргумента командной строки, value == nullptr у флага
+    /// false - неверное значение, прогон не запускается
+    using OptionHandler = bool (*)(const char *value);
+
+    /// false - прогон не запускается
+    using StartHook = bool (*)();
+
+    using Hook = void (*)();
+
+    struct Option {
+        const char *name;
+        bool has_value;
+        OptionHandler handler;
+    };
+
+    static constexpr uint8_t max_options = 16;
+    static constexpr uint8_t max_hooks = 4;
+
+    /// Код завершения процесса, тесты выставляют EXIT_FAILURE при провале проверок
+    static inline int exit_status{EXIT_SUCCESS};
+
+private:
+
+    // Константная инициализация: регистрация из статических объектов других единиц трансляции безопасна
+
+    static inline Option options[max_options]{};
+    static inline uint8_t options_total{0};
+
+    static inline StartHook start_hooks[max_hooks]{};
+    static inline uint8_t start_hooks_total{0};
+
+    static inline Hook setup_hooks[max_hooks]{};
+    static inline uint8_t setup_hooks_total{0};
+
+    static inline Hook report_hooks[max_hooks]{};
+    static inline uint8_t report_hooks_total{0};
+
+public:
+
+    static bool addOption(const char *name, bool has_value, OptionHandler handler) {
+        if (options_total == max_options) { return false; }
+        options[options_total++] = Option{name, has_value, handler};
+        return true;
+    }
+
+    /// После разбора аргументов, до создания loopTask
+    static bool onStart(StartHook hook) { return add(start_hooks, start_hooks_total, hook); }
+
+    /// В loopTask после setup(), до первого loop()
+    static bool onSetup(Hook hook) { return add(setup_hooks, setup_hooks_total, hook); }
+
+    /// После прогона, в порядке регистрации
+    static bool onReport(Hook hook) { return add(report_hooks, report_hooks_total, hook); }
+
+    static const Option *findOption(const char *name) {
+        for (uint8_t i = 0; i < options_total; i++) {
+            if (std::strcmp(options[i].name, name) == 0) { return &options[i]; }
+        }
+        return nullptr;
+    }
+
+    static bool start() {
+        for (uint8_t i = 0; i < start_hooks_total; i++) {
+            if (not start_hooks[i]()) { return false; }
+        }
+        return true;
+    }
+
+    static void afterSetup() { call(setup_hooks, setup_hooks_total); }
+
+    static void report() { call(report_hooks, report_hooks_total); }
+
+private:
+
+    template<typename T> static bool add(T *hooks, uint8_t &total, T hook) {
+        if (total == max_hooks) { return false; }
+        hooks[total++] = hook;
+        return true;
+    }
+
+    static void call(const Hook *hooks, uint8_t total) {
+        for (uint8_t i = 0; i < total; i++) { hooks[i](); }
+    }
+};
+
+}
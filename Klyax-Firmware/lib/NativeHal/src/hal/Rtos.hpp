@@ -0,0 +1,313 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "hal/Clock.hpp"
+#include "hal/Context.hpp"
+
+
+namespace hal {
+
+/// Эмуляция задачи FreeRTOS: свой стек и hal::Context
+struct Task final {
+
+    enum class State {
+        Ready,
+        Delayed,
+        WaitingNotification,
+        WaitingSemaphore,
+        Deleted,
+    };
+
+    const char *name;
+    unsigned priority;
+    int core;
+    void (*function)(void *);
+    void *parameter;
+
+    Context context{};
+    std::vector<uint8_t> stack{};
+
+    State state{State::Ready};
+    uint64_t wake_us{0};
+    uint32_t notification{0};
+    uint64_t last_run{0};
+    uint64_t resumes{0};
+};
+
+/// Эмуляция двоичного семафора FreeRTOS
+struct Semaphore final {
+    bool given{false};
+    Task *waiter{nullptr};
+};
+
+/// Кооперативный планировщик задач поверх виртуальных часов
+/// Задача выполняется до блокировки (delay, ожидание уведомления, yield), вытеснения нет.
+/// Когда все задачи заблокированы, время переводится к ближайшему таймеру или пробуждению.
+/// Следующую задачу выбирает блокирующаяся: переключение сразу на неё, без возврата в run(),
+/// а если следующей оказалась она сама - без переключения
+struct Rtos final {
+
+    /// Длительность тика FreeRTOS
+    /// Мкс
+    static constexpr uint64_t tick_us = 1000;
+
+    static constexpr size_t min_stack_size = 256 * 1024;
+
+private:
+
+    static inline std::vector<std::unique_ptr<Task>> tasks{};
+    static inline Task *current{nullptr};
+    static inline Context scheduler_context{};
+    static inline uint64_t run_counter{0};
+    static inline uint64_t run_end_us{0};
+
+    /// Псевдо-задача для кода вне планировщика
+    static inline Task outside{"outside", 0, -1, nullptr, nullptr};
+
+public:
+
+    static Task *create(void (*function)(void *), const char *name, size_t stack_size, void *parameter, unsigned priority, int core) {
+        tasks.push_back(std::make_unique<Task>(Task{name, priority, core, function, parameter}));
+        Task &task = *tasks.back();
+
+        task.stack.resize(stack_size > min_stack_size ? stack_size : min_stack_size);
+        task.context.prepare(task.stack.data(), task.stack.size(), Rtos::trampoline);
+
+        return &task;
+    }
+
+    static Task &currentTask() { return current == nullptr ? outside : *current; }
+
+    static const std::vector<std::unique_ptr<Task>> &allTasks() { return tasks; }
+
+    /// Уведомление задачи (из прерывания или другой задачи)
+    static void notify(Task &task) {
+        task.notification += 1;
+        if (task.state == Task::State::WaitingNotification) {
+            task.state = Task::State::Ready;
+        }
+    }
+
+    /// Ожидание уведомления текущей задачей
+    static uint32_t notifyTake(bool clear, uint32_t ticks) {
+        if (current == nullptr) {
+            return notifyTakeOutside(clear, ticks);
+        }
+
+        Task &task = *current;
+
+        if (task.notification == 0 and ticks != 0) {
+            task.state = Task::State::WaitingNotification;
+            task.wake_us = ticks == UINT32_MAX ? UINT64_MAX : Clock::now() + ticks * tick_us;
+            switchToScheduler();
+        }
+
+        if (task.notification == 0) { return 0; }
+
+        const auto value = task.notification;
+        task.notification = clear ? 0 : value - 1;
+        return value;
+    }
+
+    /// Выдача семафора (из прерывания или другой задачи)
+    static void give(Semaphore &semaphore) {
+        semaphore.given = true;
+        if (semaphore.waiter != nullptr and semaphore.waiter->state == Task::State::WaitingSemaphore) {
+            semaphore.waiter->state = Task::State::Ready;
+        }
+    }
+
+    /// Захват семафора текущей задачей
+    static bool take(Semaphore &semaphore, uint32_t ticks) {
+        if (current == nullptr) {
+            return takeOutside(semaphore, ticks);
+        }
+
+        Task &task = *current;
+
+        if (not semaphore.given and ticks != 0) {
+            semaphore.waiter = &task;
+            task.state = Task::State::WaitingSemaphore;
+            task.wake_us = ticks == UINT32_MAX ? UINT64_MAX : Clock::now() + ticks * tick_us;
+            switchToScheduler();
+            semaphore.waiter = nullptr;
+        }
+
+        if (not semaphore.given) { return false; }
+
+        semaphore.given = false;
+        return true;
+    }
+
+    /// Блокировка текущей задачи на delay_us
+    static void delay(uint64_t delay_us) {
+        if (current == nullptr) {
+            Clock::advance(delay_us);
+            return;
+        }
+
+        current->state = Task::State::Delayed;
+        current->wake_us = Clock::now() + delay_us;
+        switchToScheduler();
+    }
+
+    /// Уступить процессор задачам того же или более высокого приоритета
+    static void yield() {
+        if (current == nullptr) { return; }
+        switchToScheduler();
+    }
+
+    static void deleteCurrent() {
+        if (current == nullptr) { return; }
+        current->state = Task::State::Deleted;
+        switchToScheduler();
+    }
+
+    /// Выполнять задачи до момента end_us виртуального времени
+    static void run(uint64_t end_us) {
+        run_end_us = end_us;
+
+        // Сюда управление возвращается, когда время истекло или задача завершилась
+        while (Task *next = pickNext()) {
+            resume(*next);
+            Context::swap(scheduler_context, next->context);
+            current = nullptr;
+        }
+    }
+
+private:
+
+    static bool isBlocked(const Task &task) {
+        return task.state == Task::State::Delayed
+               or task.state == Task::State::WaitingNotification
+               or task.state == Task::State::WaitingSemaphore;
+    }
+
+    static Task *pickReady() {
+        Task *best = nullptr;
+
+        for (const auto &t: tasks) {
+            if (t->state != Task::State::Ready) { continue; }
+
+            if (best == nullptr or t->priority > best->priority or (t->priority == best->priority and t->last_run < best->last_run)) {
+                best = t.get();
+            }
+        }
+
+        return best;
+    }
+
+    /// Следующая задача, время при необходимости переводится вперёд
+    /// nullptr - достигнут конец прогона
+    static Task *pickNext() {
+        // Таймеры срабатывают вне задач, как прерывания
+        current = nullptr;
+
+        while (true) {
+            Task *next = pickReady();
+
+            if (next != nullptr) {
+                return Clock::now() >= run_end_us ? nullptr : next;
+            }
+
+            uint64_t wake_us = Clock::nextDeadline();
+
+            for (const auto &t: tasks) {
+                if (isBlocked(*t)) {
+                    wake_us = t->wake_us < wake_us ? t->wake_us : wake_us;
+                }
+            }
+
+            if (wake_us >= run_end_us) {
+                Clock::advanceTo(run_end_us);
+                return nullptr;
+            }
+
+            Clock::advanceTo(wake_us);
+
+            for (const auto &t: tasks) {
+                if (isBlocked(*t) and t->wake_us <= Clock::now()) {
+                    t->state = Task::State::Ready;
+                }
+            }
+        }
+    }
+
+    static void resume(Task &task) {
+        current = &task;
+        run_counter += 1;
+        task.last_run = run_counter;
+        task.resumes += 1;
+    }
+
+    static void switchToScheduler() {
+        Task *self = current;
+        Task *next = pickNext();
+
+        if (next == nullptr) {
+            Context::swap(self->context, scheduler_context);
+            return;
+        }
+
+        resume(*next);
+
+        if (next != self) {
+            Context::swap(self->context, next->context);
+        }
+    }
+
+    static void trampoline() {
+        current->function(current->parameter);
+        // Задача FreeRTOS не должна возвращаться
+        current->state = Task::State::Deleted;
+        switchToScheduler();
+    }
+
+    /// Ожидание вне задач: время идёт до срабатывания таймеров
+    static uint32_t notifyTakeOutside(bool clear, uint32_t ticks) {
+        Task &task = outside;
+        const auto deadline = ticks == UINT32_MAX ? UINT64_MAX : Clock::now() + ticks * tick_us;
+
+        while (task.notification == 0) {
+            const auto next = Clock::nextDeadline();
+
+            if (next > deadline or next == UINT64_MAX) {
+                if (deadline != UINT64_MAX) {
+                    Clock::advanceTo(deadline);
+                }
+                return 0;
+            }
+
+            Clock::advanceTo(next);
+        }
+
+        const auto value = task.notification;
+        task.notification = clear ? 0 : value - 1;
+        return value;
+    }
+
+    static bool takeOutside(Semaphore &semaphore, uint32_t ticks) {
+        const auto deadline = ticks == UINT32_MAX ? UINT64_MAX : Clock::now() + ticks * tick_us;
+
+        while (not semaphore.given) {
+            const auto next = Clock::nextDeadline();
+
+            if (next > deadline or next == UINT64_MAX) {
+                if (deadline != UINT64_MAX) {
+                    Clock::advanceTo(deadline);
+                }
+                return false;
+            }
+
+            Clock::advanceTo(next);
+        }
+
+        semaphore.given = false;
+        return true;
+    }
+};
+
+}
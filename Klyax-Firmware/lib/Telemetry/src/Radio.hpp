@@ -0,0 +1,313 @@
+#pragma once
+
+/// Формат посылок ESP-NOW Klyax
+/// Посылка: заголовок (версия, кол-во сообщений, номер, время), сообщения [тип, размер, данные], CRC16
+/// В одной посылке может идти несколько сообщений разных типов
+/// Тот же заголовок используют прошивка, пульт, SITL и хост (Scripts/klyax/radio.py)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+namespace radio {
+
+/// Меняется при любом несовместимом изменении формата
+static constexpr uint8_t version = 1;
+
+/// Максимальный размер посылки ESP-NOW
+/// Байт
+static constexpr size_t max_payload_size = 250;
+
+enum class Type : uint8_t {
+    /// Стики пульта: ControlMessage
+    Control,
+
+    /// Кнопка меню пульта: MenuMessage
+    Menu,
+
+    /// Текст страницы интерфейса
+    TuiPage,
+
+    /// Кадр телеметрии: telemetry::Frame
+    Telemetry,
+
+    /// Общее кол-во
+    TypesTotal
+};
+
+static constexpr uint8_t types_total = static_cast<uint8_t>(Type::TypesTotal);
+
+/// Заголовок посылки, little-endian
+struct __attribute__((packed)) Header {
+    uint8_t version;
+
+    /// Кол-во сообщений
+    uint8_t messages;
+
+    /// Номер посылки у отправителя: пропуски - потери, повтор или откат - переупорядочивание
+    uint16_t sequence;
+
+    /// Время отправителя
+    /// Мкс
+    uint32_t timestamp_us;
+};
+
+struct __attribute__((packed)) MessageHeader {
+    uint8_t type;
+
+    /// Байт данных после заголовка сообщения
+    uint8_t size;
+};
+
+/// Контрольная сумма в конце посылки
+using Crc = uint16_t;
+
+static_assert(sizeof(Header) == 8, "Header layout is part of the wire protocol");
+static_assert(sizeof(MessageHeader) == 2, "MessageHeader layout is part of the wire protocol");
+
+/// Данных на сообщение не больше
+/// Байт
+static constexpr size_t max_message_size = max_payload_size - sizeof(Header) - sizeof(MessageHeader) - sizeof(Crc);
+
+/// Сообщений размера size в одной посылке
+static constexpr size_t messagesPerFrame(size_t size) {
+    return (max_payload_size - sizeof(Header) - sizeof(Crc)) / (sizeof(MessageHeader) + size);
+}
+
+/// Стики пульта
+struct __attribute__((packed)) ControlMessage {
+    float left_x;
+    float left_y;
+    float right_x;
+    float right_y;
+
+    uint8_t mode_toggle;
+};
+
+/// Кнопка меню пульта
+struct __attribute__((packed)) MenuMessage {
+    uint8_t code;
+};
+
+/// CRC-16/CCITT-FALSE: полином 0x1021, начальное значение 0xFFFF
+struct Crc16Table {
+    Crc values[256];
+
+    constexpr Crc16Table() :
+        values{} {
+        for (uint16_t i = 0; i < 256; i++) {
+            auto crc = static_cast<Crc>(i << 8);
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                crc = static_cast<Crc>(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+            }
+            values[i] = crc;
+        }
+    }
+};
+
+inline constexpr Crc16Table crc16_table{};
+
+inline Crc crc16(const uint8_t *data, size_t size) {
+    Crc crc = 0xFFFF;
+
+    for (size_t i = 0; i < size; i++) {
+        crc = static_cast<Crc>((crc << 8) ^ crc16_table.values[(crc >> 8) ^ data[i]]);
+    }
+
+    return crc;
+}
+
+/// Посылка, готовая к отправке
+struct Frame {
+    uint8_t data[max_payload_size];
+    uint8_t size;
+};
+
+/// Набирает сообщения в посылку
+/// Номер и время ставятся при отправке (seal): посылки разных задач нумеруются в порядке отправки
+struct FrameWriter final {
+
+private:
+
+    Frame frame{};
+    uint8_t messages{0};
+    size_t cursor{sizeof(Header)};
+
+public:
+
+    /// Поместится ли ещё сообщение из size байт
+    inline bool fits(size_t size) const {
+        return cursor + sizeof(MessageHeader) + size + sizeof(Crc) <= max_payload_size;
+    }
+
+    /// false - не помещается
+    bool add(Type type, const void *payload, size_t size) {
+        if (not fits(size)) { return false; }
+
+        const MessageHeader header{static_cast<uint8_t>(type), static_cast<uint8_t>(size)};
+        std::memcpy(frame.data + cursor, &header, sizeof(header));
+        std::memcpy(frame.data + cursor + sizeof(header), payload, size);
+
+        cursor += sizeof(header) + size;
+        messages += 1;
+        return true;
+    }
+
+    template<typename T> inline bool add(Type type, const T &payload) { return add(type, &payload, sizeof(T)); }
+
+    inline bool empty() const { return messages == 0; }
+
+    inline uint8_t getMessages() const { return messages; }
+
+    /// Заголовок и CRC, затем набор следующей посылки
+    const Frame &seal(uint16_t sequence, uint32_t timestamp_us) {
+        const Header header{version, messages, sequence, timestamp_us};
+        std::memcpy(frame.data, &header, sizeof(header));
+
+        const Crc crc = crc16(frame.data, cursor);
+        std::memcpy(frame.data + cursor, &crc, sizeof(crc));
+        frame.size = static_cast<uint8_t>(cursor + sizeof(crc));
+
+        messages = 0;
+        cursor = sizeof(Header);
+        return frame;
+    }
+};
+
+enum class Status : uint8_t {
+    Ok,
+
+    /// Короче заголовка и CRC или длиннее посылки ESP-NOW
+    Size,
+
+    /// Другая версия формата
+    Version,
+
+    /// Не сошлась контрольная сумма
+    Crc,
+
+    /// Сообщения не совпадают с размером посылки
+    Layout,
+};
+
+/// Проверка посылки: размер, версия, контрольная сумма, разметка сообщений
+/// header - заголовок корректной посылки
+inline Status check(const void *data, size_t size, Header &header) {
+    if (size < sizeof(Header) + sizeof(Crc) or size > max_payload_size) { return Status::Size; }
+
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (header.version != version) { return Status::Version; }
+
+    const size_t end = size - sizeof(Crc);
+
+    Crc crc;
+    std::memcpy(&crc, bytes + end, sizeof(crc));
+    if (crc != crc16(bytes, end)) { return Status::Crc; }
+
+    size_t cursor = sizeof(Header);
+
+    for (uint8_t i = 0; i < header.messages; i++) {
+        if (cursor + sizeof(MessageHeader) > end) { return Status::Layout; }
+        cursor += sizeof(MessageHeader) + bytes[cursor + 1];
+    }
+
+    return cursor == end ? Status::Ok : Status::Layout;
+}
+
+/// Сообщения посылки, прошедшей check
+/// on_message(uint8_t type, const uint8_t *payload, uint8_t size)
+template<typename F> void forEach(const void *data, const Header &header, F &&on_message) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    size_t cursor = sizeof(Header);
+
+    for (uint8_t i = 0; i < header.messages; i++) {
+        MessageHeader message;
+        std::memcpy(&message, bytes + cursor, sizeof(message));
+        on_message(message.type, bytes + cursor + sizeof(message), message.size);
+        cursor += sizeof(message) + message.size;
+    }
+}
+
+/// Обработчики сообщений по типу: таблица переходов, вызов за постоянное время
+template<typename Context> struct Dispatcher final {
+
+    using Handler = void (*)(Context &context, const uint8_t *payload, uint8_t size);
+
+private:
+
+    Handler handlers[types_total]{};
+
+public:
+
+    constexpr Dispatcher &on(Type type, Handler handler) {
+        handlers[static_cast<uint8_t>(type)] = handler;
+        return *this;
+    }
+
+    /// false - тип неизвестен или без обработчика
+    bool dispatch(Context &context, uint8_t type, const uint8_t *payload, uint8_t size) const {
+        if (type >= types_total or handlers[type] == nullptr) { return false; }
+
+        handlers[type](context, payload, size);
+        return true;
+    }
+};
+
+/// Номера посылок одного отправителя
+struct SequenceTracker final {
+
+    enum class Order : uint8_t {
+        /// Следующая или после пропуска
+        Newer,
+
+        /// Повтор или старше уже принятой
+        Stale,
+    };
+
+    /// Столько старых номеров подряд - отправитель перезапущен, нумерация начинается заново
+    static constexpr uint8_t restart_after = 8;
+
+private:
+
+    uint16_t last{0};
+    bool started{false};
+    uint8_t stale_in_row{0};
+
+    uint32_t lost{0};
+    uint32_t stale{0};
+
+public:
+
+    Order accept(uint16_t sequence) {
+        if (not started) {
+            started = true;
+            last = sequence;
+            return Order::Newer;
+        }
+
+        auto delta = static_cast<int16_t>(static_cast<uint16_t>(sequence - last));
+
+        if (delta <= 0) {
+            stale += 1;
+            stale_in_row += 1;
+
+            if (stale_in_row < restart_after) { return Order::Stale; }
+
+            delta = 1;
+        }
+
+        stale_in_row = 0;
+        lost += static_cast<uint32_t>(delta - 1);
+        last = sequence;
+        return Order::Newer;
+    }
+
+    inline uint32_t getLost() const { return lost; }
+
+    inline uint32_t getStale() const { return stale; }
+};
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+/// Бинарная телеметрия Klyax
+/// Кадры фиксированного размера идут сообщениями radio::Type::Telemetry, по несколько в одной посылке ESP-NOW
+/// Тот же заголовок используют прошивка (кодирование) и хост (декодирование)
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "Radio.hpp"
+
+
+namespace telemetry {
+
+/// Масштабы целочисленного представления
+struct Scale final {
+
+    /// Рад -> LSB
+    static constexpr float orientation = 10000.0f;
+
+    /// Рад / с -> LSB
+    static constexpr float rate = 500.0f;
+
+    /// [0.0 .. 1.0] -> LSB
+    static constexpr float motor = 65535.0f;
+
+    /// Терм PID -> LSB
+    static constexpr float pid_term = 10000.0f;
+
+    /// В -> LSB
+    static constexpr float battery = 1000.0f;
+};
+
+enum Axis : uint8_t {
+    Roll,
+    Pitch,
+    Yaw,
+    AxesTotal,
+};
+
+enum Term : uint8_t {
+    P,
+    I,
+    D,
+    TermsTotal,
+};
+
+static constexpr uint8_t motors_total = 4;
+
+/// Отсчёт телеметрии в физических величинах
+struct Sample {
+
+    /// Мкс
+    uint32_t timestamp_us;
+
+    /// Рад
+    float orientation[AxesTotal];
+
+    /// Рад / с
+    float rates[AxesTotal];
+
+    /// [0.0 .. 1.0] в порядке DroneFrameDriver::MotorIndex
+    float motors[motors_total];
+
+    /// Вклады P, I, D регуляторов угловой скорости
+    float pid[AxesTotal][TermsTotal];
+
+    /// Период управляющего цикла
+    /// Мкс
+    uint16_t period_us;
+
+    /// Время работы управляющего цикла
+    /// Мкс
+    uint16_t busy_us;
+
+    /// Напряжение батареи, 0 - не подключена
+    /// В
+    float battery;
+};
+
+/// Кадр на линии, little-endian
+struct __attribute__((packed)) Frame {
+    uint32_t timestamp_us;
+    int16_t orientation[AxesTotal];
+    int16_t rates[AxesTotal];
+    uint16_t motors[motors_total];
+    int16_t pid[AxesTotal][TermsTotal];
+    uint16_t period_us;
+    uint16_t busy_us;
+    uint16_t battery;
+};
+
+static_assert(sizeof(Frame) == 48, "Frame layout is part of the host protocol");
+
+/// Кадров в одной посылке
+static constexpr size_t frames_per_batch = radio::messagesPerFrame(sizeof(Frame));
+
+inline int16_t toInt16(float value, float scale) {
+    const float scaled = std::round(value * scale);
+    if (scaled > INT16_MAX) { return INT16_MAX; }
+    if (scaled < INT16_MIN) { return INT16_MIN; }
+    return static_cast<int16_t>(scaled);
+}
+
+inline uint16_t toUint16(float value, float scale) {
+    const float scaled = std::round(value * scale);
+    if (scaled > UINT16_MAX) { return UINT16_MAX; }
+    if (scaled < 0) { return 0; }
+    return static_cast<uint16_t>(scaled);
+}
+
+inline Frame encode(const Sample &s) {
+    Frame f{};
+    f.timestamp_us = s.timestamp_us;
+
+    for (uint8_t a = 0; a < AxesTotal; a++) {
+        f.orientation[a] = toInt16(s.orientation[a], Scale::orientation);
+        f.rates[a] = toInt16(s.rates[a], Scale::rate);
+
+        for (uint8_t t = 0; t < TermsTotal; t++) {
+            f.pid[a][t] = toInt16(s.pid[a][t], Scale::pid_term);
+        }
+    }
+
+    for (uint8_t m = 0; m < motors_total; m++) {
+        f.motors[m] = toUint16(s.motors[m], Scale::motor);
+    }
+
+    f.period_us = s.period_us;
+    f.busy_us = s.busy_us;
+    f.battery = toUint16(s.battery, Scale::battery);
+    return f;
+}
+
+inline Sample decode(const Frame &f) {
+    Sample s{};
+    s.timestamp_us = f.timestamp_us;
+
+    for (uint8_t a = 0; a < AxesTotal; a++) {
+        s.orientation[a] = static_cast<float>(f.orientation[a]) / Scale::orientation;
+        s.rates[a] = static_cast<float>(f.rates[a]) / Scale::rate;
+
+        for (uint8_t t = 0; t < TermsTotal; t++) {
+            s.pid[a][t] = static_cast<float>(f.pid[a][t]) / Scale::pid_term;
+        }
+    }
+
+    for (uint8_t m = 0; m < motors_total; m++) {
+        s.motors[m] = static_cast<float>(f.motors[m]) / Scale::motor;
+    }
+
+    s.period_us = f.period_us;
+    s.busy_us = f.busy_us;
+    s.battery = static_cast<float>(f.battery) / Scale::battery;
+    return s;
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "tools/filters.hpp"
+#include "tools/Logger.hpp"
+#include "tools/Singleton.hpp"
+
+
+/// Напряжение LiPo 1S через делитель на входе ADC1
+/// Фоновая задача усредняет отсчёты и фильтрует напряжение, управляющая задача читает последнее значение без ожидания
+/// Оцифровка однократными отсчётами ADC1 в фоновой задаче: не мешают Wi-Fi и не попадают в управляющий цикл
+/// Непрерывный режим (встроенный ADC через DMA I2S0) не используется: он оцифровывает с частотой в килогерцы,
+/// а напряжению, которое меняется за единицы Гц, хватает 100 Гц - буферы DMA пришлось бы усреднять обратно
+/// на ядре 0 рядом с Wi-Fi, а I2S0 и ADC1 были бы заняты им целиком
+struct Battery final : Singleton<Battery> {
+    friend struct Singleton<Battery>;
+
+    /// GPIO34 - ADC1_CH6, только вход
+    static constexpr uint8_t pin = 34;
+
+    /// Отношение делителя 100 кОм / 100 кОм
+    static constexpr float divider_ratio = 2.0f;
+
+    /// Отсчётов АЦП на одно измерение
+    static constexpr uint8_t oversampling = 8;
+
+    /// Период фоновой задачи
+    /// Мс
+    static constexpr uint32_t period_ms = 10;
+
+    /// Фильтр напряжения: просадка под нагрузкой проходит, шум АЦП нет
+    /// Гц
+    static constexpr float cutoff_hz = 5.0f;
+
+    /// Ниже - батарея не подключена (питание от USB)
+    /// В
+    static constexpr float present_voltage = 2.5f;
+
+    /// Разряд: ниже - батарея разряжена, выше recovered_voltage - снова в норме
+    /// В
+    static constexpr float low_voltage = 3.3f;
+
+    /// В
+    static constexpr float recovered_voltage = 3.4f;
+
+private:
+
+    /// В, 0 - батарея не подключена
+    std::atomic<float> voltage{0};
+    std::atomic<bool> low{false};
+
+    /// Состояние фоновой задачи
+    PtFilter<1, 1> filter{};
+
+public:
+
+    void init() {
+        analogSetPinAttenuation(pin, ADC_11db);
+        filter.configure(cutoff_hz, 1000.0f / static_cast<float>(period_ms));
+    }
+
+    /// Вызывается из любой задачи
+    /// В, 0 - батарея не подключена
+    inline float getVoltage() const { return voltage.load(std::memory_order_relaxed); }
+
+    /// Вызывается из любой задачи
+    inline bool isLow() const { return low.load(std::memory_order_relaxed); }
+
+    static void task(void *) {
+        auto &self = instance();
+        self.init();
+
+        while (true) {
+            self.service();
+            vTaskDelay(pdMS_TO_TICKS(period_ms));
+        }
+    }
+
+private:
+
+    void service() {
+        uint32_t millivolts = 0;
+        for (uint8_t i = 0; i < oversampling; i++) { millivolts += analogReadMilliVolts(pin); }
+
+        float volts = static_cast<float>(millivolts) * (divider_ratio / (1000.0f * oversampling));
+
+        if (volts < present_voltage) {
+            filter.configure(cutoff_hz, 1000.0f / static_cast<float>(period_ms));
+            voltage.store(0, std::memory_order_relaxed);
+            low.store(false, std::memory_order_relaxed);
+            return;
+        }
+
+        filter.calc(&volts);
+        voltage.store(volts, std::memory_order_relaxed);
+
+        if (not isLow() and volts < low_voltage) {
+            low.store(true, std::memory_order_relaxed);
+            Logger_warn("low battery: %.2f V", volts);
+        } else if (isLow() and volts > recovered_voltage) {
+            low.store(false, std::memory_order_relaxed);
+        }
+    }
+};
@@ -0,0 +1,516 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <esp_partition.h>
+
+#include "tools/Logger.hpp"
+#include "tools/Mailbox.hpp"
+#include "tools/Singleton.hpp"
+
+
+/// Бортовой самописец
+/// Управляющая задача кладёт запись каждой итерации в кольцевой буфер в RAM,
+/// задача с низким приоритетом кодирует записи (дельта + zigzag + varint) и пишет их в раздел FLASH "blackbox"
+///
+/// Запись во FLASH отключает кэш обоих ядер: управляющая задача выполняется из FLASH и стоит всё это время
+/// Поэтому запись идёт кусками по chunk_size только в простое цикла: управляющая задача после такта сообщает
+/// время следующего пробуждения (onStepDone), кусок пишется, если по последнему замеру успевает до него
+///
+/// Формат раздела: сектора по 4 КБ, каждый начинается с SectorHeader
+/// Дельты в секторе считаются от нуля, поэтому каждый сектор декодируется независимо
+/// Запись: [длина u8][varint поля...], длина 0xFF (стёртая FLASH) - конец сектора
+struct Blackbox final : Singleton<Blackbox> {
+    friend struct Singleton<Blackbox>;
+
+    /// Поля записи, порядок - часть формата дампа (Scripts/klyax/blackbox.py)
+    enum Field : uint8_t {
+        /// Мкс
+        TimeUs,
+
+        /// Сырой гироскоп в системе датчика, LSB (16.4 LSB / град / с)
+        GyroX,
+        GyroY,
+        GyroZ,
+
+        /// Сырой акселерометр в системе датчика, LSB (16.384 LSB / мG)
+        AccelX,
+        AccelY,
+        AccelZ,
+
+        /// EasyImu::FLU: ориентация (Рад * Scale::angle)
+        Roll,
+        Pitch,
+        Yaw,
+
+        /// EasyImu::FLU: угловые скорости (Рад / с * Scale::rate)
+        RollRate,
+        PitchRate,
+        YawRate,
+
+        /// DroneControl (* Scale::unit)
+        ControlRoll,
+        ControlPitch,
+        ControlYaw,
+        ControlThrust,
+        Armed,
+
+        /// Термы PID угловой скорости (* Scale::unit)
+        PidRollP,
+        PidRollI,
+        PidRollD,
+        PidPitchP,
+        PidPitchI,
+        PidPitchD,
+        PidYawP,
+        PidYawI,
+        PidYawD,
+
+        /// Команды моторам в порядке DroneFrameDriver::MotorIndex (* Scale::unit)
+        MotorBackLeft,
+        MotorBackRight,
+        MotorFrontRight,
+        MotorFrontLeft,
+
+        FieldsTotal,
+    };
+
+    struct Scale final {
+        static constexpr float gyro = 16.4f;
+        static constexpr float accel = 16.384f;
+        static constexpr float angle = 10000.0f;
+        static constexpr float rate = 1000.0f;
+        static constexpr float unit = 10000.0f;
+    };
+
+    struct Record {
+        int32_t fields[FieldsTotal];
+
+        inline void set(Field field, float value, float scale) {
+            fields[field] = static_cast<int32_t>(std::lround(value * scale));
+        }
+    };
+
+    enum class State : uint8_t {
+        /// Раздел не найден
+        Disabled,
+
+        /// Свободное место не стёрто
+        EraseRequired,
+
+        Idle,
+        Recording,
+        Erasing,
+
+        /// Раздел заполнен
+        Full,
+    };
+
+private:
+
+    /// "KBB1"
+    static constexpr uint32_t sector_magic = 0x3142424B;
+
+    static constexpr uint32_t sector_size = SPI_FLASH_SEC_SIZE;
+
+    /// Страница программируется до ~0.7 мс, 64 Б - ~0.2 мс, 16 Б - ~0.09 мс (W25Q32)
+    static constexpr uint32_t page_size = 256;
+
+    /// Кусок записи во FLASH: делитель размера страницы
+    static constexpr uint32_t chunk_size = 16;
+
+    /// Одна запись - до 4 соседних кусков, сколько успеет до пробуждения управляющей задачи
+    static constexpr uint32_t chunks_per_write_max = 4;
+
+    /// Закодированные, но ещё не записанные во FLASH байты: индекс - смещение в разделе по модулю
+    /// Сектор про запас: переход к следующему сектору сдвигает смещение без записи
+    static constexpr uint32_t staging_size = 2 * sector_size;
+
+    /// Запас до пробуждения управляющей задачи
+    /// Мкс
+    static constexpr uint32_t wake_guard_us = 20;
+
+    /// Оценка записи куска до первого замера, с запасом
+    /// Мкс
+    static constexpr uint32_t initial_chunk_cost_us = 100;
+
+    /// Длина + до 5 байт varint на поле
+    static constexpr size_t max_encoded_size = 1 + FieldsTotal * 5;
+
+    struct __attribute__((packed)) SectorHeader {
+        uint32_t magic;
+        uint16_t session;
+        uint8_t fields;
+        uint8_t reserved;
+        uint32_t sector_index;
+    };
+
+    /// 128 записей: 64 мс при 2 кГц
+    SpscQueue<Record, 128> records{};
+
+    const esp_partition_t *partition{nullptr};
+
+    std::atomic<State> state{State::Disabled};
+    std::atomic<bool> recording_requested{false};
+    std::atomic<bool> erase_requested{false};
+
+    /// Задача записи: её будит управляющая задача после такта
+    std::atomic<TaskHandle_t> writer{nullptr};
+
+    /// Конец окна записи: следующее пробуждение управляющей задачи
+    /// Мкс
+    std::atomic<uint32_t> window_end_us{0};
+
+    /// Записи во FLASH, закончившиеся после пробуждения управляющей задачи
+    std::atomic<uint32_t> late_writes{0};
+
+    /// Мкс
+    std::atomic<uint32_t> max_write_us{0};
+
+    /// В staging есть незаписанные во FLASH данные
+    std::atomic<bool> flush_pending{false};
+
+    /// Состояние задачи записи
+    /// offset - конец закодированных данных, flushed - начало ещё не записанного во FLASH
+    uint32_t offset{0};
+    uint32_t flushed{0};
+    uint16_t session{0};
+    uint32_t sector_index{0};
+    int32_t previous[FieldsTotal]{};
+    uint8_t staging[staging_size]{};
+
+    /// Длительность последней записи из 1..4 кусков
+    /// Мкс
+    uint32_t write_cost_us[chunks_per_write_max]{
+        initial_chunk_cost_us, 2 * initial_chunk_cost_us, 3 * initial_chunk_cost_us, 4 * initial_chunk_cost_us
+    };
+
+public:
+
+    /// Поиск раздела и свободного места
+    bool init() {
+        Logger_info("init");
+
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "blackbox");
+        if (partition == nullptr) {
+            Logger_error("partition 'blackbox' not found");
+            return false;
+        }
+
+        offset = partition->size;
+        session = 0;
+
+        for (uint32_t sector = 0; sector < partition->size; sector += sector_size) {
+            SectorHeader header;
+            esp_partition_read(partition, sector, &header, sizeof(header));
+
+            if (header.magic != sector_magic) {
+                offset = sector;
+                break;
+            }
+
+            session = std::max<uint16_t>(session, header.session);
+        }
+
+        flushed = offset;
+        std::memset(staging, 0xFF, sizeof(staging));
+
+        if (offset == partition->size) {
+            state = State::Full;
+        } else if (not sectorErased(offset)) {
+            Logger_warn("free space at 0x%x is not erased", static_cast<unsigned>(offset));
+            state = State::EraseRequired;
+        } else {
+            state = State::Idle;
+        }
+
+        Logger_debug("used %u / %u B, last session %u", static_cast<unsigned>(offset), static_cast<unsigned>(partition->size), session);
+        return true;
+    }
+
+    /// Управляющая задача: запись идёт, пока включено
+    inline void setRecording(bool enabled) { recording_requested.store(enabled, std::memory_order_relaxed); }
+
+    inline bool isRecording() const { return recording_requested.load(std::memory_order_relaxed); }
+
+    /// Управляющая задача: добавить запись итерации
+    void record(const Record &r) {
+        if (not isRecording()) { return; }
+        records.push(r);
+    }
+
+    /// Управляющая задача, конец такта: окно записи во FLASH до следующего пробуждения
+    /// Мкс
+    void onStepDone(uint32_t next_wake_us) {
+        const TaskHandle_t task = writer.load(std::memory_order_relaxed);
+        if (task == nullptr) { return; }
+
+        if (not isRecording() and not flush_pending.load(std::memory_order_relaxed)) { return; }
+
+        window_end_us.store(next_wake_us - wake_guard_us, std::memory_order_relaxed);
+        xTaskNotifyGive(task);
+    }
+
+    /// Стереть раздел (выполнит задача записи, не во время записи)
+    inline void requestErase() { erase_requested.store(true, std::memory_order_relaxed); }
+
+    inline State getState() const { return state.load(std::memory_order_relaxed); }
+
+    /// Байт
+    inline uint32_t getUsed() const { return offset; }
+
+    /// Байт
+    inline uint32_t getCapacity() const { return partition == nullptr ? 0 : partition->size; }
+
+    inline uint16_t getSession() const { return session; }
+
+    /// Записи, не поместившиеся в буфер
+    inline uint32_t getDropped() const { return records.getDropped(); }
+
+    /// Записи во FLASH, задержавшие пробуждение управляющей задачи
+    inline uint32_t getLateWrites() const { return late_writes.load(std::memory_order_relaxed); }
+
+    /// Самая долгая запись (всё это время кэш отключён)
+    /// Мкс
+    inline uint32_t getMaxWriteUs() const { return max_write_us.load(std::memory_order_relaxed); }
+
+    /// Задача записи
+    static void task(void *) {
+        auto &self = instance();
+        self.writer.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+
+        while (true) {
+            // Окно записи открывает управляющая задача, без полёта - стирание и завершение сессии по таймауту
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5));
+            self.service();
+        }
+    }
+
+private:
+
+    void service() {
+        if (erase_requested.exchange(false)) {
+            erase();
+        }
+
+        const bool requested = isRecording();
+
+        if (requested and getState() == State::Idle) {
+            beginSession();
+        }
+
+        // Кодирование только в RAM: не больше, чем поместится в staging
+        while (const Record *r = records.front()) {
+            if (getState() == State::Recording) {
+                if (offset - flushed + sector_size + max_encoded_size > staging_size) { break; }
+                write(*r);
+            }
+            records.pop();
+        }
+
+        flushChunks();
+        flush_pending.store(offset - flushed >= chunk_size or getState() == State::Recording, std::memory_order_relaxed);
+
+        if (not requested and getState() == State::Recording and records.front() == nullptr) {
+            // Хвост сессии - по кускам в окнах простоя, затем неполный кусок
+            if (offset - flushed >= chunk_size) { return; }
+            if (not flushTail()) { return; }
+
+            state = State::Idle;
+            flush_pending.store(false, std::memory_order_relaxed);
+            Logger_info("session %u end, used %u B", session, static_cast<unsigned>(offset));
+        }
+    }
+
+    /// Осталось времени до пробуждения управляющей задачи
+    /// Мкс, отрицательное - окно закрыто
+    int32_t windowLeft() const {
+        return static_cast<int32_t>(window_end_us.load(std::memory_order_relaxed) - static_cast<uint32_t>(micros()));
+    }
+
+    /// Записать во FLASH целые куски, пока они успевают до пробуждения управляющей задачи
+    void flushChunks() {
+        while (offset - flushed >= chunk_size) {
+            // Не дальше данных и конца страницы: кусок не пересекает страницу и кольцо staging
+            uint32_t chunks = std::min((offset - flushed) / chunk_size, chunks_per_write_max);
+            chunks = std::min(chunks, (page_size - flushed % page_size) / chunk_size);
+
+            const int32_t left = windowLeft();
+            while (chunks > 0 and left < static_cast<int32_t>(write_cost_us[chunks - 1])) {
+                chunks -= 1;
+            }
+            if (chunks == 0) { return; }
+
+            writeChunks(chunks * chunk_size);
+            flushed += chunks * chunk_size;
+        }
+    }
+
+    /// Записать неполный кусок в конце данных, если он успевает
+    /// Незаполненные байты 0xFF допишутся позже в тот же кусок
+    bool flushTail() {
+        const uint32_t size = offset - flushed;
+        if (size == 0) { return true; }
+        if (windowLeft() < static_cast<int32_t>(write_cost_us[0])) { return false; }
+
+        writeChunks(size);
+        return true;
+    }
+
+    /// Байты с позиции flushed: запись, замер, стирание в staging (куски из 0xFF не записываются)
+    void writeChunks(uint32_t size) {
+        uint8_t *data = staging + flushed % staging_size;
+
+        bool erased = true;
+        for (uint32_t i = 0; i < size; i++) {
+            if (data[i] != 0xFF) {
+                erased = false;
+                break;
+            }
+        }
+
+        if (not erased) {
+            const uint32_t start_us = micros();
+            esp_partition_write(partition, flushed, data, size);
+            const uint32_t end_us = micros();
+
+            const uint32_t cost_us = end_us - start_us;
+            write_cost_us[(size - 1) / chunk_size] = cost_us;
+
+            if (cost_us > max_write_us.load(std::memory_order_relaxed)) {
+                max_write_us.store(cost_us, std::memory_order_relaxed);
+            }
+
+            if (static_cast<int32_t>(end_us - (window_end_us.load(std::memory_order_relaxed) + wake_guard_us)) > 0) {
+                late_writes.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Целые куски записаны окончательно: место в staging снова стёрто
+        if (size % chunk_size == 0) {
+            std::memset(data, 0xFF, size);
+        }
+    }
+
+    void erase() {
+        const auto s = getState();
+
+        if (s == State::Disabled or s == State::Recording) {
+            Logger_warn("cannot erase now");
+            return;
+        }
+
+        Logger_info("erase");
+        state = State::Erasing;
+
+        if (esp_partition_erase_range(partition, 0, partition->size) != ESP_OK) {
+            Logger_error("erase fail");
+            state = State::EraseRequired;
+            return;
+        }
+
+        offset = 0;
+        flushed = 0;
+        session = 0;
+        std::memset(staging, 0xFF, sizeof(staging));
+        state = State::Idle;
+        Logger_debug("success");
+    }
+
+    void beginSession() {
+        session += 1;
+        sector_index = 0;
+        state = State::Recording;
+
+        // Сессия начинается с нового сектора
+        if (offset % sector_size != 0) {
+            nextSector();
+        }
+
+        Logger_info("session %u start at 0x%x", session, static_cast<unsigned>(offset));
+    }
+
+    void write(const Record &r) {
+        if (offset % sector_size == 0 and not beginSector()) { return; }
+
+        uint8_t encoded[max_encoded_size];
+        size_t size = encode(r, encoded);
+
+        if (offset % sector_size + size > sector_size) {
+            nextSector();
+            if (not beginSector()) { return; }
+            size = encode(r, encoded);
+        }
+
+        append(encoded, size);
+    }
+
+    /// Дельты от предыдущей записи сектора
+    size_t encode(const Record &r, uint8_t *out) {
+        size_t size = 1;
+
+        for (uint8_t f = 0; f < FieldsTotal; f++) {
+            const int32_t delta = r.fields[f] - previous[f];
+            previous[f] = r.fields[f];
+
+            // zigzag: малые по модулю дельты любого знака -> малые беззнаковые
+            auto value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+
+            while (value >= 0x80) {
+                out[size++] = static_cast<uint8_t>(value | 0x80);
+                value >>= 7;
+            }
+            out[size++] = static_cast<uint8_t>(value);
+        }
+
+        out[0] = static_cast<uint8_t>(size - 1);
+        return size;
+    }
+
+    /// Заголовок сектора по текущему смещению
+    /// false - раздел заполнен
+    bool beginSector() {
+        if (offset >= partition->size) {
+            state = State::Full;
+            Logger_warn("partition full");
+            return false;
+        }
+
+        std::memset(previous, 0, sizeof(previous));
+
+        const SectorHeader header{sector_magic, session, FieldsTotal, 0, sector_index};
+        sector_index += 1;
+
+        append(&header, sizeof(header));
+        return true;
+    }
+
+    /// Остаток сектора остаётся стёртым: его куски 0xFF не записываются
+    void nextSector() {
+        offset = (offset / sector_size + 1) * sector_size;
+    }
+
+    void append(const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+
+        for (size_t i = 0; i < size; i++) {
+            staging[offset % staging_size] = bytes[i];
+            offset += 1;
+        }
+    }
+
+    bool sectorErased(uint32_t sector) const {
+        uint8_t buffer[32];
+
+        for (uint32_t i = 0; i < sector_size; i += sizeof(buffer)) {
+            esp_partition_read(partition, sector + i, buffer, sizeof(buffer));
+
+            for (const auto b: buffer) {
+                if (b != 0xFF) { return false; }
+            }
+        }
+
+        return true;
+    }
+};
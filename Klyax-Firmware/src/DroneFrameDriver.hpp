@@ -1,11 +1,27 @@
 #pragma once
 
+#include <cmath>
+
 #include "tools/Logger.hpp"
-#include "Motor.hpp"
+#include "tools/mixer.hpp"
+#include "tools/Profiler.hpp"
+#include "tools/thrust.hpp"
+#include "MotorOutput.hpp"
 
 
 struct DroneFrameDriver {
 
+    /// Рама выбирается флагом сборки: KLYAX_FRAME_PLUS, KLYAX_FRAME_H, по умолчанию X
+    /// frame::HexX требует шести выходов ШИМ
+#if defined(KLYAX_FRAME_PLUS)
+    using Frame = frame::QuadPlus;
+#elif defined(KLYAX_FRAME_H)
+    using Frame = frame::QuadH;
+#else
+    using Frame = frame::QuadX;
+#endif
+
+    /// Выходы в порядке рамы X, у других рам - в порядке frame::*
     enum MotorIndex {
         /// M0
         /// Задний левый
@@ -31,18 +47,52 @@ struct DroneFrameDriver {
         TotalCount
     };
 
-    /// Конфигурация моторов (X-расположение)
-    const Motor motors[MotorIndex::TotalCount];
+    /// Команда режима полёта смесителю
+    struct Command {
+        float thrust, roll, pitch, yaw;
+    };
+
+    static_assert(TotalCount == MotorPwm::outputs_total, "motor output count mismatch");
+    static_assert(MatrixMixer<Frame>::motors_total == TotalCount, "frame needs a matching number of motor outputs");
+
+    /// Поправка пересчитывается при изменении больше чем на
+    static constexpr float voltage_factor_step = 0.005f;
+
+    MotorOutput output;
+
+    /// Кривая тяги моторов (Storage)
+    const ThrustLut &thrust_lut;
+
+    /// Последние команды моторам после смесителя [0.0 .. 1.0]
+    float commands[MotorIndex::TotalCount]{};
 
-    void init() const {
+private:
+
+    MatrixMixer<Frame> mixer{};
+
+    ThrustLinearizer linearizer{};
+
+    /// В, 0 - неизвестно
+    float supply_voltage{0};
+
+public:
+
+    DroneFrameDriver(const MotorOutput &output, const ThrustLut &thrust_lut) :
+        output{output}, thrust_lut{thrust_lut} {}
+
+    /// После загрузки кривой тяги
+    bool init() {
         Logger_info("init");
 
-        for (auto &m: motors) {
-            m.init();
-            m.write(0);
+        if (not output.init()) {
+            Logger_error("motor output init failed");
+            return false;
         }
 
+        reloadThrustLut();
+        disable();
         Logger_debug("success");
+        return true;
     }
 
     void mixin(
@@ -50,16 +100,52 @@ struct DroneFrameDriver {
         float roll,
         float pitch,
         float yaw
-    ) const {
-        motors[FrontLeft].write(thrust + roll - pitch - yaw);
-        motors[FrontRight].write(thrust - roll - pitch + yaw);
-        motors[BackLeft].write(thrust + roll + pitch + yaw);
-        motors[BackRight].write(thrust - roll + pitch - yaw);
+    ) {
+        Profiler_scope(Mixin);
+
+        // Поправка напряжения входит в потолок смесителя: airmode сжимает команды до него, а не упирается в период ШИМ
+        mixer.mix(thrust, roll, pitch, yaw, commands, linearizer.getThrustMax());
+
+        MotorPwm::Duty duty;
+        for (uint8_t i = 0; i < TotalCount; i++) { duty[i] = linearizer.toDuty(commands[i]); }
+        output.write(duty);
     }
 
-    void disable() const {
-        for (auto &m: motors) {
-            m.write(0);
-        }
+    inline void mixin(const Command &c) { mixin(c.thrust, c.roll, c.pitch, c.yaw); }
+
+    void disable() {
+        mixer.reset();
+        for (auto &command : commands) { command = 0; }
+
+        const MotorPwm::Duty duty{};
+        output.write(duty);
+    }
+
+    /// Пересчёт таблиц после изменения кривой тяги
+    void reloadThrustLut() {
+        linearizer.configure(thrust_lut, output.dutyMax(), voltageFactor(supply_voltage));
+    }
+
+    /// Управляющая задача: напряжение питания для поправки скважности
+    /// В
+    void setSupplyVoltage(float volts) {
+        supply_voltage = volts;
+
+        const float factor = voltageFactor(volts);
+        if (std::fabs(factor - linearizer.getVoltageFactor()) < voltage_factor_step) { return; }
+
+        linearizer.configure(thrust_lut, output.dutyMax(), factor);
+    }
+
+    inline float getVoltageFactor() const { return linearizer.getVoltageFactor(); }
+
+    inline float getCommand(MotorIndex index) const { return commands[index]; }
+
+    inline bool isAirmode() const { return mixer.isAirmode(); }
+
+private:
+
+    float voltageFactor(float volts) const {
+        return volts > 0 and thrust_lut.nominal_voltage > 0 ? thrust_lut.nominal_voltage / volts : 1.0f;
     }
 };
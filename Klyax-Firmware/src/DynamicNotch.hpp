@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "ela/vec3.hpp"
+
+#include "tools/fft.hpp"
+#include "tools/filters.hpp"
+#include "tools/Logger.hpp"
+#include "tools/Mailbox.hpp"
+#include "tools/Singleton.hpp"
+
+
+/// Динамические режекторные фильтры гироскопа
+/// Управляющая задача прореживает отсчёты гироскопа в очередь и применяет режекторы (NotchBank),
+/// фоновая задача считает спектр по каждой оси, отслеживает пики вибраций и публикует коэффициенты режекторов
+struct DynamicNotch final : Singleton<DynamicNotch> {
+    friend struct Singleton<DynamicNotch>;
+
+    static constexpr uint8_t axes_total = 3;
+
+    /// Режекторов на ось
+    static constexpr uint8_t peaks_per_axis = 2;
+
+    /// Размер окна БПФ
+    static constexpr size_t fft_size = 128;
+
+    /// Новых отсчётов между расчётами спектра
+    static constexpr size_t hop = fft_size / 4;
+
+    /// Частота анализа не выше (прореживание усреднением)
+    /// Гц
+    static constexpr float analysis_rate_max_hz = 1200.0f;
+
+    /// Диапазон поиска пиков
+    /// Гц
+    static constexpr float min_frequency_hz = 80.0f;
+
+    /// Доля частоты Найквиста
+    static constexpr float max_frequency_ratio = 0.9f;
+
+    /// Пик должен превышать среднюю мощность диапазона в
+    static constexpr float peak_threshold = 8.0f;
+
+    /// Сглаживание частоты пика между расчётами [0 .. 1]
+    static constexpr float frequency_smoothing = 0.3f;
+
+    /// Найденный пик ближе к отслеживаемой частоте, чем эта доля частоты (полоса режектора 1 / Q), - тот же пик
+    static constexpr float capture_ratio = 1.0f / 3.0f;
+
+    /// Добротность режектора
+    static constexpr float notch_q = 3.0f;
+
+    /// Период фоновой задачи
+    /// Мс
+    static constexpr uint32_t period_ms = 5;
+
+    /// Частота отсчётов на входе push и прореживание: меняются только вместе
+    struct Rate {
+        /// Гц
+        float input_hz;
+        uint8_t decimation;
+
+        /// Частота прореженных отсчётов
+        /// Гц
+        inline float analysisHz() const { return input_hz / static_cast<float>(decimation); }
+
+        inline bool operator==(const Rate &other) const { return input_hz == other.input_hz and decimation == other.decimation; }
+
+        inline bool operator!=(const Rate &other) const { return not(*this == other); }
+    };
+
+    /// Прореженный отсчёт и частота, на которой он получен
+    struct Sample {
+        /// Рад / с
+        float axis[axes_total];
+        Rate rate;
+    };
+
+    /// Публикуемые коэффициенты и частота, под которую они рассчитаны
+    struct Targets {
+        BiquadCoefficients<> notch[axes_total][peaks_per_axis];
+        Rate rate;
+    };
+
+private:
+
+    SpscQueue<Sample, 64> samples{};
+    TripleBuffer<Targets> targets{};
+
+    std::atomic<bool> enabled{true};
+
+    /// Состояние управляющей задачи: частота отсчётов и накопление для прореживания
+    /// В фоновую задачу частота уходит вместе с каждым отсчётом: смена не смешивает отсчёты двух частот
+    Rate input_rate{0, 1};
+    Sample accumulator{};
+    uint8_t accumulated{0};
+
+    /// Состояние фоновой задачи
+    RealSpectrum<fft_size> spectrum{};
+    float history[axes_total][fft_size]{};
+    float power[RealSpectrum<fft_size>::bins]{};
+    size_t write_index{0};
+    size_t fresh_samples{0};
+    Rate analysis_rate{0, 1};
+
+    /// Отслеживаемые частоты, 0 - режектор выключен
+    /// Гц
+    float peaks_hz[axes_total][peaks_per_axis]{};
+
+    uint32_t analyses{0};
+
+    /// Опубликованы ненулевые режекторы
+    bool active{false};
+
+public:
+
+    /// Управляющая задача: частота отсчётов, передаваемых в push
+    /// Гц
+    void setSampleRate(float hz) {
+        input_rate.input_hz = hz;
+        input_rate.decimation = static_cast<uint8_t>(std::max(1.0f, std::ceil(hz / analysis_rate_max_hz)));
+        accumulator = {};
+        accumulated = 0;
+    }
+
+    /// Вызывается из любой задачи
+    void setEnabled(bool on) {
+        enabled.store(on, std::memory_order_relaxed);
+        Logger_info("%s", on ? "on" : "off");
+    }
+
+    inline bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /// Управляющая задача: отсчёт гироскопа до фильтров
+    /// Рад / с
+    void push(const ela::vec3f &gyro) {
+        accumulator.axis[0] += gyro.x;
+        accumulator.axis[1] += gyro.y;
+        accumulator.axis[2] += gyro.z;
+        accumulated += 1;
+
+        if (accumulated < input_rate.decimation) { return; }
+
+        if (Sample *slot = samples.reserve()) {
+            const float k = 1.0f / static_cast<float>(accumulated);
+            for (uint8_t a = 0; a < axes_total; a++) { slot->axis[a] = accumulator.axis[a] * k; }
+            slot->rate = input_rate;
+            samples.commit();
+        }
+
+        accumulator = {};
+        accumulated = 0;
+    }
+
+    /// Управляющая задача: новые коэффициенты под текущую частоту отсчётов
+    /// nullptr - новых нет или они рассчитаны до смены частоты
+    const Targets *poll() {
+        if (not targets.fresh()) { return nullptr; }
+
+        const Targets &t = targets.read();
+        return t.rate == input_rate ? &t : nullptr;
+    }
+
+    /// Отслеживаемая частота
+    /// Гц, 0 - не найдена
+    /// Читается TUI без синхронизации, только для отображения
+    inline float getPeak(uint8_t axis, uint8_t index) const { return peaks_hz[axis][index]; }
+
+    inline uint32_t getAnalyses() const { return analyses; }
+
+    inline uint32_t getDropped() const { return samples.getDropped(); }
+
+    static void task(void *) {
+        auto &self = instance();
+
+        while (true) {
+            self.service();
+            vTaskDelay(pdMS_TO_TICKS(period_ms));
+        }
+    }
+
+private:
+
+    void service() {
+        while (const Sample *s = samples.front()) {
+            // Смена частоты: прежняя история и пики недействительны
+            if (s->rate != analysis_rate) {
+                analysis_rate = s->rate;
+                fresh_samples = 0;
+                clearPeaks();
+            }
+
+            for (uint8_t a = 0; a < axes_total; a++) { history[a][write_index] = s->axis[a]; }
+            write_index = (write_index + 1) & (fft_size - 1);
+            fresh_samples += 1;
+            samples.pop();
+        }
+
+        if (not isEnabled() or analysis_rate.input_hz <= 0) {
+            if (active) {
+                active = false;
+                clearPeaks();
+                publish();
+            }
+            return;
+        }
+
+        if (fresh_samples < fft_size) { return; }
+
+        // Окно заполнено: дальше пересчёт через каждые hop отсчётов
+        fresh_samples = fft_size - hop;
+
+        for (uint8_t a = 0; a < axes_total; a++) {
+            spectrum.compute(history[a], write_index, power);
+            track(peaks_hz[a]);
+        }
+
+        analyses += 1;
+        active = true;
+        publish();
+    }
+
+    /// Поиск пиков в спектре power и сопровождение частот
+    void track(float *tracked) {
+        const float analysis_hz = analysis_rate.analysisHz();
+        const float bin_hz = analysis_hz / static_cast<float>(fft_size);
+        const auto first = static_cast<size_t>(std::ceil(min_frequency_hz / bin_hz));
+        const auto last = std::min(
+            static_cast<size_t>(max_frequency_ratio * 0.5f * analysis_hz / bin_hz),
+            RealSpectrum<fft_size>::bins - 2
+        );
+
+        if (first < 1 or first >= last) { return; }
+
+        float mean = 0;
+        for (size_t k = first; k <= last; k++) { mean += power[k]; }
+        mean /= static_cast<float>(last - first + 1);
+
+        // Наибольшие локальные максимумы
+        float found_hz[peaks_per_axis]{};
+        float found_power[peaks_per_axis]{};
+
+        for (size_t k = first; k <= last; k++) {
+            const float p = power[k];
+            if (p < peak_threshold * mean or p <= power[k - 1] or p < power[k + 1]) { continue; }
+
+            // Уточнение положения пика параболой по трём полосам
+            const float denominator = power[k - 1] - 2.0f * p + power[k + 1];
+            const float offset = denominator != 0 ? 0.5f * (power[k - 1] - power[k + 1]) / denominator : 0.0f;
+            const float hz = (static_cast<float>(k) + offset) * bin_hz;
+
+            for (uint8_t i = 0; i < peaks_per_axis; i++) {
+                if (p <= found_power[i]) { continue; }
+
+                for (uint8_t j = peaks_per_axis - 1; j > i; j--) {
+                    found_power[j] = found_power[j - 1];
+                    found_hz[j] = found_hz[j - 1];
+                }
+
+                found_power[i] = p;
+                found_hz[i] = hz;
+                break;
+            }
+        }
+
+        // Пик - в слот с ближайшей отслеживаемой частотой (начиная с сильного пика): режектор не перескакивает между пиками
+        // Пик дальше полосы захвата от всех свободных слотов - новый: занимает пустой или потерявший свой пик слот без сглаживания
+        bool claimed[peaks_per_axis]{};
+
+        for (uint8_t i = 0; i < peaks_per_axis; i++) {
+            const float hz = found_hz[i];
+            if (hz <= 0) { break; }
+
+            uint8_t nearest = peaks_per_axis;
+            uint8_t vacant = peaks_per_axis;
+
+            for (uint8_t slot = 0; slot < peaks_per_axis; slot++) {
+                if (claimed[slot]) { continue; }
+
+                if (tracked[slot] <= 0) {
+                    if (vacant == peaks_per_axis) { vacant = slot; }
+                    continue;
+                }
+
+                if (nearest == peaks_per_axis or std::abs(hz - tracked[slot]) < std::abs(hz - tracked[nearest])) { nearest = slot; }
+            }
+
+            if (nearest < peaks_per_axis and std::abs(hz - tracked[nearest]) <= capture_ratio * tracked[nearest]) {
+                tracked[nearest] += (hz - tracked[nearest]) * frequency_smoothing;
+                claimed[nearest] = true;
+                continue;
+            }
+
+            const uint8_t slot = vacant < peaks_per_axis ? vacant : nearest;
+            tracked[slot] = hz;
+            claimed[slot] = true;
+        }
+    }
+
+    void clearPeaks() {
+        for (auto &axis : peaks_hz) {
+            for (auto &peak : axis) { peak = 0; }
+        }
+    }
+
+    void publish() {
+        Targets &t = targets.writeBuffer();
+        t.rate = analysis_rate;
+
+        // Режекторы стоят до прореживания: коэффициенты под входную частоту
+        for (uint8_t a = 0; a < axes_total; a++) {
+            for (uint8_t i = 0; i < peaks_per_axis; i++) {
+                t.notch[a][i] = BiquadCoefficients<>::notch(peaks_hz[a][i], analysis_rate.input_hz, notch_q);
+            }
+        }
+
+        targets.publish();
+    }
+};
+
+/// Режекторы в тракте гироскопа (управляющая задача)
+struct NotchBank final {
+
+private:
+
+    BiquadFilter<1> filters[DynamicNotch::axes_total][DynamicNotch::peaks_per_axis]{};
+
+public:
+
+    void retune(const DynamicNotch::Targets &targets) {
+        for (uint8_t a = 0; a < DynamicNotch::axes_total; a++) {
+            for (uint8_t i = 0; i < DynamicNotch::peaks_per_axis; i++) {
+                filters[a][i].retune(targets.notch[a][i]);
+            }
+        }
+    }
+
+    /// Сброс на выключенные режекторы (смена частоты отсчётов)
+    void reset() {
+        for (auto &axis : filters) {
+            for (auto &filter : axis) { filter.configure(BiquadCoefficients<>::passthrough()); }
+        }
+    }
+
+    ela::vec3f calc(const ela::vec3f &gyro) {
+        float v[DynamicNotch::axes_total]{gyro.x, gyro.y, gyro.z};
+
+        for (uint8_t a = 0; a < DynamicNotch::axes_total; a++) {
+            for (auto &filter : filters[a]) {
+                filter.calc(&v[a]);
+            }
+        }
+
+        return {v[0], v[1], v[2]};
+    }
+};
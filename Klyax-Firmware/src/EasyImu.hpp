@@ -2,24 +2,78 @@
 
 #include <Arduino.h>
 #include <ICM_20948.h>
+#include <atomic>
 #include <cmath>
 
 #include "ela/vec3.hpp"
 
+#include "DynamicNotch.hpp"
+#include "tools/attitude.hpp"
 #include "tools/filters.hpp"
 #include "tools/Logger.hpp"
+#include "tools/Profiler.hpp"
 
 
 struct EasyImu final {
 
 public:
 
+    /// Режим чтения датчика
+    enum class Mode : uint8_t {
+        /// Один отсчёт из регистров данных за цикл
+        /// Ожидание отсчёта по прерыванию INT (read, waitData): test_imu и прошивки без RateScheduler
+        Register,
+
+        /// Все накопленные в FIFO отсчёты одной пакетной транзакцией
+        /// DLPF включён, частота выборки 1125 Гц, прерывание INT выключено
+        /// Режим прошивки в полёте: цикл будит таймер RateScheduler, не датчик
+        Fifo,
+    };
+
+    /// Частота среза ФНЧ гироскопа (Butterworth 2-го порядка)
+    /// Гц
+    static constexpr float gyro_cutoff_hz = 200.0f;
+
+    /// Частота среза ФНЧ акселерометра (PT2)
+    /// Меньше задержка и сильнее подавление вибраций, чем у прежнего EMA 0.2 (test_filters)
+    /// Гц
+    static constexpr float accel_cutoff_hz = 80.0f;
+
     struct Settings {
         ela::vec3f gyro_bias;
         ela::vec3f accel_bias;
         ela::vec3f accel_scale;
     };
 
+    /// Калибровка смещения гироскопа по отсчётам, которые обрабатывает управляющая задача
+    /// Пишет только задача, читающая датчик: active читают другие задачи
+    struct GyroCalibrator {
+        ela::vec3f gyro_sum{};
+        int samples_total{0};
+        int samples_collected{0};
+        std::atomic<bool> active{false};
+
+        void onStart(int samples) {
+            gyro_sum = {};
+            samples_total = samples;
+            samples_collected = 0;
+            active = samples > 0;
+        }
+
+        void onSample(const ela::vec3f &gyro) {
+            gyro_sum = gyro_sum + gyro;
+            samples_collected += 1;
+        }
+
+        inline bool done() const { return samples_collected >= samples_total; }
+
+        void apply(Settings &s) const {
+            s.gyro_bias = gyro_sum * (1.0f / static_cast<float>(samples_total));
+        }
+    };
+
+    /// Калибровка акселерометра по 6 ориентациям
+    /// Пишет только задача, читающая датчик: current_orientation, active и paused читают другие задачи
     struct AccelCalibrator {
         static constexpr auto samples_per_orientation = 1000;
         static constexpr auto orientations_total = 6;
@@ -27,9 +81,9 @@ public:
         ela::vec3f accel_min{};
         ela::vec3f accel_max{};
         int samples_collected{0};
-        uint8_t current_orientation{0};
-        bool active{false};
-        bool paused{false}; // Флаг паузы для возможности перевернуть дрон
+        std::atomic<uint8_t> current_orientation{0};
+        std::atomic<bool> active{false};
+        std::atomic<bool> paused{false}; // Флаг паузы для возможности перевернуть дрон
 
         void onStart() {
             constexpr auto inf = std::numeric_limits<float>::infinity();
@@ -55,7 +109,7 @@ public:
 
         void onOrientationCollected() {
             samples_collected = 0;
-            current_orientation += 1;
+            current_orientation.store(current_orientation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
             paused = true;
         }
 
@@ -76,13 +130,80 @@ private:
 
     Settings &settings;
 
-    LowFrequencyFilter<ela::vec3f> accel_filter{0.2f};
-    LowFrequencyFilter<ela::vec3f> gyro_filter{0.35};
-    ComplementaryFilter<float> roll_filter{0.98f};
-    ComplementaryFilter<float> pitch_filter{0.98f};
-    float yaw{0.0f};
+    DynamicNotch &dynamic_notch{DynamicNotch::instance()};
+    NotchBank gyro_notch{};
+    BiquadFilter<3> gyro_filter{};
+    PtFilter<2, 3> accel_filter{};
+    AttitudeEstimator estimator{};
+
+    /// Алгоритм, выбранный из другой задачи: применяется перед следующим отсчётом
+    volatile AttitudeEstimator::Kind requested_fusion{AttitudeEstimator::Kind::Complementary};
+    GyroCalibrator gyro_calibrator{};
     AccelCalibrator accel_calibrator{};
 
+    enum class AccelCalibRequest : uint8_t {
+        None,
+        Start,
+        Resume,
+    };
+
+    /// Запросы калибровки из других задач: применяются в update() перед следующим отсчётом
+    /// Отсчётов калибровки гироскопа, 0 - нет запроса
+    std::atomic<int> gyro_calib_request{0};
+    std::atomic<AccelCalibRequest> accel_calib_request{AccelCalibRequest::None};
+
+    /// Максимальное ожидание отсчёта
+    static constexpr TickType_t data_timeout = pdMS_TO_TICKS(10);
+
+    /// Отсчёт готов: выдаётся прерыванием INT
+    /// Отдельный семафор, а не уведомление задачи: уведомлениями управляющую задачу будит RateScheduler
+    StaticSemaphore_t data_ready_semaphore_buffer{};
+    SemaphoreHandle_t data_ready_semaphore{nullptr};
+
+    /// Время прихода последнего отсчёта
+    /// Мкс
+    volatile uint32_t sample_timestamp_us{0};
+
+    /// Есть непрочитанный отсчёт
+    volatile bool data_ready{false};
+
+    /// Регистры банка 0 для работы с FIFO
+    static constexpr uint8_t reg_user_ctrl = 0x03;
+    static constexpr uint8_t reg_fifo_en_1 = 0x66;
+    static constexpr uint8_t reg_fifo_en_2 = 0x67;
+    static constexpr uint8_t reg_fifo_rst = 0x68;
+    static constexpr uint8_t reg_fifo_mode = 0x69;
+    static constexpr uint8_t reg_fifo_count_h = 0x70;
+    static constexpr uint8_t reg_fifo_r_w = 0x72;
+
+    static constexpr uint8_t user_ctrl_fifo_en = 0x40;
+    static constexpr uint8_t fifo_en_2_accel_gyro = 0x1E;
+
+    /// Кадр FIFO: ACCEL_XOUT_H .. GYRO_ZOUT_L, big-endian
+    static constexpr size_t fifo_frame_size = 12;
+    static constexpr size_t fifo_capacity = 512;
+    static constexpr size_t fifo_frames_max = fifo_capacity / fifo_frame_size;
+
+    /// Частота выборки в режиме FIFO
+    /// Гц
+    static constexpr float fifo_sample_rate_hz = 1125.0f;
+
+    /// Частота выборки в режиме Register без DLPF: акселерометр 4500 Гц, гироскоп 9000 Гц
+    /// Гц
+    static constexpr float register_data_rate_hz = 4500.0f;
+
+    /// Период выборки в режиме FIFO
+    /// Сек.
+    static constexpr float fifo_sample_dt = 1.0f / fifo_sample_rate_hz;
+
+    Mode mode{Mode::Register};
+
+    /// Гц
+    float register_sample_rate_hz{1000.0f};
+    uint8_t fifo_buffer[fifo_frames_max * fifo_frame_size]{};
+    uint8_t last_batch_size{0};
+    uint32_t fifo_overflows{0};
+
 public:
 
     ICM_20948_SPI imu{};
@@ -94,7 +215,9 @@ public:
         gpio_num_t sck,
         gpio_num_t miso,
         gpio_num_t mosi,
-        gpio_num_t cs
+        gpio_num_t cs,
+        gpio_num_t interrupt,
+        Mode read_mode = Mode::Register
     ) noexcept {
         Logger_info("init");
         SPI.begin(sck, miso, mosi, cs);
@@ -114,8 +237,13 @@ public:
         gyro_fss.g = dps2000;
         imu.setFullScale(ICM_20948_Internal_Gyr, gyro_fss);
 
-        imu.enableDLPF(ICM_20948_Internal_Acc, false);
-        imu.enableDLPF(ICM_20948_Internal_Gyr, false);
+        mode = read_mode;
+        configureFilters(mode == Mode::Fifo ? fifo_sample_rate_hz : register_sample_rate_hz);
+
+        // Делитель частоты выборки работает только с DLPF: в режиме FIFO частоты гироскопа и акселерометра совпадают
+        const bool dlpf = mode == Mode::Fifo;
+        imu.enableDLPF(ICM_20948_Internal_Acc, dlpf);
+        imu.enableDLPF(ICM_20948_Internal_Gyr, dlpf);
 
         ICM_20948_smplrt_t sample_rate;
         sample_rate.g = 0;
@@ -123,71 +251,70 @@ public:
         imu.setSampleRate(ICM_20948_Internal_Gyr, sample_rate);
         imu.setSampleRate(ICM_20948_Internal_Acc, sample_rate);
 
-        Logger_debug("success");
-        return true;
-    }
-
-    void calibrateGyro(int samples) noexcept {
-        Logger_info("start");
+        // В режиме FIFO отсчёты забираются по такту цикла: INT на каждый отсчёт (1125 Гц) никто не ждёт
+        // Будить цикл прерыванием датчика значило бы второй источник такта рядом с RateScheduler:
+        // частота цикла была бы привязана к 1125 Гц, а dt и фильтры - к периоду таймера
+        if (mode == Mode::Fifo) {
+            imu.intEnableRawDataReady(false);
+            setupFifo();
 
-        const auto s = static_cast<float>(samples);
-
-        ela::vec3f gyro_sum;
-
-        for (int i = 0; i < samples; i++) {
-            while (not imu.dataReady()) {}
-            imu.getAGMT();
-
-            gyro_sum.x += imu.gyrX();
-            gyro_sum.y += imu.gyrY();
-            gyro_sum.z += imu.gyrZ();
+            Logger_debug("success");
+            return true;
         }
 
-        settings.gyro_bias.x = gyro_sum.x / s;
-        settings.gyro_bias.y = gyro_sum.y / s;
-        settings.gyro_bias.z = gyro_sum.z / s;
-
-        Logger_debug("End");
-        Logger_debug("Gyro bias: %.4f %.4f %.4f", settings.gyro_bias.x, settings.gyro_bias.y, settings.gyro_bias.z);
-    }
+        data_ready_semaphore = xSemaphoreCreateBinaryStatic(&data_ready_semaphore_buffer);
 
-    inline void startAccelCalib() { accel_calibrator.onStart(); }
+        // INT: активный высокий, удерживается до любого чтения данных
+        imu.cfgIntActiveLow(false);
+        imu.cfgIntOpenDrain(false);
+        imu.cfgIntLatch(true);
+        imu.cfgIntAnyReadToClear(true);
 
-    inline uint8_t getAccelCalibOrientation() const { return accel_calibrator.current_orientation; }
+        pinMode(interrupt, INPUT);
+        attachInterruptArg(digitalPinToInterrupt(interrupt), EasyImu::onDataReady, this, RISING);
+        imu.intEnableRawDataReady(true);
 
-    inline bool isCalibratorActive() const { return accel_calibrator.active; }
+        // Сбросить INT, если он уже взведён: иначе фронта не будет
+        fetch();
 
-    inline bool isCalibratingAccel() const { return accel_calibrator.active and not accel_calibrator.paused; }
+        Logger_debug("success");
+        return true;
+    }
 
-    void resumeAccelCalib() {
-        accel_calibrator.paused = false;
+    /// Запуск калибровки гироскопа без блокировки
+    /// Вызывается из любой задачи: отсчёты собираются в update() той задачей, которая читает датчик
+    inline void startGyroCalib(int samples) {
+        Logger_info("start");
+        gyro_calib_request.store(samples, std::memory_order_relaxed);
     }
 
-    bool updateAccelCalib() {
-        if (not imu.dataReady()) { return false; }
+    /// С учётом ещё не применённого запроса
+    inline bool isCalibratingGyro() const {
+        return gyro_calib_request.load(std::memory_order_relaxed) > 0 or gyro_calibrator.active.load(std::memory_order_relaxed);
+    }
 
-        imu.getAGMT();
-        accel_calibrator.onSample(imu.accX(), imu.accY(), imu.accZ());
+    /// Блокирующая калибровка гироскопа: читает датчик до завершения
+    /// Нельзя вызывать, пока датчик читает другая задача
+    void calibrateGyro(int samples) noexcept {
+        startGyroCalib(samples);
 
-        if (accel_calibrator.samples_collected < AccelCalibrator::samples_per_orientation) { return false; }
+        while (isCalibratingGyro()) {
+            read(fifo_sample_dt);
+        }
+    }
 
-        accel_calibrator.onOrientationCollected();
+    /// Вызывается из любой задачи: отсчёты собираются в update()
+    /// Собрав отсчёты ориентации, калибровка встаёт на паузу до resumeAccelCalib
+    inline void startAccelCalib() { accel_calib_request.store(AccelCalibRequest::Start, std::memory_order_relaxed); }
 
-        if (accel_calibrator.current_orientation < AccelCalibrator::orientations_total) { return true; }
+    /// Вызывается из любой задачи
+    inline void resumeAccelCalib() { accel_calib_request.store(AccelCalibRequest::Resume, std::memory_order_relaxed); }
 
-        accel_calibrator.apply(settings);
-        accel_calibrator.onEnd();
+    inline uint8_t getAccelCalibOrientation() const { return accel_calibrator.current_orientation.load(std::memory_order_relaxed); }
 
-        Logger_debug(
-            "End\n"
-            "Bias: %f %f %f\n"
-            "Scale: %f %f %f",
-            settings.accel_bias.x, settings.accel_bias.y, settings.accel_bias.z,
-            settings.accel_scale.x, settings.accel_scale.y, settings.accel_scale.z
-        );
+    inline bool isCalibratorActive() const { return accel_calibrator.active.load(std::memory_order_relaxed); }
 
-        return true;
-    }
+    inline bool isCalibratingAccel() const { return isCalibratorActive() and not accel_calibrator.paused.load(std::memory_order_relaxed); }
 
 
     /// Система координат FLU (Forward Left Up)
@@ -257,43 +384,336 @@ public:
         inline float upAcceleration() const { return linear_acceleration.z; }
     };
 
+    /// Ожидает новые данные и обрабатывает их
+    /// dt используется в режиме Register, в режиме FIFO каждый отсчёт обрабатывается со своим периодом
     FLU read(float dt) noexcept {
+        if (mode == Mode::Fifo) {
+            // Без INT: за тик FreeRTOS (1 мс) в FIFO приходит хотя бы один отсчёт
+            vTaskDelay(1);
+        } else if (not waitData(data_timeout)) {
+            Logger_warn("data ready timeout");
+        }
+
+        return update(dt);
+    }
+
+    /// Обрабатывает накопленные данные без ожидания
+    /// Нет новых данных - возвращает предыдущий результат
+    FLU update(float dt) noexcept {
+        applyCalibRequests();
+
+        if (mode == Mode::Fifo) {
+            return readFifo();
+        }
+
+        if (not data_ready) {
+            last_batch_size = 0;
+            return last_flu;
+        }
+
+        {
+            Profiler_scope(ImuRead);
+            fetch();
+        }
+
+        last_batch_size = 1;
+
+        Profiler_scope(ImuProcess);
+        last_flu = process(
+            {imu.accX(), imu.accY(), imu.accZ()},
+            {imu.gyrX(), imu.gyrY(), imu.gyrZ()},
+            dt
+        );
+        return last_flu;
+    }
+
+    inline Mode getMode() const { return mode; }
+
+    /// Наибольшая частота цикла, при которой каждый такт получает новый отсчёт
+    /// Гц
+    inline float getMaxLoopRate() const { return mode == Mode::Fifo ? fifo_sample_rate_hz : register_data_rate_hz; }
+
+    /// Частота вызова update в режиме Register (один отсчёт за вызов): фильтры пересчитываются под неё
+    /// В режиме FIFO частота выборки постоянна, вызов ничего не меняет
+    /// Гц
+    void setLoopRate(float hz) {
+        register_sample_rate_hz = hz;
+
+        if (mode == Mode::Register) {
+            configureFilters(hz);
+        }
+    }
+
+    /// Выбор алгоритма оценки ориентации
+    /// Можно вызывать из любой задачи
+    inline void setFusion(AttitudeEstimator::Kind kind) { requested_fusion = kind; }
+
+    inline AttitudeEstimator::Kind getFusion() const { return requested_fusion; }
+
+    /// Кол-во отсчётов, обработанных последним вызовом read / update
+    inline uint8_t getLastBatchSize() const { return last_batch_size; }
+
+    /// Кол-во переполнений FIFO (потерянных пакетов отсчётов)
+    inline uint32_t getFifoOverflows() const { return fifo_overflows; }
+
+    /// Последний отсчёт акселерометра в системе датчика
+    /// mG
+    inline const ela::vec3f &getAccelRaw() const { return last_accel_raw; }
+
+    /// Последний отсчёт гироскопа в системе датчика
+    /// Град / с
+    inline const ela::vec3f &getGyroRaw() const { return last_gyro_raw; }
+
+private:
+
+    FLU last_flu{};
+
+    /// Последний обработанный отсчёт в системе датчика
+    /// mG
+    ela::vec3f last_accel_raw{};
+
+    /// Град / с
+    ela::vec3f last_gyro_raw{};
+
+    void configureFilters(float sample_rate_hz) noexcept {
+        gyro_filter.configure(BiquadCoefficients<>::lowpass(gyro_cutoff_hz, sample_rate_hz));
+        accel_filter.configure(accel_cutoff_hz, sample_rate_hz);
+
+        // Коэффициенты режекторов зависят от частоты: до нового анализа без режекторов
+        gyro_notch.reset();
+        dynamic_notch.setSampleRate(sample_rate_hz);
+    }
+
+    /// Обработка одного отсчёта
+    /// accel_raw: mG, gyro_raw: град / с в системе координат датчика
+    FLU process(const ela::vec3f &accel_raw, const ela::vec3f &gyro_raw, float dt) noexcept {
         constexpr float deg_to_rad = M_PI / 180.0f;
 
-        while (not imu.dataReady()) {}
+        last_accel_raw = accel_raw;
+        last_gyro_raw = gyro_raw;
 
-        imu.getAGMT();
+        if (gyro_calibrator.active.load(std::memory_order_relaxed)) {
+            updateGyroCalib(gyro_raw);
+        }
 
-        const ela::vec3f gyro = gyro_filter.calc((transformToFLU(-imu.gyrX(), -imu.gyrY(), -imu.gyrZ()) - settings.gyro_bias) * deg_to_rad);
+        if (isCalibratingAccel()) {
+            updateAccelCalib(accel_raw);
+        }
+
+        const ela::vec3f gyro_unfiltered = (transformToFLU(-gyro_raw.x, -gyro_raw.y, -gyro_raw.z) - settings.gyro_bias) * deg_to_rad;
+
+        // Спектр считается по сигналу до фильтров, режекторы стоят перед ФНЧ
+        dynamic_notch.push(gyro_unfiltered);
+        if (const DynamicNotch::Targets *targets = dynamic_notch.poll()) {
+            gyro_notch.retune(*targets);
+        }
+
+        const ela::vec3f gyro = gyro_filter.calc(gyro_notch.calc(gyro_unfiltered));
 
-        const ela::vec3f accel = accel_filter.calc(compMul(transformToFLU(imu.accX(), imu.accY(), imu.accZ()) - settings.accel_bias, settings.accel_scale));
+        const ela::vec3f accel = accel_filter.calc(compMul(transformToFLU(accel_raw.x, accel_raw.y, accel_raw.z) - settings.accel_bias, settings.accel_scale));
 
-        const float accel_roll = std::atan2(-accel.y, -accel.z);
-        const float accel_pitch = std::atan2(accel.x, std::hypot(accel.y, accel.z));
-        yaw += gyro.z * dt;
+        if (requested_fusion != estimator.getKind()) {
+            estimator.setKind(requested_fusion);
+        }
 
         return FLU{
-            .orientation = {
-                normalizeAngle(roll_filter.calc(accel_roll, gyro.x, dt)),
-                normalizeAngle(pitch_filter.calc(accel_pitch, gyro.y, dt)),
-                yaw
-            },
+            .orientation = estimator.update(gyro, accel, dt),
             .angular_velocity = gyro,
             .linear_acceleration = accel
         };
     }
 
-private:
+    void updateGyroCalib(const ela::vec3f &gyro_raw) noexcept {
+        gyro_calibrator.onSample(transformToFLU(-gyro_raw.x, -gyro_raw.y, -gyro_raw.z));
+
+        if (not gyro_calibrator.done()) { return; }
+
+        gyro_calibrator.apply(settings);
+        gyro_calibrator.active = false;
+
+        Logger_debug("Gyro bias: %.4f %.4f %.4f", settings.gyro_bias.x, settings.gyro_bias.y, settings.gyro_bias.z);
+    }
+
+    void updateAccelCalib(const ela::vec3f &accel_raw) noexcept {
+        accel_calibrator.onSample(accel_raw.x, accel_raw.y, accel_raw.z);
+
+        if (accel_calibrator.samples_collected < AccelCalibrator::samples_per_orientation) { return; }
+
+        // Номер ориентации читают другие задачи: не выходит за orientations_total - 1
+        if (accel_calibrator.current_orientation + 1 < AccelCalibrator::orientations_total) {
+            accel_calibrator.onOrientationCollected();
+            return;
+        }
+
+        accel_calibrator.apply(settings);
+        accel_calibrator.onEnd();
 
-    static float normalizeAngle(float angle) noexcept {
-        angle = static_cast<float>(std::fmod(angle + M_PI, M_TWOPI));
-        return static_cast<float>(angle >= 0 ? angle - M_PI : angle + M_PI);
+        Logger_debug(
+            "End\n"
+            "Bias: %f %f %f\n"
+            "Scale: %f %f %f",
+            settings.accel_bias.x, settings.accel_bias.y, settings.accel_bias.z,
+            settings.accel_scale.x, settings.accel_scale.y, settings.accel_scale.z
+        );
     }
 
+    /// Запросы калибровки из других задач
+    void applyCalibRequests() noexcept {
+        const int gyro_samples = gyro_calib_request.exchange(0, std::memory_order_relaxed);
+        if (gyro_samples > 0) {
+            gyro_calibrator.onStart(gyro_samples);
+        }
+
+        switch (accel_calib_request.exchange(AccelCalibRequest::None, std::memory_order_relaxed)) {
+            case AccelCalibRequest::Start:
+                accel_calibrator.onStart();
+                return;
+
+            case AccelCalibRequest::Resume:
+                accel_calibrator.paused = false;
+                return;
+
+            case AccelCalibRequest::None:
+                return;
+        }
+    }
+
+    FLU readFifo() noexcept {
+        // ±2 G: 16384 LSB / G; ±2000 dps: 16.4 LSB / dps
+        constexpr float accel_lsb_to_mg = 1.0f / 16.384f;
+        constexpr float gyro_lsb_to_dps = 1.0f / 16.4f;
+
+        data_ready = false;
+
+        {
+            Profiler_scope(ImuRead);
+            last_batch_size = drainFifo();
+        }
+
+        Profiler_scope(ImuProcess);
+
+        for (uint8_t i = 0; i < last_batch_size; i++) {
+            const uint8_t *frame = fifo_buffer + i * fifo_frame_size;
+
+            last_flu = process(
+                {
+                    wordAt(frame, 0) * accel_lsb_to_mg,
+                    wordAt(frame, 2) * accel_lsb_to_mg,
+                    wordAt(frame, 4) * accel_lsb_to_mg,
+                },
+                {
+                    wordAt(frame, 6) * gyro_lsb_to_dps,
+                    wordAt(frame, 8) * gyro_lsb_to_dps,
+                    wordAt(frame, 10) * gyro_lsb_to_dps,
+                },
+                fifo_sample_dt
+            );
+        }
+
+        return last_flu;
+    }
+
+    /// Прочитать все целые кадры FIFO: чтение счётчика и одна пакетная транзакция
+    /// Возвращает кол-во кадров в fifo_buffer
+    uint8_t drainFifo() noexcept {
+        uint8_t count_bytes[2]{};
+        imu.setBank(0);
+        imu.read(reg_fifo_count_h, count_bytes, sizeof(count_bytes));
+
+        const size_t count = ((count_bytes[0] & 0x1F) << 8) | count_bytes[1];
+
+        if (count >= fifo_capacity) {
+            fifo_overflows += 1;
+            resetFifo();
+            return 0;
+        }
+
+        const size_t frames = std::min(count / fifo_frame_size, fifo_frames_max);
+
+        if (frames > 0) {
+            imu.read(reg_fifo_r_w, fifo_buffer, frames * fifo_frame_size);
+        }
+
+        return static_cast<uint8_t>(frames);
+    }
+
+    void setupFifo() noexcept {
+        imu.setBank(0);
+
+        uint8_t user_ctrl{0};
+        imu.read(reg_user_ctrl, &user_ctrl, 1);
+
+        writeRegister(reg_fifo_en_1, 0x00);
+        writeRegister(reg_fifo_en_2, fifo_en_2_accel_gyro);
+
+        // Потоковый режим: при переполнении перезаписываются старые данные
+        writeRegister(reg_fifo_mode, 0x00);
+        writeRegister(reg_user_ctrl, user_ctrl | user_ctrl_fifo_en);
+        resetFifo();
+    }
+
+    void resetFifo() noexcept {
+        writeRegister(reg_fifo_rst, 0x1F);
+        writeRegister(reg_fifo_rst, 0x00);
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) noexcept {
+        imu.write(reg, &value, 1);
+    }
+
+    static inline float wordAt(const uint8_t *frame, size_t offset) {
+        return static_cast<int16_t>((frame[offset] << 8) | frame[offset + 1]);
+    }
+
+public:
+
+    /// Поворот осей датчика в FLU
     inline static ela::vec3f transformToFLU(float x, float y, float z) {
         return {-y, +x, -z};
     }
 
+    /// Время прихода последнего отсчёта (фронт INT), только режим Register
+    /// Мкс
+    inline uint32_t getSampleTimestamp() const { return sample_timestamp_us; }
+
+    /// Блокирует задачу до прихода нового отсчёта без опроса по SPI
+    /// Только режим Register: в режиме FIFO прерывание выключено
+    /// false - таймаут
+    bool waitData(TickType_t timeout) noexcept {
+        if (data_ready_semaphore == nullptr) { return false; }
+
+        // Семафор мог остаться выданным от уже прочитанного отсчёта: проверяется флаг
+        while (not data_ready) {
+            if (xSemaphoreTake(data_ready_semaphore, timeout) != pdTRUE) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    /// Прочитать отсчёт (сбрасывает INT)
+    void fetch() noexcept {
+        data_ready = false;
+        imu.getAGMT();
+    }
+
+    static void IRAM_ATTR onDataReady(void *arg) {
+        auto &self = *static_cast<EasyImu *>(arg);
+        self.sample_timestamp_us = micros();
+        self.data_ready = true;
+
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        xSemaphoreGiveFromISR(self.data_ready_semaphore, &higher_priority_task_woken);
+
+        if (higher_priority_task_woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+
+
     static ela::vec3f compMul(const ela::vec3f &a, const ela::vec3f &b) {
         return {
             a.x * b.x,
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <Arduino.h>
+
+#if not defined(KLYAX_NATIVE)
+#include <driver/ledc.h>
+#include <driver/mcpwm.h>
+#include <hal/ledc_ll.h>
+#include <hal/mcpwm_ll.h>
+#include <soc/ledc_struct.h>
+#include <soc/mcpwm_struct.h>
+
+#include "tools/Logger.hpp"
+#endif
+
+
+/// Выход ШИМ на моторы: скважности всех моторов пишутся одной пачкой
+/// Бэкенд выбирается флагом сборки:
+/// - по умолчанию LedcMotorOutput: регистры LEDC, общий таймер, защёлкивание на одной границе периода
+/// - KLYAX_MOTOR_MCPWM: McpwmMotorOutput, выше разрешение скважности
+/// - нативная сборка: ArduinoMotorOutput (ledcWrite читает модель SITL)
+struct MotorPwm final {
+
+    static constexpr uint8_t outputs_total = 4;
+
+    /// Гц
+    static constexpr uint32_t frequency_hz = 78000;
+
+    /// Скважности в тактах ШИМ [0 .. dutyMax()]: перевод тяги в такты - ThrustLinearizer
+    using Duty = uint32_t[outputs_total];
+
+    /// Запас до границы периода по записи, замеренной на месте (write_cycles - такты CPU):
+    /// вдвое больше записи, не меньше min_ticks и не больше четверти периода
+    /// Такты таймера ШИМ
+    static uint32_t latchMargin(uint32_t write_cycles, uint32_t cpu_mhz, uint32_t timer_mhz, uint32_t min_ticks, uint32_t period_ticks) {
+        const uint32_t write_ticks = (write_cycles * timer_mhz + cpu_mhz - 1) / cpu_mhz;
+        const uint32_t margin = 2 * write_ticks;
+        if (margin < min_ticks) { return min_ticks; }
+        if (margin > period_ticks / 4) { return period_ticks / 4; }
+        return margin;
+    }
+
+    /// Наибольшее время write_channels() из нескольких повторов
+    /// Такты CPU
+    template<typename W> static uint32_t measureWriteCycles(W &&write_channels) {
+        constexpr uint8_t repeats = 16;
+        uint32_t worst = 0;
+
+        for (uint8_t k = 0; k < repeats; k++) {
+            const uint32_t start = ESP.getCycleCount();
+            write_channels();
+            const uint32_t cycles = ESP.getCycleCount() - start;
+            worst = cycles > worst ? cycles : worst;
+        }
+
+        return worst;
+    }
+};
+
+/// Через API Arduino: каналы LEDC с номерами выводов, каждая запись применяется на своём периоде
+struct ArduinoMotorOutput final {
+
+    static constexpr uint8_t resolution_bits = 10;
+    static constexpr uint32_t duty_max = (1u << resolution_bits) - 1;
+
+private:
+
+    const uint8_t pins[MotorPwm::outputs_total];
+
+public:
+
+    /// Выводы в порядке DroneFrameDriver::MotorIndex
+    constexpr ArduinoMotorOutput(uint8_t m0, uint8_t m1, uint8_t m2, uint8_t m3) :
+        pins{m0, m1, m2, m3} {}
+
+    bool init() const {
+        for (auto pin : pins) {
+            if (ledcSetup(pin, MotorPwm::frequency_hz, resolution_bits) == 0) { return false; }
+            ledcAttachPin(pin, pin);
+            ledcWrite(pin, 0);
+        }
+        return true;
+    }
+
+    inline uint32_t dutyMax() const { return duty_max; }
+
+    void write(const MotorPwm::Duty &duty) const {
+        for (uint8_t i = 0; i < MotorPwm::outputs_total; i++) {
+            ledcWrite(pins[i], duty[i]);
+        }
+    }
+};
+
+#if not defined(KLYAX_NATIVE)
+
+/// Каналы LEDC высокоскоростной группы 0 .. 3 на одном таймере
+/// Скважность пишется в регистры канала, duty_start применяет её на ближайшем переполнении таймера:
+/// все четыре канала переключаются на одной границе периода
+struct LedcMotorOutput final {
+
+    static constexpr ledc_mode_t mode = LEDC_HIGH_SPEED_MODE;
+    static constexpr ledc_timer_t timer = LEDC_TIMER_0;
+
+    /// 80 МГц APB / 78 кГц: 10 бит
+    static constexpr uint8_t resolution_bits = 10;
+    static constexpr uint32_t period_ticks = 1u << resolution_bits;
+    static constexpr uint32_t duty_max = period_ticks - 1;
+
+    /// МГц
+    static constexpr uint32_t timer_mhz = 80;
+
+    /// Нижняя граница запаса до переполнения
+    /// Такты таймера (12.5 нс)
+    static constexpr uint32_t latch_margin_min_ticks = 32;
+
+private:
+
+    const uint8_t pins[MotorPwm::outputs_total];
+
+    /// Запас до переполнения: чтение счётчика и восемь чтений-записей регистров каналов через APB
+    /// не должны попасть на границу периода. Замеряется в init
+    /// Такты таймера (12.5 нс)
+    uint32_t latch_margin_ticks{period_ticks / 4};
+
+public:
+
+    /// Выводы в порядке DroneFrameDriver::MotorIndex
+    constexpr LedcMotorOutput(uint8_t m0, uint8_t m1, uint8_t m2, uint8_t m3) :
+        pins{m0, m1, m2, m3} {}
+
+    bool init() {
+        ledc_timer_config_t timer_config{};
+        timer_config.speed_mode = mode;
+        timer_config.duty_resolution = static_cast<ledc_timer_bit_t>(resolution_bits);
+        timer_config.timer_num = timer;
+        timer_config.freq_hz = MotorPwm::frequency_hz;
+        timer_config.clk_cfg = LEDC_USE_APB_CLK;
+
+        if (ledc_timer_config(&timer_config) != ESP_OK) { return false; }
+
+        for (uint8_t i = 0; i < MotorPwm::outputs_total; i++) {
+            ledc_channel_config_t channel_config{};
+            channel_config.gpio_num = pins[i];
+            channel_config.speed_mode = mode;
+            channel_config.channel = channel(i);
+            channel_config.intr_type = LEDC_INTR_DISABLE;
+            channel_config.timer_sel = timer;
+            channel_config.duty = 0;
+            channel_config.hpoint = 0;
+
+            if (ledc_channel_config(&channel_config) != ESP_OK) { return false; }
+
+            // Скважность меняется одним шагом: без плавного изменения
+            ledc_ll_set_duty_direction(&LEDC, mode, channel(i), LEDC_DUTY_DIR_INCREASE);
+            ledc_ll_set_duty_num(&LEDC, mode, channel(i), 1);
+            ledc_ll_set_duty_cycle(&LEDC, mode, channel(i), 1);
+            ledc_ll_set_duty_scale(&LEDC, mode, channel(i), 0);
+        }
+
+        // Моторы стоят: запись нулевых скважностей безопасна
+        static constexpr MotorPwm::Duty zero{};
+        const uint32_t write_cycles = MotorPwm::measureWriteCycles([]() {
+            (void) timerCount();
+            writeChannels(zero);
+        });
+        latch_margin_ticks = MotorPwm::latchMargin(write_cycles, ESP.getCpuFreqMHz(), timer_mhz, latch_margin_min_ticks, period_ticks);
+        Logger_info(
+            "write %u cycles, latch margin %u ticks",
+            static_cast<unsigned>(write_cycles), static_cast<unsigned>(latch_margin_ticks)
+        );
+
+        return true;
+    }
+
+    inline uint32_t dutyMax() const { return duty_max; }
+
+    inline uint32_t getLatchMarginTicks() const { return latch_margin_ticks; }
+
+    void write(const MotorPwm::Duty &duty) const {
+        // Вблизи переполнения дождаться начала следующего периода (не дольше latch_margin_ticks)
+        while (timerCount() >= period_ticks - latch_margin_ticks) {}
+
+        writeChannels(duty);
+    }
+
+private:
+
+    static constexpr ledc_channel_t channel(uint8_t index) { return static_cast<ledc_channel_t>(index); }
+
+    static inline uint32_t timerCount() { return LEDC.timer_group[mode].timer[timer].value.timer_cnt; }
+
+    static void writeChannels(const MotorPwm::Duty &duty) {
+        for (uint8_t i = 0; i < MotorPwm::outputs_total; i++) {
+            ledc_ll_set_duty_int_part(&LEDC, mode, channel(i), duty[i]);
+            ledc_ll_set_duty_start(&LEDC, mode, channel(i), true);
+        }
+    }
+};
+
+/// MCPWM0: операторы 0 и 1 (выходы A и B) на общем таймере 0
+/// Сравнения обновляются из теневых регистров на нуле таймера: все моторы переключаются на одной границе периода,
+/// если четыре записи не разделил ноль таймера - как у LEDC, вблизи конца периода запись ждёт следующего
+/// Таймер 160 МГц: ~2051 шаг скважности на 78 кГц против 1024 у LEDC
+struct McpwmMotorOutput final {
+
+    /// Гц
+    static constexpr uint32_t timer_resolution_hz = 160000000;
+
+    static constexpr mcpwm_unit_t unit = MCPWM_UNIT_0;
+
+    /// Нижняя граница запаса до конца периода (400 нс, как у LEDC)
+    /// Такты таймера (6.25 нс)
+    static constexpr uint32_t latch_margin_min_ticks = 64;
+
+private:
+
+    const uint8_t pins[MotorPwm::outputs_total];
+
+    /// Период таймера в тактах
+    uint32_t duty_max{0};
+
+    /// Запас до конца периода, замеряется в init
+    /// Такты таймера (6.25 нс)
+    uint32_t latch_margin_ticks{0};
+
+public:
+
+    /// Выводы в порядке DroneFrameDriver::MotorIndex
+    constexpr McpwmMotorOutput(uint8_t m0, uint8_t m1, uint8_t m2, uint8_t m3) :
+        pins{m0, m1, m2, m3} {}
+
+    bool init() {
+        static constexpr mcpwm_io_signals_t signals[MotorPwm::outputs_total]{MCPWM0A, MCPWM0B, MCPWM1A, MCPWM1B};
+
+        for (uint8_t i = 0; i < MotorPwm::outputs_total; i++) {
+            if (mcpwm_gpio_init(unit, signals[i], pins[i]) != ESP_OK) { return false; }
+        }
+
+        if (mcpwm_group_set_resolution(unit, timer_resolution_hz) != ESP_OK) { return false; }
+
+        mcpwm_config_t config{};
+        config.frequency = MotorPwm::frequency_hz;
+        config.cmpr_a = 0;
+        config.cmpr_b = 0;
+        config.counter_mode = MCPWM_UP_COUNTER;
+        config.duty_mode = MCPWM_DUTY_MODE_0;
+
+        for (auto t : {MCPWM_TIMER_0, MCPWM_TIMER_1}) {
+            if (mcpwm_timer_set_resolution(unit, t, timer_resolution_hz) != ESP_OK) { return false; }
+            if (mcpwm_init(unit, t, &config) != ESP_OK) { return false; }
+        }
+
+        // Оператор 1 считает от таймера 0: один счётчик на все выходы
+        mcpwm_ll_operator_select_timer(&MCPWM0, 1, 0);
+
+        for (int op = 0; op < 2; op++) {
+            for (int comparator = 0; comparator < 2; comparator++) {
+                mcpwm_ll_operator_enable_update_compare_on_tez(&MCPWM0, op, comparator, true);
+            }
+        }
+
+        duty_max = mcpwm_ll_timer_get_peak(&MCPWM0, 0, false);
+
+        // Моторы стоят: запись нулевых скважностей безопасна
+        static constexpr MotorPwm::Duty zero{};
+        const uint32_t write_cycles = MotorPwm::measureWriteCycles([]() {
+            (void) timerCount();
+            writeCompares(zero);
+        });
+        latch_margin_ticks = MotorPwm::latchMargin(
+            write_cycles, ESP.getCpuFreqMHz(), timer_resolution_hz / 1000000, latch_margin_min_ticks, duty_max
+        );
+        Logger_info(
+            "write %u cycles, latch margin %u ticks",
+            static_cast<unsigned>(write_cycles), static_cast<unsigned>(latch_margin_ticks)
+        );
+
+        return true;
+    }
+
+    /// Известен после init
+    inline uint32_t dutyMax() const { return duty_max; }
+
+    inline uint32_t getLatchMarginTicks() const { return latch_margin_ticks; }
+
+    void write(const MotorPwm::Duty &duty) const {
+        // Вблизи конца периода дождаться нуля таймера (не дольше latch_margin_ticks)
+        while (timerCount() >= duty_max - latch_margin_ticks) {}
+
+        writeCompares(duty);
+    }
+
+private:
+
+    static inline uint32_t timerCount() { return mcpwm_ll_timer_get_count_value(&MCPWM0, 0); }
+
+    static void writeCompares(const MotorPwm::Duty &duty) {
+        for (uint8_t i = 0; i < MotorPwm::outputs_total; i++) {
+            mcpwm_ll_operator_set_compare_value(&MCPWM0, i / 2, i % 2, duty[i]);
+        }
+    }
+};
+
+#endif
+
+#if defined(KLYAX_NATIVE)
+using MotorOutput = ArduinoMotorOutput;
+#elif defined(KLYAX_MOTOR_MCPWM)
+using MotorOutput = McpwmMotorOutput;
+#else
+using MotorOutput = LedcMotorOutput;
+#endif
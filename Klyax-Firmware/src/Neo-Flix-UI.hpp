@@ -4,9 +4,15 @@
 
 #include "Text-UI.hpp"
 #include "tools/PID.hpp"
+#include "tools/Profiler.hpp"
+#include "tools/Scheduler.hpp"
 #include "tools/Storage.hpp"
 
+#include "Battery.hpp"
+#include "Blackbox.hpp"
+#include "DynamicNotch.hpp"
 #include "EasyImu.hpp"
+#include "TelemetryStream.hpp"
 
 
 namespace nfui {
@@ -31,6 +37,26 @@ struct MainPage final : tui::Page, Singleton<MainPage> {
         Page{"Main"} {}
 };
 
+struct BatteryDisplay final : tui::Widget {
+    const Battery &battery;
+
+    explicit BatteryDisplay(const Battery &battery) :
+        battery{battery} {}
+
+    bool onEvent(tui::Event event) override { return false; }
+
+    void doRender(tui::TextStream &stream) const override {
+        const float volts = battery.getVoltage();
+
+        if (volts <= 0) {
+            stream.printf("Bat --");
+            return;
+        }
+
+        stream.printf("Bat %.2f V%s", volts, battery.isLow() ? " LOW" : "");
+    }
+};
+
 struct PidSettingsPage final : tui::Page {
     friend struct Singleton<PidSettingsPage>;
 
@@ -121,6 +147,7 @@ struct ImuPage final : tui::Page {
     tui::Button save;
     AccelCalibButton calib_accel;
     tui::Button calib_gyro;
+    tui::Button fusion;
     Vec3Display<float> accel_bias, accel_scale, gyro_bias;
 
     explicit ImuPage(Storage<EasyImu::Settings> &imu_storage, EasyImu &imu) :
@@ -133,7 +160,14 @@ struct ImuPage final : tui::Page {
         calib_accel{imu},
         calib_gyro{
             "Calib Gyro", [&imu](tui::Button &) {
-                imu.calibrateGyro(5000);
+                imu.startGyroCalib(5000);
+            }
+        },
+        fusion{
+            AttitudeEstimator::name(imu.getFusion()), [&imu](tui::Button &button) {
+                const auto next = static_cast<AttitudeEstimator::Kind>((static_cast<uint8_t>(imu.getFusion()) + 1) % AttitudeEstimator::kinds_total);
+                imu.setFusion(next);
+                button.label = AttitudeEstimator::name(next);
             }
         },
         accel_bias{imu_storage.settings.accel_bias},
@@ -144,10 +178,421 @@ struct ImuPage final : tui::Page {
         add(save);
         add(calib_gyro);
         add(calib_accel);
+        add(fusion);
         add(accel_bias);
         add(accel_scale);
         add(gyro_bias);
     }
 };
 
+struct JitterStatsDisplay final : tui::Widget {
+
+    enum class Row {
+        /// min / mean / max период
+        Period,
+
+        /// p99 период / пропущенные такты
+        Tail,
+    };
+
+    const JitterStats &stats;
+    const Row row;
+
+    explicit JitterStatsDisplay(const JitterStats &stats, Row row) :
+        stats{stats}, row{row} {}
+
+    bool onEvent(tui::Event event) override { return false; }
+
+    void doRender(tui::TextStream &stream) const override {
+        switch (row) {
+            case Row::Period:
+                stream.printf(
+                    "T %u/%u/%u us",
+                    static_cast<unsigned>(stats.getMin()),
+                    static_cast<unsigned>(stats.getMean()),
+                    static_cast<unsigned>(stats.getMax())
+                );
+                return;
+
+            case Row::Tail:
+                stream.printf(
+                    "p99 %u us ovr %u",
+                    static_cast<unsigned>(stats.percentile(0.99f)),
+                    static_cast<unsigned>(stats.getOverruns())
+                );
+                return;
+        }
+    }
+};
+
+/// Смена частоты цикла: запрос управляющей задаче
+/// Во включённом состоянии запрос отклоняется, подпись возвращается к действующей частоте
+/// Частоты выше ограничения планировщика (частота выборки датчика) пропускаются
+struct RateButton final : tui::Widget {
+    RateScheduler &scheduler;
+
+    explicit RateButton(RateScheduler &scheduler) :
+        scheduler{scheduler} {}
+
+    bool onEvent(tui::Event event) override {
+        if (event != tui::Event::Click) { return false; }
+
+        const uint8_t rates_allowed = static_cast<uint8_t>(scheduler.getMaxRate()) + 1;
+        const auto next = static_cast<RateScheduler::Rate>((static_cast<uint8_t>(scheduler.getRequestedRate()) + 1) % rates_allowed);
+        scheduler.requestRate(next);
+        return true;
+    }
+
+    void doRender(tui::TextStream &stream) const override {
+        stream.write('[');
+        stream.print(rateLabel(scheduler.getRequestedRate()));
+        stream.write(']');
+    }
+
+private:
+
+    static const char *rateLabel(RateScheduler::Rate r) {
+        switch (r) {
+            case RateScheduler::Rate::Hz500:
+                return "500 Hz";
+            case RateScheduler::Rate::Hz1000:
+                return "1 kHz";
+            case RateScheduler::Rate::Hz2000:
+                return "2 kHz";
+            case RateScheduler::Rate::Hz4000:
+                return "4 kHz";
+        }
+        return "?";
+    }
+};
+
+struct SchedulerPage final : tui::Page {
+
+    RateButton rate;
+    tui::Button reset;
+    JitterStatsDisplay period, tail;
+
+    explicit SchedulerPage(RateScheduler &scheduler) :
+        Page{"Loop"},
+        rate{scheduler},
+        reset{
+            "Reset", [&scheduler](tui::Button &) {
+                scheduler.requestStatsReset();
+            }
+        },
+        period{scheduler.getStats(), JitterStatsDisplay::Row::Period},
+        tail{scheduler.getStats(), JitterStatsDisplay::Row::Tail} {
+        MainPage::instance().link(*this);
+
+        add(rate);
+        add(reset);
+        add(period);
+        add(tail);
+    }
+};
+
+
+struct TelemetryStatsDisplay final : tui::Widget {
+
+    const TelemetryStream &stream;
+
+    explicit TelemetryStatsDisplay(const TelemetryStream &stream) :
+        stream{stream} {}
+
+    bool onEvent(tui::Event event) override { return false; }
+
+    void doRender(tui::TextStream &out) const override {
+        out.printf(
+            "sent %u drop %u",
+            static_cast<unsigned>(stream.getBatchesSent()),
+            static_cast<unsigned>(stream.getBatchesDropped())
+        );
+    }
+};
+
+struct TelemetryPage final : tui::Page {
+
+    tui::Button rate;
+    TelemetryStatsDisplay stats;
+
+    explicit TelemetryPage(TelemetryStream &stream) :
+        Page{"Telemetry"},
+        rate{
+            rateLabel(stream.getRate()), [&stream](tui::Button &button) {
+                const auto next = static_cast<TelemetryStream::Rate>((static_cast<uint8_t>(stream.getRate()) + 1) % 5);
+                stream.setRate(next);
+                button.label = rateLabel(next);
+            }
+        },
+        stats{stream} {
+        MainPage::instance().link(*this);
+
+        add(rate);
+        add(stats);
+    }
+
+private:
+
+    static const char *rateLabel(TelemetryStream::Rate r) {
+        switch (r) {
+            case TelemetryStream::Rate::Off:
+                return "Off";
+            case TelemetryStream::Rate::Hz50:
+                return "50 Hz";
+            case TelemetryStream::Rate::Hz100:
+                return "100 Hz";
+            case TelemetryStream::Rate::Hz200:
+                return "200 Hz";
+            case TelemetryStream::Rate::Hz500:
+                return "500 Hz";
+        }
+        return "?";
+    }
+};
+
+struct BlackboxStatsDisplay final : tui::Widget {
+
+    enum class Row {
+        /// Состояние и номер сессии
+        State,
+
+        /// Занято / всего, потерянные записи
+        Usage,
+
+        /// Самая долгая запись во FLASH, записи после пробуждения управляющей задачи
+        Flash,
+    };
+
+    const Blackbox &blackbox;
+    const Row row;
+
+    explicit BlackboxStatsDisplay(const Blackbox &blackbox, Row row) :
+        blackbox{blackbox}, row{row} {}
+
+    bool onEvent(tui::Event event) override { return false; }
+
+    void doRender(tui::TextStream &stream) const override {
+        switch (row) {
+            case Row::State:
+                stream.printf("%s s%u", stateLabel(blackbox.getState()), static_cast<unsigned>(blackbox.getSession()));
+                return;
+
+            case Row::Usage:
+                stream.printf(
+                    "%u/%u KB drop %u",
+                    static_cast<unsigned>(blackbox.getUsed() / 1024),
+                    static_cast<unsigned>(blackbox.getCapacity() / 1024),
+                    static_cast<unsigned>(blackbox.getDropped())
+                );
+                return;
+
+            case Row::Flash:
+                stream.printf(
+                    "wr %u us late %u",
+                    static_cast<unsigned>(blackbox.getMaxWriteUs()),
+                    static_cast<unsigned>(blackbox.getLateWrites())
+                );
+                return;
+        }
+    }
+
+private:
+
+    static const char *stateLabel(Blackbox::State s) {
+        switch (s) {
+            case Blackbox::State::Disabled:
+                return "Disabled";
+            case Blackbox::State::EraseRequired:
+                return "Need erase";
+            case Blackbox::State::Idle:
+                return "Idle";
+            case Blackbox::State::Recording:
+                return "Rec";
+            case Blackbox::State::Erasing:
+                return "Erasing";
+            case Blackbox::State::Full:
+                return "Full";
+        }
+        return "?";
+    }
+};
+
+struct BlackboxPage final : tui::Page {
+
+    tui::Button erase;
+    BlackboxStatsDisplay state, usage, flash;
+
+    explicit BlackboxPage(Blackbox &blackbox) :
+        Page{"Blackbox"},
+        erase{
+            "Erase", [&blackbox](tui::Button &) {
+                blackbox.requestErase();
+            }
+        },
+        state{blackbox, BlackboxStatsDisplay::Row::State},
+        usage{blackbox, BlackboxStatsDisplay::Row::Usage},
+        flash{blackbox, BlackboxStatsDisplay::Row::Flash} {
+        MainPage::instance().link(*this);
+
+        add(state);
+        add(usage);
+        add(flash);
+        add(erase);
+    }
+};
+
+/// Частоты режекторов одной оси
+struct NotchPeaksDisplay final : tui::Widget {
+
+    const DynamicNotch &notch;
+    const uint8_t axis;
+
+    NotchPeaksDisplay(const DynamicNotch &notch, uint8_t axis) :
+        notch{notch}, axis{axis} {}
+
+    bool onEvent(tui::Event event) override { return false; }
+
+    void doRender(tui::TextStream &out) const override {
+        static constexpr char names[DynamicNotch::axes_total] = {'x', 'y', 'z'};
+
+        out.printf(
+            "%c %3.0f %3.0f Hz",
+            names[axis],
+            notch.getPeak(axis, 0),
+            notch.getPeak(axis, 1)
+        );
+    }
+};
+
+struct NotchPage final : tui::Page {
+
+    tui::Button enable;
+    NotchPeaksDisplay x, y, z;
+
+    explicit NotchPage(DynamicNotch &notch) :
+        Page{"Notch"},
+        enable{
+            notch.isEnabled() ? "On" : "Off", [&notch](tui::Button &button) {
+                notch.setEnabled(not notch.isEnabled());
+                button.label = notch.isEnabled() ? "On" : "Off";
+            }
+        },
+        x{notch, 0}, y{notch, 1}, z{notch, 2} {
+        MainPage::instance().link(*this);
+
+        add(enable);
+        add(x);
+        add(y);
+        add(z);
+    }
+};
+
+#if defined(KLYAX_PROFILER)
+
+struct StageStatsDisplay final : tui::Widget {
+
+    enum class Row {
+        /// min / mean / max длительность этапа
+        Summary,
+
+        /// Гистограмма по корзинам 2^i тактов
+        Histogram,
+    };
+
+    /// Символы уровней гистограммы по возрастанию
+    static constexpr char levels[] = " .:-=+*#%@";
+    static constexpr uint8_t histogram_width = 12;
+
+    const Profiler::Stage stage;
+    const Row row;
+
+    explicit StageStatsDisplay(Profiler::Stage stage, Row row) :
+        stage{stage}, row{row} {}
+
+    bool onEvent(tui::Event event) override { return false; }
+
+    void doRender(tui::TextStream &stream) const override {
+        const auto &stats = Profiler::instance().stats(stage);
+
+        switch (row) {
+            case Row::Summary: {
+                const float cycles_to_us = 1.0f / static_cast<float>(ESP.getCpuFreqMHz());
+                stream.printf(
+                    "%s %.1f/%.1f/%.1f us",
+                    Profiler::name(stage),
+                    static_cast<float>(stats.getMin()) * cycles_to_us,
+                    static_cast<float>(stats.getMean()) * cycles_to_us,
+                    static_cast<float>(stats.getMax()) * cycles_to_us
+                );
+                return;
+            }
+
+            case Row::Histogram:
+                renderHistogram(stream, stats);
+                return;
+        }
+    }
+
+private:
+
+    static void renderHistogram(tui::TextStream &stream, const StageStats &stats) {
+        uint8_t first = 0;
+        while (first < StageStats::buckets_total and stats.getBucket(first) == 0) { first += 1; }
+
+        if (first == StageStats::buckets_total) {
+            stream.print("  -");
+            return;
+        }
+
+        const uint8_t end = std::min<uint8_t>(first + histogram_width, StageStats::buckets_total);
+
+        uint32_t peak = 0;
+        for (uint8_t i = first; i < end; i++) {
+            peak = std::max(peak, stats.getBucket(i));
+        }
+
+        stream.printf("  2^%u ", static_cast<unsigned>(first));
+
+        constexpr uint32_t levels_max = sizeof(levels) - 2;
+
+        for (uint8_t i = first; i < end; i++) {
+            const uint32_t count = stats.getBucket(i);
+            const uint32_t level = count == 0 ? 0 : 1 + (count - 1) * (levels_max - 1) / peak;
+            stream.write(levels[level]);
+        }
+    }
+};
+
+struct ProfilerPage final : tui::Page {
+
+    tui::Button reset;
+    std::vector<StageStatsDisplay> displays{};
+
+    explicit ProfilerPage() :
+        Page{"Profiler"},
+        reset{
+            "Reset", [](tui::Button &) {
+                Profiler::instance().requestReset();
+            }
+        } {
+        MainPage::instance().link(*this);
+
+        add(reset);
+
+        displays.reserve(Profiler::stages_total * 2);
+
+        for (uint8_t i = 0; i < Profiler::stages_total; i++) {
+            const auto stage = static_cast<Profiler::Stage>(i);
+            displays.emplace_back(stage, StageStatsDisplay::Row::Summary);
+            displays.emplace_back(stage, StageStatsDisplay::Row::Histogram);
+        }
+
+        for (auto &d: displays) {
+            add(d);
+        }
+    }
+};
+
+#endif
+
 }
\ No newline at end of file
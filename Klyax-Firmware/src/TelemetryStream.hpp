@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <Radio.hpp>
+#include <Telemetry.hpp>
+
+#include "tools/Logger.hpp"
+#include "tools/Mailbox.hpp"
+#include "tools/Singleton.hpp"
+
+
+/// Поток бинарной телеметрии
+/// Управляющая задача снимает отсчёты и набирает посылки, сервисная задача отправляет их по ESP-NOW
+/// Номер и время посылке ставит отправитель: все посылки аппарата нумеруются в порядке отправки
+struct TelemetryStream final : Singleton<TelemetryStream> {
+    friend struct Singleton<TelemetryStream>;
+
+    enum class Rate : uint8_t {
+        Off,
+        Hz50,
+        Hz100,
+        Hz200,
+        Hz500,
+    };
+
+    /// Гц
+    static constexpr uint32_t toHz(Rate rate) {
+        switch (rate) {
+            case Rate::Off:
+                return 0;
+            case Rate::Hz50:
+                return 50;
+            case Rate::Hz100:
+                return 100;
+            case Rate::Hz200:
+                return 200;
+            case Rate::Hz500:
+                return 500;
+        }
+        return 0;
+    }
+
+private:
+
+    /// Набранные посылки между задачами
+    SpscQueue<radio::FrameWriter, 8> batches{};
+
+    std::atomic<Rate> rate{Rate::Off};
+
+    /// Состояние управляющей задачи
+    radio::FrameWriter writer{};
+    uint32_t next_sample_us{0};
+
+    uint32_t batches_sent{0};
+
+public:
+
+    /// Вызывается из любой задачи
+    void setRate(Rate new_rate) {
+        rate.store(new_rate, std::memory_order_relaxed);
+        Logger_info("%u Hz", static_cast<unsigned>(toHz(new_rate)));
+    }
+
+    inline Rate getRate() const { return rate.load(std::memory_order_relaxed); }
+
+    /// Управляющая задача: пора снять отсчёт
+    bool due(uint32_t now_us) {
+        const auto hz = toHz(getRate());
+        if (hz == 0) { return false; }
+
+        if (static_cast<int32_t>(now_us - next_sample_us) < 0) { return false; }
+
+        const uint32_t period_us = 1000000 / hz;
+        next_sample_us += period_us;
+
+        // После паузы или смены частоты не догонять пропущенные отсчёты
+        if (static_cast<int32_t>(now_us - next_sample_us) >= 0) {
+            next_sample_us = now_us + period_us;
+        }
+
+        return true;
+    }
+
+    /// Управляющая задача: добавить отсчёт
+    void push(const telemetry::Sample &sample) {
+        writer.add(radio::Type::Telemetry, telemetry::encode(sample));
+        if (writer.getMessages() < telemetry::frames_per_batch) { return; }
+
+        batches.push(writer);
+        writer = {};
+    }
+
+    /// Сервисная задача: отправить накопленные посылки
+    /// send(radio::FrameWriter &) ставит номер, время и отправляет
+    template<typename S> void flush(S &&send) {
+        while (const radio::FrameWriter *batch = batches.front()) {
+            radio::FrameWriter frame = *batch;
+            batches.pop();
+
+            send(frame);
+            batches_sent += 1;
+        }
+    }
+
+    inline uint32_t getBatchesSent() const { return batches_sent; }
+
+    /// Пачки, не поместившиеся в очередь
+    inline uint32_t getBatchesDropped() const { return batches.getDropped(); }
+};
@@ -6,6 +6,7 @@
 #include <utility>
 #include <vector>
 #include <queue>
+#include <mutex>
 #include <functional>
 
 #include "tools/Singleton.hpp"
@@ -288,6 +289,8 @@ struct PageManager final : Singleton<PageManager> {
 
 private:
 
+    /// События приходят из обработчика ESP-NOW и задачи интерфейса
+    std::mutex events_mutex{};
     std::queue<Event> events{};
     TextStream stream{};
     Page *active_page{nullptr};
@@ -321,6 +324,7 @@ public:
     }
 
     void addEvent(Event event) {
+        const std::lock_guard<std::mutex> lock{events_mutex};
         events.push(event);
     }
 
@@ -329,13 +333,19 @@ public:
             return false;
         }
 
-        if (events.empty()) {
-            return false;
+        Event event;
+        {
+            const std::lock_guard<std::mutex> lock{events_mutex};
+
+            if (events.empty()) {
+                return false;
+            }
+
+            event = events.front();
+            events.pop();
         }
 
-        const bool render_required = active_page->onEvent(events.front());
-        events.pop();
-        return render_required;
+        return active_page->onEvent(event);
     }
 };
 
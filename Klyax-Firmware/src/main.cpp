@@ -6,13 +6,21 @@
 #include <WiFi.h>
 
 #include "espnow/Protocol.hpp"
+#include <Radio.hpp>
 
 #include "tools/Storage.hpp"
 #include "tools/Logger.hpp"
+#include "tools/Mailbox.hpp"
+#include "tools/Pipeline.hpp"
+#include "tools/Scheduler.hpp"
+#include "tools/Task.hpp"
 #include "tools/time.hpp"
 
+#include "Battery.hpp"
+#include "Blackbox.hpp"
 #include "DroneFrameDriver.hpp"
 #include "EasyImu.hpp"
+#include "TelemetryStream.hpp"
 #include "tools/PID.hpp"
 
 
@@ -55,19 +63,30 @@ struct DroneControl final {
     inline float yawVelocity() const { return yaw_power * power_to_angular_velocity; }
 };
 
-static DroneControl control{};
+/// Снимок управления с пульта
+struct ControlInput final {
 
-struct EspNowClient final : Singleton<EspNowClient> {
-    friend struct Singleton<EspNowClient>;
+    DroneControl control;
 
-    struct DualJoyControlPacket {
-        float left_x;
-        float left_y;
-        float right_x;
-        float right_y;
+    /// Время приёма пакета
+    /// Мкс
+    uint32_t timestamp_us;
 
-        bool mode_toggle;
-    };
+    /// Номер пакета, 0 - пакетов ещё не было
+    uint32_t sequence;
+
+    /// Возраст снимка
+    /// Мкс
+    inline uint32_t ageUs(uint32_t now_us) const { return now_us - timestamp_us; }
+};
+
+/// Задача Wi-Fi публикует снимки, управляющая задача читает последний
+static TripleBuffer<ControlInput> control_mailbox{};
+
+/// Обмен с пультом по ESP-NOW в формате radio (lib/Telemetry/src/Radio.hpp)
+/// Приём в задаче Wi-Fi: проверка посылки, отбрасывание старых и повторных, разбор сообщений таблицей переходов
+struct EspNowClient final : Singleton<EspNowClient> {
+    friend struct Singleton<EspNowClient>;
 
     enum MenuControlCode : uint8_t {
         Reload = 0x10,
@@ -78,8 +97,11 @@ struct EspNowClient final : Singleton<EspNowClient> {
         Down = 0x41
     };
 
+    /// Управление старше считается потерянным
+    /// Мкс
+    static constexpr uint32_t control_timeout_us = 200000;
+
     espnow::Mac target{0x78, 0x1c, 0x3c, 0xa4, 0x96, 0xdc};
-    PacketTimeoutManager timeout_manager{200};
 
     bool init() const {
         Logger_info("init");
@@ -91,19 +113,19 @@ struct EspNowClient final : Singleton<EspNowClient> {
 
         const auto init_result = espnow::Protocol::init();
         if (init_result.fail()) {
-            Logger_error(rs::toString(init_result.error));
+            Logger_error("%s", rs::toString(init_result.error));
             return false;
         }
 
         const auto peer_result = espnow::Peer::add(target);
         if (peer_result.fail()) {
-            Logger_error(rs::toString(peer_result.error));
+            Logger_error("%s", rs::toString(peer_result.error));
             return false;
         }
 
         const auto handler_result = espnow::Protocol::instance().setReceiveHandler(EspNowClient::onReceive);
         if (handler_result.fail()) {
-            Logger_error(rs::toString(handler_result.error));
+            Logger_error("%s", rs::toString(handler_result.error));
             return false;
         }
 
@@ -111,25 +133,67 @@ struct EspNowClient final : Singleton<EspNowClient> {
         return true;
     }
 
+    /// Сервисная задача: номер, время, контрольная сумма и отправка
+    void send(radio::FrameWriter &frame) {
+        const radio::Frame &sealed = frame.seal(tx_sequence, static_cast<uint32_t>(micros()));
+        tx_sequence += 1;
+        espnow::Protocol::send(target, sealed.data, sealed.size);
+    }
+
+    /// Посылки пульта: потерянные по пропускам номеров и отброшенные старые или повторные
+    inline const radio::SequenceTracker &getReceived() const { return rx_sequence; }
+
+    /// Отброшенные посылки: повреждённые, другой версии, неизвестные сообщения
+    inline uint32_t getRejected() const { return rejected; }
+
 private:
 
-    void onDualJoyControlPacket(const DualJoyControlPacket &packet) {
-        timeout_manager.update();
+    uint32_t control_sequence{0};
 
-        control.yaw_power = packet.left_x;
-        control.thrust = packet.left_y;
+    uint16_t tx_sequence{0};
 
-        control.roll_power = packet.right_x;
-        control.pitch_power = packet.right_y;
+    /// Состояние задачи Wi-Fi
+    radio::SequenceTracker rx_sequence{};
+    uint32_t rejected{0};
 
-        control.armed = packet.mode_toggle;
+    static void onControlMessage(EspNowClient &self, const uint8_t *payload, uint8_t size) {
+        if (size != sizeof(radio::ControlMessage)) {
+            self.rejected += 1;
+            return;
+        }
+
+        radio::ControlMessage message;
+        std::memcpy(&message, payload, sizeof(message));
+
+        self.control_sequence += 1;
+
+        control_mailbox.publish(ControlInput{
+            .control = {
+                .roll_power = message.right_x,
+                .pitch_power = message.right_y,
+                .yaw_power = message.left_x,
+                .thrust = message.left_y,
+                .armed = message.mode_toggle != 0,
+            },
+            .timestamp_us = static_cast<uint32_t>(micros()),
+            .sequence = self.control_sequence,
+        });
     }
 
-    static void onMenuCodePacket(MenuControlCode code) {
-        tui::PageManager::instance().addEvent(translateMenuCode(code));
+    static void onMenuMessage(EspNowClient &self, const uint8_t *payload, uint8_t size) {
+        if (size != sizeof(radio::MenuMessage)) {
+            self.rejected += 1;
+            return;
+        }
+
+        tui::PageManager::instance().addEvent(translateMenuCode(static_cast<MenuControlCode>(payload[0])));
     }
 
     static void onReceive(const espnow::Mac &mac, const void *data, rs::u8 size) {
+        static constexpr auto dispatcher = radio::Dispatcher<EspNowClient>{}
+            .on(radio::Type::Control, onControlMessage)
+            .on(radio::Type::Menu, onMenuMessage);
+
         auto &self = instance();
 
         if (mac != self.target) {
@@ -137,19 +201,23 @@ private:
             return;
         }
 
-        switch (size) {
-            case sizeof(DualJoyControlPacket):
-                self.onDualJoyControlPacket(*static_cast<const DualJoyControlPacket *>(data));
-                return;
-
-            case sizeof(MenuControlCode):
-                EspNowClient::onMenuCodePacket(*static_cast<const MenuControlCode *>(data));
-                return;
+        radio::Header header;
+        const auto status = radio::check(data, size, header);
 
-            default:
-                Logger_warn("invalid packet size (%d B)", size);
-                return;
+        if (status != radio::Status::Ok) {
+            self.rejected += 1;
+            Logger_warn("bad frame (%d B): %d", size, static_cast<int>(status));
+            return;
         }
+
+        // Запоздавшая посылка не должна перезаписать более новое управление
+        if (self.rx_sequence.accept(header.sequence) == radio::SequenceTracker::Order::Stale) { return; }
+
+        radio::forEach(data, header, [&self](uint8_t type, const uint8_t *payload, uint8_t message_size) {
+            if (not dispatcher.dispatch(self, type, payload, message_size)) {
+                self.rejected += 1;
+            }
+        });
     }
 
     static tui::Event translateMenuCode(MenuControlCode code) {
@@ -174,15 +242,21 @@ private:
     }
 };
 
+/// Кривая тяги 8520 на 1S: до замера на стенде - модель, таблица строится при компиляции
+static constexpr ThrustLut default_thrust_lut = ThrustLut::fromExpo(0.8f, 3.8f);
+
+static Storage<ThrustLut> thrust_lut_storage{"thrust", default_thrust_lut};
+
 static DroneFrameDriver frame_driver{
-    .motors={
-        Motor{12},
-        Motor{13},
-        Motor{14},
-        Motor{15},
-    }
+    MotorOutput{12, 13, 14, 15},
+    thrust_lut_storage.settings,
 };
 
+/// Замер кривой тяги с хоста (команда thrust-lut): управляющая задача применяет его без полёта,
+/// затем задача интерфейса сохраняет thrust_lut_storage
+static TripleBuffer<ThrustLut> thrust_lut_mailbox{};
+static std::atomic<bool> thrust_lut_applied{false};
+
 static Storage<EasyImu::Settings> imu_storage{
     "imu", {
         .gyro_bias = {},
@@ -191,61 +265,22 @@ static Storage<EasyImu::Settings> imu_storage{
     }
 };
 
+/// Режим полёта: interpret обязателен, остальное по умолчанию пустое
+/// Режимы вызываются через ModeSwitch по конкретному типу, без виртуальных функций
 struct Behavior {
-    virtual void interpret(
-        const DroneControl &c,
-        float dt,
-        const EasyImu::FLU &flu
-    ) = 0;
+    using Command = DroneFrameDriver::Command;
 
-    virtual void onDisarm() = 0;
-};
+    /// После выдачи команды моторам: работа, которая не должна задерживать команду
+    void afterMix(const DroneControl &c, float dt, const EasyImu::FLU &flu) {}
 
-struct BehaviorManager final : Singleton<BehaviorManager> {
-    friend struct Singleton<BehaviorManager>;
+    void onDisarm() {}
 
-private:
+    /// Частота вызова interpret: пересчёт фильтров
+    /// Гц
+    void onLoopRate(float hz) {}
 
-    Behavior *active_behavior{nullptr};
-
-public:
-
-    void bind(Behavior &behavior) {
-        active_behavior = &behavior;
-    }
-
-    bool isActive(const Behavior &behavior) const {
-        return &behavior == active_behavior;
-    }
-
-    void interpret(
-        const DroneControl &c,
-        float dt,
-        const EasyImu::FLU &flu
-    ) const {
-        if (active_behavior == nullptr) { return; }
-        active_behavior->interpret(c, dt, flu);
-    }
-
-    void onDisarm() const {
-        if (active_behavior == nullptr) { return; }
-        active_behavior->onDisarm();
-    }
-};
-
-struct ManualModeBehavior final : Behavior, Singleton<ManualModeBehavior> {
-    friend struct Singleton<ManualModeBehavior>;
-
-    void interpret(const DroneControl &c, float dt, const EasyImu::FLU &flu) override {
-        frame_driver.mixin(
-            c.thrust,
-            c.roll_power,
-            c.pitch_power,
-            c.yaw_power
-        );
-    }
-
-    void onDisarm() override {}
+    /// Режим стал активным (в полёте или без): сброс или передача состояния от прежнего режима
+    void onEnter() {}
 };
 
 struct AcrobaticModeBehavior final : Behavior, Singleton<AcrobaticModeBehavior> {
@@ -271,87 +306,760 @@ struct AcrobaticModeBehavior final : Behavior, Singleton<AcrobaticModeBehavior>
         }
     };
 
-    PID pitch_velocity_pid{
-        pitch_or_roll_velocity_pid_storage.settings,
-        0.2f,
+    /// Оси регуляторов угловой скорости
+    enum Axis : uint8_t {
+        Roll,
+        Pitch,
+        Yaw,
+        AxesTotal,
     };
 
-    PID roll_velocity_pid{
-        pitch_or_roll_velocity_pid_storage.settings,
-        0.2f
-    };
+    /// Частоты среза ФНЧ производной (PidBank::dx_q)
+    /// Меньше задержка на 30 Гц и сильнее подавление на 400 Гц, чем у прежних EMA 0.2 и 0.8 (test_filters)
+    /// Гц
+    static constexpr float roll_pitch_dx_cutoff_hz = 170.0f;
+    static constexpr float yaw_dx_cutoff_hz = 370.0f;
+
+    /// Гц
+    static constexpr float yaw_rate_cutoff_hz = 80.0f;
+
+    /// Упреждение по скорости изменения заданной угловой скорости
+    /// 1 / (Рад / с²)
+    static constexpr float roll_pitch_feed_forward = 0.0005f;
+    static constexpr float yaw_feed_forward = 0.0f;
+
+    /// Частота среза ФНЧ упреждения: уставка приходит с пульта ступенями раз в 20 мс,
+    /// без фильтра каждая ступень - выброс в один такт, его высота растёт с частотой цикла
+    /// Гц
+    static constexpr float feed_forward_cutoff_hz = 50.0f;
+
+    PidBank<AxesTotal> velocity_pid{{roll_pitch_dx_cutoff_hz, roll_pitch_dx_cutoff_hz, yaw_dx_cutoff_hz}, 1000, feed_forward_cutoff_hz};
 
-    PID yaw_velocity_pid{
-        yaw_velocity_pid_storage.settings,
-        0.8f,
+    PtFilter<1, 1> yaw_rate_filter{};
+
+    /// Настройки осей целиком: интерфейс (ядро 0) публикует, управляющая задача применяет
+    struct Gains {
+        PID::Settings roll_pitch, yaw;
     };
 
-    LowFrequencyFilter<float> yaw_error_filter{0.4f};
+    TripleBuffer<Gains> gains_mailbox{};
 
     void init() {
         pitch_or_roll_velocity_pid_storage.load();
         yaw_velocity_pid_storage.load();
+        publishGains();
+        applyGains();
+    }
+
+    /// Задача интерфейса: снимок настроек (их меняет интерфейс) для управляющей задачи
+    void publishGains() {
+        gains_mailbox.publish({
+            pitch_or_roll_velocity_pid_storage.settings,
+            yaw_velocity_pid_storage.settings,
+        });
     }
 
-    void interpret(const DroneControl &c, float dt, const EasyImu::FLU &flu) override {
-        const float roll = roll_velocity_pid.calc(
-            control.rollVelocity() - flu.rollVelocity(),
-            dt
-        );
+    /// Управляющая задача: новые настройки в банк регуляторов, между вызовами calc
+    void applyGains() {
+        if (not gains_mailbox.fresh()) { return; }
+
+        const Gains &gains = gains_mailbox.read();
+        velocity_pid.setGains(Roll, gains.roll_pitch, roll_pitch_feed_forward);
+        velocity_pid.setGains(Pitch, gains.roll_pitch, roll_pitch_feed_forward);
+        velocity_pid.setGains(Yaw, gains.yaw, yaw_feed_forward);
+    }
 
-        const float pitch = pitch_velocity_pid.calc(
-            control.pitchVelocity() - flu.pitchVelocity(),
-            dt
-        );
+    Command interpret(const DroneControl &c, float dt, const EasyImu::FLU &flu) {
+        const float setpoint[AxesTotal]{
+            c.rollVelocity(),
+            c.pitchVelocity(),
+            c.yawVelocity(),
+        };
+
+        return driveRates(c.thrust, setpoint, dt, flu);
+    }
+
+    /// Контур угловой скорости: уставки -> команда смесителю
+    /// setpoint: Рад / с по осям Axis
+    Command driveRates(float thrust, const float (&setpoint)[AxesTotal], float dt, const EasyImu::FLU &flu) {
+        applyGains();
+
+        const float measurement[AxesTotal]{
+            flu.rollVelocity(),
+            flu.pitchVelocity(),
+            yaw_rate_filter.calc(flu.yawVelocity()),
+        };
+
+        float output[AxesTotal];
+        velocity_pid.calc(setpoint, measurement, dt, output);
+
+        return {
+            thrust,
+            output[Roll],
+            output[Pitch],
+            -output[Yaw],
+        };
+    }
 
-        const float yaw = -yaw_velocity_pid.calc(
-            yaw_error_filter.calc(control.yawVelocity() - flu.yawVelocity()),
-            dt
-        );
+    void onLoopRate(float hz) {
+        velocity_pid.setSampleRate(hz);
+        yaw_rate_filter.configure(yaw_rate_cutoff_hz, hz);
+    }
 
-        frame_driver.mixin(
-            control.thrust,
-            roll,
-            pitch,
-            yaw
-        );
+    void onDisarm() {
+        velocity_pid.reset();
+        yaw_rate_filter.reset();
+        rates_stale = false;
     }
 
-    void onDisarm() override {
-        pitch_velocity_pid.reset();
-        roll_velocity_pid.reset();
-        yaw_velocity_pid.reset();
-        yaw_error_filter.reset();
+    /// Контур угловой скорости общий с AngleModeBehavior: между ними интегралы передаются как есть,
+    /// после ручного режима - сброс
+    void onEnter() {
+        if (not rates_stale) { return; }
+
+        onDisarm();
+    }
+
+    /// Ручной режим: контур угловой скорости не работает, его состояние устаревает
+    inline void suspendRates() { rates_stale = true; }
+
+private:
+
+    bool rates_stale{false};
+};
+
+struct ManualModeBehavior final : Behavior, Singleton<ManualModeBehavior> {
+    friend struct Singleton<ManualModeBehavior>;
+
+    Command interpret(const DroneControl &c, float dt, const EasyImu::FLU &flu) {
+        return {
+            c.thrust,
+            c.roll_power,
+            c.pitch_power,
+            c.yaw_power,
+        };
+    }
+
+    void onEnter() {
+        AcrobaticModeBehavior::instance().suspendRates();
+    }
+};
+
+/// Режим горизонта (self-level)
+/// Внешний контур превращает ошибку угла в уставки угловой скорости для контура AcrobaticModeBehavior
+/// Внешний контур считается раз в outer_divisor циклов в afterMix, после команды моторам: внутренний контур его не ждёт
+struct AngleModeBehavior final : Behavior, Singleton<AngleModeBehavior> {
+    friend struct Singleton<AngleModeBehavior>;
+
+    /// Выход: Рад / с на Рад ошибки угла, предел - наибольшая угловая скорость
+    Storage<PID::Settings> angle_pid_storage{
+        "pid-a", PID::Settings{
+            .p = 6.0f,
+            .i = 0.0f,
+            .d = 0.0f,
+            .i_limit = 0.0f,
+            .output_abs_max = DroneControl::power_to_angular_velocity,
+        }
+    };
+
+    /// Угол при отклонении стика до упора
+    /// Рад
+    static constexpr float max_angle = 30 * DEG_TO_RAD;
+
+    /// Делитель внешнего контура - степень двойки: 1 / 2 / 4 / 8
+    static constexpr uint8_t outer_divisor_max = 8;
+
+private:
+
+    enum Axis : uint8_t {
+        Roll,
+        Pitch,
+        AxesTotal,
+    };
+
+    AcrobaticModeBehavior &rates{AcrobaticModeBehavior::instance()};
+
+    PidBank<AxesTotal> angle_pid{{0.0f, 0.0f}};
+
+    /// Настройки от интерфейса (ядро 0): применяются на такте внешнего контура
+    TripleBuffer<PID::Settings> gains_mailbox{};
+
+    /// Делитель, выбранный из другой задачи: применяется на следующем такте внешнего контура
+    std::atomic<uint8_t> requested_divisor{4};
+    uint8_t outer_divisor{4};
+    uint8_t ticks{0};
+
+    /// Время с прошлого такта внешнего контура
+    /// Сек.
+    float outer_dt{0};
+
+    /// Гц
+    float loop_rate_hz{1000.0f};
+
+    /// Уставки внутреннего контура до следующего такта внешнего
+    /// Рад / с
+    float rate_setpoint[AxesTotal]{};
+
+    /// Режим только что включён: внешний контур считается до первого такта внутреннего
+    bool entering{false};
+
+public:
+
+    void init() {
+        angle_pid_storage.load();
+        publishGains();
+        applyGains();
+    }
+
+    /// Задача интерфейса: снимок настроек (их меняет интерфейс) для управляющей задачи
+    void publishGains() {
+        gains_mailbox.publish(angle_pid_storage.settings);
+    }
+
+    /// Вызывается из любой задачи
+    /// [1 .. outer_divisor_max], не степень двойки - ближайшая меньшая
+    void setOuterDivisor(uint8_t divisor) {
+        divisor = constrain(divisor, 1, outer_divisor_max);
+        requested_divisor.store(static_cast<uint8_t>(1u << (31 - __builtin_clz(divisor))), std::memory_order_relaxed);
+    }
+
+    inline uint8_t getOuterDivisor() const { return requested_divisor.load(std::memory_order_relaxed); }
+
+    Command interpret(const DroneControl &c, float dt, const EasyImu::FLU &flu) {
+        // Уставки прежнего включения режима устарели
+        if (entering) {
+            entering = false;
+            outer_dt = dt;
+            outerStep(c, flu);
+        }
+
+        const float setpoint[AcrobaticModeBehavior::AxesTotal]{
+            rate_setpoint[Roll],
+            rate_setpoint[Pitch],
+            c.yawVelocity(),
+        };
+
+        return rates.driveRates(c.thrust, setpoint, dt, flu);
+    }
+
+    void afterMix(const DroneControl &c, float dt, const EasyImu::FLU &flu) {
+        outer_dt += dt;
+        ticks += 1;
+        if (ticks < outer_divisor) { return; }
+
+        outerStep(c, flu);
+    }
+
+    void onLoopRate(float hz) {
+        loop_rate_hz = hz;
+        rates.onLoopRate(hz);
+        angle_pid.setSampleRate(hz / static_cast<float>(outer_divisor));
+    }
+
+    void onDisarm() {
+        rates.onDisarm();
+        angle_pid.reset();
+        ticks = 0;
+        outer_dt = 0;
+        rate_setpoint[Roll] = 0;
+        rate_setpoint[Pitch] = 0;
+    }
+
+    /// Интегралы контура угловой скорости - от AcrobaticModeBehavior, внешний контур - с нуля
+    void onEnter() {
+        rates.onEnter();
+        angle_pid.reset();
+        ticks = 0;
+        outer_dt = 0;
+        entering = true;
+    }
+
+private:
+
+    void outerStep(const DroneControl &c, const EasyImu::FLU &flu) {
+        Profiler_scope(Outer);
+
+        applyGains();
+
+        const float target[AxesTotal]{
+            c.roll_power * max_angle,
+            c.pitch_power * max_angle,
+        };
+
+        const float angle[AxesTotal]{
+            flu.roll(),
+            flu.pitch(),
+        };
+
+        angle_pid.calc(target, angle, outer_dt, rate_setpoint);
+        ticks = 0;
+        outer_dt = 0;
+
+        const uint8_t divisor = requested_divisor.load(std::memory_order_relaxed);
+        if (divisor != outer_divisor) {
+            outer_divisor = divisor;
+            angle_pid.setSampleRate(loop_rate_hz / static_cast<float>(outer_divisor));
+        }
+    }
+
+    /// Управляющая задача: новые настройки в регуляторы, между вызовами calc
+    void applyGains() {
+        if (not gains_mailbox.fresh()) { return; }
+
+        const PID::Settings &settings = gains_mailbox.read();
+        angle_pid.setGains(Roll, settings, 0.0f);
+        angle_pid.setGains(Pitch, settings, 0.0f);
     }
 };
 
 static EasyImu imu{imu_storage.settings};
 
+/// Режимы полёта, переключаются из интерфейса
+using FlightModes = ModeSwitch<AcrobaticModeBehavior, AngleModeBehavior, ManualModeBehavior>;
+
+static FlightModes flight_modes{
+    AcrobaticModeBehavior::instance(),
+    AngleModeBehavior::instance(),
+    ManualModeBehavior::instance(),
+};
+
+static FlightPipeline<EasyImu, FlightModes, DroneFrameDriver> pipeline{imu, flight_modes, frame_driver};
+
+/// Управляющий цикл: IMU -> режим полёта -> DroneFrameDriver
+/// Единственная задача на ядре 1, владеет шиной SPI датчика
+static constexpr TaskConfig control_task{
+    .name = "control",
+    .stack_size = 4096,
+    .priority = 20,
+    .core = 1,
+};
+
+/// Интерфейс, ответы по ESP-NOW, сохранение настроек
+/// Ядро 0 рядом со стеком Wi-Fi (приоритет 23), ниже его по приоритету
+static constexpr TaskConfig service_task{
+    .name = "service",
+    .stack_size = 8192,
+    .priority = 3,
+    .core = 0,
+};
+
+/// Вывод журнала в Serial: вызовы Logger_* только пишут в буфер
+static constexpr TaskConfig logger_task{
+    .name = "logger",
+    .stack_size = 3072,
+    .priority = 1,
+    .core = 0,
+};
+
+/// Запись самописца во FLASH: самый низкий приоритет на ядре 0
+static constexpr TaskConfig blackbox_task{
+    .name = "blackbox",
+    .stack_size = 4096,
+    .priority = 1,
+    .core = 0,
+};
+
+/// Анализ спектра гироскопа для динамических режекторов
+/// Ядро 0, выше самописца и журнала, ниже интерфейса
+static constexpr TaskConfig notch_task{
+    .name = "notch",
+    .stack_size = 4096,
+    .priority = 2,
+    .core = 0,
+};
+
+/// Измерение напряжения батареи: самый низкий приоритет, период Battery::period_ms
+static constexpr TaskConfig battery_task{
+    .name = "battery",
+    .stack_size = 2048,
+    .priority = 1,
+    .core = 0,
+};
+
+/// Период задачи интерфейса
+/// Мс
+static constexpr uint32_t service_period_ms = 10;
+
+
 static void fatal() {
     Logger_fatal("Fatal Error. Reboot in 5s");
+    Logger::instance().flush();
     delay(5000);
     ESP.restart();
 }
 
+static void captureTelemetry(const EasyImu::FLU &flu) {
+    static auto &scheduler = RateScheduler::instance();
+    static auto &acrobatic = AcrobaticModeBehavior::instance();
+
+    telemetry::Sample sample{};
+    sample.timestamp_us = scheduler.getLastWake();
+
+    for (uint8_t a = 0; a < telemetry::AxesTotal; a++) {
+        const auto terms = acrobatic.velocity_pid.getTerms(a);
+        sample.pid[a][telemetry::P] = terms.p;
+        sample.pid[a][telemetry::I] = terms.i;
+        sample.pid[a][telemetry::D] = terms.d;
+    }
+
+    sample.orientation[telemetry::Roll] = flu.roll();
+    sample.orientation[telemetry::Pitch] = flu.pitch();
+    sample.orientation[telemetry::Yaw] = flu.yaw();
+
+    sample.rates[telemetry::Roll] = flu.rollVelocity();
+    sample.rates[telemetry::Pitch] = flu.pitchVelocity();
+    sample.rates[telemetry::Yaw] = flu.yawVelocity();
+
+    for (uint8_t m = 0; m < telemetry::motors_total; m++) {
+        sample.motors[m] = frame_driver.getCommand(static_cast<DroneFrameDriver::MotorIndex>(m));
+    }
+
+    sample.period_us = static_cast<uint16_t>(std::min<uint32_t>(scheduler.getLastPeriod(), UINT16_MAX));
+    sample.busy_us = static_cast<uint16_t>(std::min<uint32_t>(micros() - scheduler.getLastWake(), UINT16_MAX));
+    sample.battery = Battery::instance().getVoltage();
+
+    TelemetryStream::instance().push(sample);
+}
+
+static void captureBlackbox(const EasyImu::FLU &flu, const DroneControl &c) {
+    static auto &scheduler = RateScheduler::instance();
+    static auto &acrobatic = AcrobaticModeBehavior::instance();
+
+    using F = Blackbox::Field;
+    using S = Blackbox::Scale;
+
+    Blackbox::Record r;
+    r.fields[F::TimeUs] = static_cast<int32_t>(scheduler.getLastWake());
+
+    const auto &gyro = imu.getGyroRaw();
+    r.set(F::GyroX, gyro.x, S::gyro);
+    r.set(F::GyroY, gyro.y, S::gyro);
+    r.set(F::GyroZ, gyro.z, S::gyro);
+
+    const auto &accel = imu.getAccelRaw();
+    r.set(F::AccelX, accel.x, S::accel);
+    r.set(F::AccelY, accel.y, S::accel);
+    r.set(F::AccelZ, accel.z, S::accel);
+
+    r.set(F::Roll, flu.roll(), S::angle);
+    r.set(F::Pitch, flu.pitch(), S::angle);
+    r.set(F::Yaw, flu.yaw(), S::angle);
+
+    r.set(F::RollRate, flu.rollVelocity(), S::rate);
+    r.set(F::PitchRate, flu.pitchVelocity(), S::rate);
+    r.set(F::YawRate, flu.yawVelocity(), S::rate);
+
+    r.set(F::ControlRoll, c.roll_power, S::unit);
+    r.set(F::ControlPitch, c.pitch_power, S::unit);
+    r.set(F::ControlYaw, c.yaw_power, S::unit);
+    r.set(F::ControlThrust, c.thrust, S::unit);
+    r.fields[F::Armed] = c.armed;
+
+    for (uint8_t a = 0; a < AcrobaticModeBehavior::AxesTotal; a++) {
+        const auto terms = acrobatic.velocity_pid.getTerms(a);
+        const auto base = static_cast<uint8_t>(F::PidRollP + a * 3);
+        r.set(static_cast<F>(base + 0), terms.p, S::unit);
+        r.set(static_cast<F>(base + 1), terms.i, S::unit);
+        r.set(static_cast<F>(base + 2), terms.d, S::unit);
+    }
+
+    for (uint8_t m = 0; m < DroneFrameDriver::TotalCount; m++) {
+        r.set(static_cast<F>(F::MotorBackLeft + m), frame_driver.getCommand(static_cast<DroneFrameDriver::MotorIndex>(m)), S::unit);
+    }
+
+    Blackbox::instance().record(r);
+}
+
+static void controlStep() {
+    static auto &scheduler = RateScheduler::instance();
+    static auto &blackbox = Blackbox::instance();
+
+    static auto &battery = Battery::instance();
+
+    // Аварийное отключение держится, пока пульт не снимет armed
+    static bool disarm_latched = false;
+    static bool was_armed = false;
+
+    // Запросы интерфейса (ядро 0) применяются здесь, между тактами
+    scheduler.applyRequests(was_armed);
+    scheduler.wait();
+
+    Profiler_scope(Control);
+
+    // Фильтры считаются под частоту цикла: пересчёт при её смене
+    static uint32_t loop_period_us = 0;
+
+    if (scheduler.periodUs() != loop_period_us) {
+        loop_period_us = scheduler.periodUs();
+        const float loop_rate_hz = 1e6f / static_cast<float>(loop_period_us);
+        pipeline.setLoopRate(loop_rate_hz);
+    }
+
+    const auto dt = scheduler.dt();
+    const auto flu = pipeline.sense(dt);
+
+    // Такт без нового отсчёта: регуляторы не шагают по повтору (D-звено дало бы 0, затем скачок),
+    // моторы держат прежнюю команду, прошедшее время уходит в шаг следующего отсчёта
+    static float pending_dt = 0;
+    pending_dt += dt;
+    const bool fresh_sample = imu.getLastBatchSize() > 0;
+
+    const ControlInput &input = control_mailbox.read();
+    const bool lost = input.sequence == 0 or input.ageUs(micros()) > EspNowClient::control_timeout_us;
+
+    if (not input.control.armed) {
+        disarm_latched = false;
+    }
+
+    bool armed = input.control.armed and not lost and not disarm_latched;
+
+    // Разряженная батарея: включение запрещено, в полёте только предупреждение
+    if (armed and not was_armed and battery.isLow()) {
+        Logger_warn("Low battery. Arming refused");
+        disarm_latched = true;
+        armed = false;
+    }
+    was_armed = armed;
+
+    // Последнее напряжение фоновой задачи: поправка скважности на просадку
+    frame_driver.setSupplyVoltage(battery.getVoltage());
+
+    // Новая кривая тяги - только без полёта
+    if (not armed and thrust_lut_mailbox.fresh()) {
+        thrust_lut_storage.settings = thrust_lut_mailbox.read();
+        frame_driver.reloadThrustLut();
+        thrust_lut_applied.store(true, std::memory_order_release);
+    }
+
+    // Самописец пишет, пока аппарат включён
+    blackbox.setRecording(armed);
+
+    if (armed) {
+        constexpr float critical_angle = 60 * DEG_TO_RAD;
+
+        if (std::abs(flu.pitch()) > critical_angle or std::abs(flu.roll()) > critical_angle) {
+            Logger_warn("Critical roll/pitch. Disarming");
+            disarm_latched = true;
+            return;
+        }
+
+        if (fresh_sample) {
+            Profiler_scope(Interpret);
+            pipeline.fly(input.control, pending_dt, flu);
+            pending_dt = 0;
+        }
+
+    } else {
+        pipeline.stop();
+        pending_dt = 0;
+    }
+
+    if (blackbox.isRecording()) {
+        captureBlackbox(flu, input.control);
+    }
+
+    if (TelemetryStream::instance().due(micros())) {
+        captureTelemetry(flu);
+    }
+}
+
+static void controlTask(void *) {
+    // Таймер будит задачу, которая вызвала init()
+    if (not RateScheduler::instance().init(RateScheduler::Rate::Hz1000)) { fatal(); }
+
+    auto &scheduler = RateScheduler::instance();
+
+    while (true) {
+        controlStep();
+
+        // Простой до следующего такта: окно записи самописца во FLASH
+        Blackbox::instance().onStepDone(scheduler.getLastWake() + scheduler.periodUs());
+    }
+}
+
+/// Команда с USB Serial
+/// thrust-lut <В> <тяга при скважности 0> ... <тяга при скважности 1> - замер на стенде, скважность на равномерной сетке
+static void runSerialCommand(char *line) {
+    char *save = nullptr;
+    const char *command = strtok_r(line, " ", &save);
+    if (command == nullptr) { return; }
+
+    if (std::strcmp(command, "thrust-lut") != 0) {
+        Logger_warn("unknown command '%s'", command);
+        return;
+    }
+
+    static constexpr size_t samples_max = 65;
+
+    // Напряжение и точки замера
+    float values[1 + samples_max];
+    size_t count = 0;
+
+    for (char *token; (token = strtok_r(nullptr, " ", &save)) != nullptr;) {
+        if (count == 1 + samples_max) {
+            Logger_error("thrust-lut: more than %u samples", static_cast<unsigned>(samples_max));
+            return;
+        }
+
+        char *end;
+        values[count] = std::strtof(token, &end);
+
+        if (*end != '\0') {
+            Logger_error("thrust-lut: bad number '%s'", token);
+            return;
+        }
+        count += 1;
+    }
+
+    if (count < 3 or values[0] <= 0.0f or not ThrustLut::isValidSamples(values + 1, count - 1)) {
+        Logger_error("thrust-lut: need voltage and 2+ non-decreasing samples");
+        return;
+    }
+
+    thrust_lut_mailbox.publish(ThrustLut::fromSamples(values + 1, count - 1, values[0]));
+    Logger_info("thrust curve: %u samples at %.2f V, applied when disarmed", static_cast<unsigned>(count - 1), values[0]);
+}
+
+/// Строки с USB Serial до '\n'
+static void pollSerialCommands() {
+    static char line[1024];
+    static size_t length = 0;
+    static bool overflow = false;
+
+    while (Serial.available() > 0) {
+        const int c = Serial.read();
+
+        if (c == '\r') { continue; }
+
+        if (c == '\n') {
+            line[length] = '\0';
+
+            if (overflow) {
+                Logger_error("serial command longer than %u B", static_cast<unsigned>(sizeof(line) - 1));
+            } else {
+                runSerialCommand(line);
+            }
+
+            length = 0;
+            overflow = false;
+            continue;
+        }
+
+        if (length < sizeof(line) - 1) {
+            line[length++] = static_cast<char>(c);
+        } else {
+            overflow = true;
+        }
+    }
+}
+
+static void serviceStep() {
+    static auto &esp_now = EspNowClient::instance();
+    static auto &page_manager = tui::PageManager::instance();
+    static bool calibrating_gyro = false;
+    static bool calibrating_accel = false;
+    static uint8_t accel_calib_orientation = 0;
+
+    TelemetryStream::instance().flush([](radio::FrameWriter &frame) { esp_now.send(frame); });
+
+    // Кривая тяги сохраняется после применения: управляющая задача пишет её только по новой команде ниже
+    if (thrust_lut_applied.exchange(false, std::memory_order_acquire)) {
+        if (thrust_lut_storage.save()) {
+            Logger_info("thrust curve applied and saved");
+        } else {
+            Logger_error("thrust curve save fail");
+        }
+    }
+
+    pollSerialCommands();
+
+    // Настройки PID меняются интерфейсом в этой же задаче, применяет их управляющая задача
+    AcrobaticModeBehavior::instance().publishGains();
+    AngleModeBehavior::instance().publishGains();
+
+    // Калибровки идут в управляющей задаче: здесь только обновление страницы при смене этапа
+    if (calibrating_accel != imu.isCalibratingAccel() or accel_calib_orientation != imu.getAccelCalibOrientation()) {
+        page_manager.addEvent(tui::Event::Update);
+    }
+    calibrating_accel = imu.isCalibratingAccel();
+    accel_calib_orientation = imu.getAccelCalibOrientation();
+
+    if (calibrating_gyro and not imu.isCalibratingGyro()) {
+        page_manager.addEvent(tui::Event::Update);
+    }
+    calibrating_gyro = imu.isCalibratingGyro();
+
+    bool render_required;
+    {
+        Profiler_scope(Events);
+        render_required = page_manager.pollEvents();
+    }
+
+    if (not render_required) { return; }
+
+    const auto slice = []() {
+        Profiler_scope(Render);
+        return tui::PageManager::instance().render();
+    }();
+
+    Profiler_scope(Send);
+    radio::FrameWriter page{};
+    page.add(radio::Type::TuiPage, slice.data, slice.len);
+    esp_now.send(page);
+}
+
+static void serviceTask(void *) {
+    while (true) {
+        serviceStep();
+        vTaskDelay(pdMS_TO_TICKS(service_period_ms));
+    }
+}
+
 void setupTui() {
     static auto &acrobatic_mode_behavior = AcrobaticModeBehavior::instance();
     static nfui::PidSettingsPage pitch_or_roll_vel_page{acrobatic_mode_behavior.pitch_or_roll_velocity_pid_storage};
     static nfui::PidSettingsPage yaw_vel_page{acrobatic_mode_behavior.yaw_velocity_pid_storage};
+    static auto &angle_mode_behavior = AngleModeBehavior::instance();
+    static nfui::PidSettingsPage angle_page{angle_mode_behavior.angle_pid_storage};
     static nfui::ImuPage imu_page{imu_storage, imu};
+    static nfui::SchedulerPage scheduler_page{RateScheduler::instance()};
+    static nfui::TelemetryPage telemetry_page{TelemetryStream::instance()};
+    static nfui::BlackboxPage blackbox_page{Blackbox::instance()};
+    static nfui::NotchPage notch_page{DynamicNotch::instance()};
+#if defined(KLYAX_PROFILER)
+    static nfui::ProfilerPage profiler_page{};
+#endif
+
+    // Делитель внешнего контура: 1 / 2 / 4 / 8
+    static tui::Button outer_divisor("Outer /4", [](tui::Button &button) {
+        static constexpr const char *labels[]{"Outer /1", "Outer /2", "Outer /4", "Outer /8"};
+        static_assert(1 << (std::size(labels) - 1) == AngleModeBehavior::outer_divisor_max, "label per divisor");
+
+        const uint8_t divisor = angle_mode_behavior.getOuterDivisor();
+        const uint8_t next = divisor >= AngleModeBehavior::outer_divisor_max ? 1 : divisor * 2;
+        angle_mode_behavior.setOuterDivisor(next);
+        button.label = labels[__builtin_ctz(next)];
+    });
+    angle_page.add(outer_divisor);
 
     auto &main_page = nfui::MainPage::instance();
     static tui::Button switch_mode("m", [](tui::Button &button) {
-        static auto &behavior_manager = BehaviorManager::instance();
-        if (behavior_manager.isActive(acrobatic_mode_behavior)) {
-            behavior_manager.bind(ManualModeBehavior::instance());
+        if (flight_modes.isSelected<AcrobaticModeBehavior>()) {
+            flight_modes.select<AngleModeBehavior>();
+            button.label = "Angle";
+        } else if (flight_modes.isSelected<AngleModeBehavior>()) {
+            flight_modes.select<ManualModeBehavior>();
             button.label = "Manual";
         } else {
-            behavior_manager.bind(acrobatic_mode_behavior);
+            flight_modes.select<AcrobaticModeBehavior>();
             button.label = "Acrobatic";
         }
     });
     main_page.add(switch_mode);
 
+    static nfui::BatteryDisplay battery_display{Battery::instance()};
+    main_page.add(battery_display);
+
     tui::PageManager::instance().bind(main_page);
 }
 
@@ -367,69 +1075,49 @@ void setup() {
         Serial.write(message, length);
     };
 
-    frame_driver.init();
+    if (not logger_task.start(Logger::task)) { fatal(); }
+
+    thrust_lut_storage.load();
+    if (not frame_driver.init()) { fatal(); }
 
-    if (not imu.init(GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_23, GPIO_NUM_5)) {
+    if (not imu.init(GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_23, GPIO_NUM_5, GPIO_NUM_4, EasyImu::Mode::Fifo)) {
         fatal();
     }
 
+    // Цикл не быстрее выборки датчика: в режиме FIFO (1125 Гц) - до 1 кГц
+    RateScheduler::instance().limitRate(RateScheduler::fastestAtMost(imu.getMaxLoopRate()));
+
     imu_storage.load();
     AcrobaticModeBehavior::instance().init();
+    AngleModeBehavior::instance().init();
 
     if (not EspNowClient::instance().init()) { fatal(); }
 
-    digitalWrite(2, LOW);
-    Logger_info("Start!");
-
-    BehaviorManager::instance().bind(AcrobaticModeBehavior::instance());
-}
-
-void loop() {
-    static Chronometer chronometer{};
-    static auto &esp_now = EspNowClient::instance();
-    static auto &page_manager = tui::PageManager::instance();
-    static auto &behavior_manager = BehaviorManager::instance();
-
-    delay(1);
-
-    if (imu.isCalibratingAccel()) {
-        const bool state_changed = imu.updateAccelCalib();
-        if (state_changed) {
-            page_manager.addEvent(tui::Event::Update);
-        }
+    // Полёт без самописца допустим
+    if (Blackbox::instance().init()) {
+        blackbox_task.start(Blackbox::task);
     }
 
-    if (page_manager.pollEvents()) {
-        const auto slice = page_manager.render();
-        espnow::Protocol::send(esp_now.target, slice.data, slice.len);
+    // Без измерения напряжения скважность не корректируется
+    if (not battery_task.start(Battery::task)) {
+        Logger_warn("battery monitor disabled");
     }
 
-    if (esp_now.timeout_manager.expired()) {
-        control.armed = false;
+    // Без анализа режекторы остаются выключенными, ФНЧ работает
+    if (not notch_task.start(DynamicNotch::task)) {
+        Logger_warn("dynamic notch disabled");
     }
 
-    const auto dt = chronometer.calc();
-
-    if (control.armed) {
-        const auto flu = imu.read(dt);
-
-        constexpr float critical_angle = 60 * DEG_TO_RAD;
-
-        if (std::abs(flu.pitch()) > critical_angle or std::abs(flu.roll()) > critical_angle) {
-            Logger_warn("Critical roll/pitch. Disarming");
-            control.armed = false;
-            return;
-        }
+    flight_modes.select<AcrobaticModeBehavior>();
 
-        behavior_manager.interpret(control, dt, flu);
+    if (not control_task.start(controlTask)) { fatal(); }
+    if (not service_task.start(serviceTask)) { fatal(); }
 
-    } else {
-        behavior_manager.onDisarm();
-        control.thrust = 0;
-        control.pitch_power = 0;
-        control.yaw_power = 0;
-        control.roll_power = 0;
-        frame_driver.disable();
-    }
+    digitalWrite(2, LOW);
+    Logger_info("Start!");
+}
 
-}
\ No newline at end of file
+void loop() {
+    // Вся работа в задачах control и service
+    vTaskDelete(nullptr);
+}
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "DroneFrameDriver.hpp"
+#include "hal/Adc.hpp"
+#include "hal/Clock.hpp"
+#include "hal/Imu.hpp"
+#include "hal/Ledc.hpp"
+
+
+/// Software-In-The-Loop симулятор
+namespace sitl {
+
+struct Vec3 {
+    double x, y, z;
+
+    Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+
+    Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+
+    Vec3 operator*(double s) const { return {x * s, y * s, z * s}; }
+
+    Vec3 cross(const Vec3 &o) const { return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+};
+
+/// Кватернион поворота Body -> World
+struct Quaternion {
+    double w{1}, x{0}, y{0}, z{0};
+
+    Quaternion operator*(const Quaternion &o) const {
+        return {
+            w * o.w - x * o.x - y * o.y - z * o.z,
+            w * o.x + x * o.w + y * o.z - z * o.y,
+            w * o.y - x * o.z + y * o.w + z * o.x,
+            w * o.z + x * o.y - y * o.x + z * o.w,
+        };
+    }
+
+    Quaternion conjugate() const { return {w, -x, -y, -z}; }
+
+    void normalize() {
+        const double n = std::sqrt(w * w + x * x + y * y + z * z);
+        w /= n;
+        x /= n;
+        y /= n;
+        z /= n;
+    }
+
+    Vec3 rotate(const Vec3 &v) const {
+        const auto r = *this * Quaternion{0, v.x, v.y, v.z} * conjugate();
+        return {r.x, r.y, r.z};
+    }
+
+    /// Углы Эйлера (Roll, Pitch, Yaw) в системе FLU
+    /// Радианы
+    Vec3 euler() const {
+        return {
+            std::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)),
+            std::asin(std::fmax(-1.0, std::fmin(1.0, 2 * (w * y - z * x)))),
+            std::atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)),
+        };
+    }
+};
+
+/// Параметры модели
+/// По умолчанию: Klyax, моторы 8520, пропеллеры 55 мм
+struct Config {
+    /// Масса, кг
+    double mass{0.065};
+
+    /// Главные моменты инерции, кг * м^2
+    Vec3 inertia{3.0e-5, 3.0e-5, 5.5e-5};
+
+    /// Смещение моторов от центра по осям X и Y, м
+    double arm{0.035};
+
+    /// Тяга одного мотора при скважности 1.0, Н
+    double max_thrust{0.35};
+
+    /// Отношение реактивного момента к тяге, м
+    double torque_to_thrust{0.005};
+
+    /// Постоянная времени мотора, с
+    double motor_time_constant{0.03};
+
+    /// Обороты ротора при скважности 1.0, об / мин
+    double max_rpm{30000};
+
+    /// Напряжение, при котором заданы max_thrust и max_rpm, В
+    /// Обороты пропорциональны напряжению на моторе
+    double rated_voltage{3.8};
+
+    /// Напряжение батареи без нагрузки, В
+    double battery_voltage{4.0};
+
+    /// Внутреннее сопротивление батареи и проводов, Ом
+    double battery_resistance{0.03};
+
+    /// Ток мотора на оборотах скважности 1.0, А
+    double motor_current{2.5};
+
+    /// Вывод ADC с делителем батареи
+    uint8_t battery_pin{34};
+
+    /// Отношение делителя батареи
+    double battery_divider{2.0};
+
+    /// Аэродинамическое демпфирование вращения, Н * м * с
+    double rotational_drag{2.0e-6};
+
+    /// Линейное сопротивление, Н * с / м
+    double linear_drag{0.02};
+
+    /// Шаг интегрирования, мкс
+    uint32_t step_us{125};
+
+    /// Шум гироскопа (СКО), град / с
+    double gyro_noise{0.3};
+
+    /// Шум акселерометра (СКО), mG
+    double accel_noise{8.0};
+
+    /// Вибрации гироскопа при скважности 1.0, град / с
+    double gyro_vibration{25.0};
+
+    /// Вибрации акселерометра при скважности 1.0, mG
+    double accel_vibration{400.0};
+
+    /// Seed генератора шума
+    uint32_t seed{1};
+
+    /// Выводы моторов в порядке DroneFrameDriver::MotorIndex
+    uint8_t motor_pins[DroneFrameDriver::TotalCount]{12, 13, 14, 15};
+};
+
+/// Квадрокоптер X-схемы
+/// Вход - скважности LEDC моторов (DroneFrameDriver::mixin),
+/// выход - сырые показания ICM-20948 для EasyImu::read
+struct Quadcopter final {
+
+    struct Metrics {
+        double rate_error_squared[3];
+        double max_abs_roll;
+        double max_abs_pitch;
+        double min_altitude;
+        double max_altitude;
+        uint64_t airborne_steps;
+        uint64_t saturated_steps;
+        double min_battery_voltage;
+    };
+
+    static constexpr double gravity = 9.80665;
+
+private:
+
+    struct MotorGeometry {
+        /// Положение в FLU, м (в долях arm, самое длинное плечо - arm)
+        double x, y;
+        /// Знак реактивного момента по оси Z
+        /// Ротор против часовой -> корпус по часовой (-1)
+        double yaw_sign;
+    };
+
+    /// Мотор рамы сборки (KLYAX_FRAME_*): модель и смеситель прошивки всегда об одной раме
+    /// Строка смесителя -> положение, обратно FrameGeometry::fromPlacement
+    static constexpr MotorGeometry motorGeometry(int index) {
+        const MixerRow &row = DroneFrameDriver::Frame::geometry.rows[index];
+        return {-row.pitch, row.roll, -row.yaw};
+    }
+
+    Config config;
+    std::mt19937 random;
+    std::normal_distribution<double> normal{0.0, 1.0};
+
+    Quaternion attitude{};
+    Vec3 angular_velocity{};
+    Vec3 position{0, 0, 0};
+    Vec3 velocity{};
+    Vec3 specific_force{0, 0, gravity};
+
+    double rotor_speed[DroneFrameDriver::TotalCount]{};
+    double rotor_phase[DroneFrameDriver::TotalCount]{};
+
+    Vec3 reference_rates{};
+    Metrics metrics{{0, 0, 0}, 0, 0, 0, 0, 0, 0, 0};
+
+    /// Под нагрузкой, В
+    double battery_voltage{0};
+
+public:
+
+    explicit Quadcopter(const Config &config) :
+        config{config}, random{config.seed}, battery_voltage{config.battery_voltage} {
+        metrics.min_battery_voltage = config.battery_voltage;
+    }
+
+    /// Подключить к виртуальному времени и эмулируемому IMU
+    void attach() {
+        static Quadcopter *active{nullptr};
+        active = this;
+
+        hal::Clock::schedule(hal::Clock::now(), config.step_us, [](void *context) {
+            static_cast<Quadcopter *>(context)->step();
+        }, this);
+
+        hal::Imu::source = [](uint64_t t_us) { return active->sample(t_us); };
+    }
+
+    /// Заданные пилотом угловые скорости (FLU, рад / с) для расчёта ошибки слежения
+    void setReferenceRates(const Vec3 &rates) { reference_rates = rates; }
+
+    /// Скважность висения
+    double hoverDuty() const {
+        return std::sqrt(config.mass * gravity / (DroneFrameDriver::TotalCount * config.max_thrust));
+    }
+
+    const Metrics &getMetrics() const { return metrics; }
+
+    const Config &getConfig() const { return config; }
+
+    Vec3 getEuler() const { return attitude.euler(); }
+
+    const Vec3 &getAngularVelocity() const { return angular_velocity; }
+
+    const Vec3 &getPosition() const { return position; }
+
+    void step() {
+        const double dt = config.step_us * 1e-6;
+
+        updateBattery();
+
+        double total_thrust = 0;
+        Vec3 torque{0, 0, 0};
+        bool saturated = false;
+
+        for (int i = 0; i < DroneFrameDriver::TotalCount; i++) {
+            const double duty = hal::Ledc::dutyOnPin(config.motor_pins[i]);
+            saturated |= duty >= 1.0;
+
+            const double target_speed = duty * battery_voltage / config.rated_voltage;
+            rotor_speed[i] += (target_speed - rotor_speed[i]) * (dt / config.motor_time_constant);
+            rotor_phase[i] = std::fmod(rotor_phase[i] + 2 * M_PI * rotor_speed[i] * config.max_rpm / 60.0 * dt, 2 * M_PI);
+
+            const double thrust = config.max_thrust * rotor_speed[i] * rotor_speed[i];
+            const auto g = motorGeometry(i);
+
+            total_thrust += thrust;
+            torque = torque + Vec3{
+                g.y * config.arm * thrust,
+                -g.x * config.arm * thrust,
+                g.yaw_sign * config.torque_to_thrust * thrust,
+            };
+        }
+
+        torque = torque - angular_velocity * config.rotational_drag;
+
+        const auto &inertia = config.inertia;
+        const Vec3 momentum{inertia.x * angular_velocity.x, inertia.y * angular_velocity.y, inertia.z * angular_velocity.z};
+        const Vec3 net_torque = torque - angular_velocity.cross(momentum);
+
+        angular_velocity = angular_velocity + Vec3{
+            net_torque.x / inertia.x,
+            net_torque.y / inertia.y,
+            net_torque.z / inertia.z,
+        } * dt;
+
+        attitude = attitude * Quaternion{1, 0.5 * angular_velocity.x * dt, 0.5 * angular_velocity.y * dt, 0.5 * angular_velocity.z * dt};
+        attitude.normalize();
+
+        const Vec3 thrust_world = attitude.rotate({0, 0, total_thrust});
+        const Vec3 force = thrust_world - velocity * config.linear_drag;
+        Vec3 acceleration = force * (1.0 / config.mass) - Vec3{0, 0, gravity};
+
+        velocity = velocity + acceleration * dt;
+        position = position + velocity * dt;
+
+        const bool on_ground = position.z <= 0 and thrust_world.z < config.mass * gravity;
+
+        if (on_ground) {
+            position.z = 0;
+            velocity = {0, 0, 0};
+            angular_velocity = {0, 0, 0};
+            attitude = {};
+            acceleration = {0, 0, 0};
+        }
+
+        specific_force = attitude.conjugate().rotate(acceleration + Vec3{0, 0, gravity});
+
+        if (not on_ground) {
+            updateMetrics(saturated);
+        }
+    }
+
+    /// Показания ICM-20948 в системе координат датчика
+    /// Датчик установлен "вверх ногами": X = -Left, Y = Forward, Z = Up
+    hal::Imu::Sample sample(uint64_t) {
+        constexpr double rad_to_deg = 180.0 / M_PI;
+        constexpr double g_to_mg = 1000.0 / gravity;
+
+        Vec3 gyro_vibration{0, 0, 0};
+        Vec3 accel_vibration{0, 0, 0};
+
+        for (int i = 0; i < DroneFrameDriver::TotalCount; i++) {
+            const double amplitude = rotor_speed[i] * rotor_speed[i];
+            const double s = std::sin(rotor_phase[i]);
+            const double c = std::cos(rotor_phase[i]);
+
+            gyro_vibration = gyro_vibration + Vec3{s, c, 0.3 * s} * (amplitude * config.gyro_vibration);
+            accel_vibration = accel_vibration + Vec3{c, s, 0.5 * c} * (amplitude * config.accel_vibration);
+        }
+
+        const Vec3 gyro = angular_velocity * rad_to_deg + gyro_vibration + noise(config.gyro_noise);
+        const Vec3 accel = specific_force * g_to_mg + accel_vibration + noise(config.accel_noise);
+
+        return hal::Imu::Sample{
+            .acc = {static_cast<float>(-accel.y), static_cast<float>(accel.x), static_cast<float>(accel.z)},
+            .gyr = {static_cast<float>(-gyro.y), static_cast<float>(gyro.x), static_cast<float>(gyro.z)},
+        };
+    }
+
+private:
+
+    /// Просадка по току моторов (ток ~ обороты^2), напряжение на делитель ADC
+    void updateBattery() {
+        double current = 0;
+        for (const double speed : rotor_speed) { current += config.motor_current * speed * speed; }
+
+        battery_voltage = config.battery_voltage - config.battery_resistance * current;
+        metrics.min_battery_voltage = std::fmin(metrics.min_battery_voltage, battery_voltage);
+
+        const double pin_millivolts = battery_voltage / config.battery_divider * 1000.0;
+        hal::Adc::millivolts[config.battery_pin] = static_cast<uint16_t>(std::fmax(0.0, pin_millivolts));
+    }
+
+    Vec3 noise(double sigma) {
+        return Vec3{normal(random), normal(random), normal(random)} * sigma;
+    }
+
+    void updateMetrics(bool saturated) {
+        const Vec3 e = angular_velocity - reference_rates;
+        metrics.rate_error_squared[0] += e.x * e.x;
+        metrics.rate_error_squared[1] += e.y * e.y;
+        metrics.rate_error_squared[2] += e.z * e.z;
+
+        const Vec3 euler = attitude.euler();
+        metrics.max_abs_roll = std::fmax(metrics.max_abs_roll, std::fabs(euler.x));
+        metrics.max_abs_pitch = std::fmax(metrics.max_abs_pitch, std::fabs(euler.y));
+
+        if (metrics.airborne_steps == 0) {
+            metrics.min_altitude = position.z;
+            metrics.max_altitude = position.z;
+        }
+        metrics.min_altitude = std::fmin(metrics.min_altitude, position.z);
+        metrics.max_altitude = std::fmax(metrics.max_altitude, position.z);
+
+        metrics.airborne_steps += 1;
+        metrics.saturated_steps += saturated;
+    }
+};
+
+}
@@ -0,0 +1,304 @@
+/// Нативный прогон прошивки: виртуальный пульт, SITL и отчёты о прогоне
+/// Регистрируется в точке входа NativeHal через hal::Native, на борту не собирается
+///
+/// Аргументы:
+///   --armed         Виртуальный пульт держит аппарат включённым
+///   --thrust <x>    Тяга виртуального пульта [0.0 .. 1.0]
+///   --sitl          Подключить SITL модель квадрокоптера вместо покоящегося IMU
+///   --seed <n>      Seed шумов SITL (по умолчанию 1)
+///   --doublet <x>   Дублет по крену амплитудой x [-1.0 .. 1.0] каждые 2 с
+///   --rate <hz>     Частота управляющего цикла RateScheduler: 500, 1000, 2000, 4000
+///   --telemetry <path>      Записать отправленные посылки ESP-NOW в файл: [длина u8][посылка]
+///   --telemetry-rate <hz>   Частота TelemetryStream: 50, 100, 200, 500 (по умолчанию 200)
+///   --blackbox <path>       Сохранить раздел blackbox в файл после прогона
+///   --battery <V>   Напряжение батареи SITL без нагрузки (по умолчанию 4.0)
+
+#if defined(KLYAX_NATIVE)
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "Blackbox.hpp"
+#include "freertos/task.h"
+#include "hal/Clock.hpp"
+#include "hal/EspNow.hpp"
+#include "hal/Flash.hpp"
+#include "hal/Imu.hpp"
+#include "hal/Native.hpp"
+#include "Radio.hpp"
+#include "sitl/Quadcopter.hpp"
+#include "TelemetryStream.hpp"
+#include "tools/Logger.hpp"
+#include "tools/Profiler.hpp"
+#include "tools/Scheduler.hpp"
+
+
+namespace {
+
+struct Options {
+    bool armed{false};
+    float thrust{0.0f};
+    bool sitl{false};
+    uint32_t seed{1};
+    float doublet{0.0f};
+    uint32_t rate_hz{0};
+    const char *telemetry_path{nullptr};
+    uint32_t telemetry_rate_hz{200};
+    double battery_voltage{sitl::Config{}.battery_voltage};
+    const char *blackbox_path{nullptr};
+};
+
+/// Период отправки пакетов виртуальным пультом
+/// Мкс
+constexpr uint64_t remote_period_us = 20000;
+
+/// DroneControl::power_to_angular_velocity
+constexpr float power_to_angular_velocity = 3.0f;
+
+Options options{};
+
+sitl::Quadcopter *quadcopter{nullptr};
+
+std::FILE *telemetry_file{nullptr};
+
+/// Формат моста ESP-NOW -> хост: байт длины и посылка
+void writeSentPayload(const hal::EspNow::Mac &, const void *data, uint8_t size) {
+    std::fputc(size, telemetry_file);
+    std::fwrite(data, 1, size, telemetry_file);
+}
+
+/// Дублет: +x на 250 мс, затем -x на 250 мс, период 2 с
+float doubletRollPower() {
+    const auto phase_ms = (hal::Clock::now() / 1000) % 2000;
+    if (phase_ms >= 1000 and phase_ms < 1250) { return options.doublet; }
+    if (phase_ms >= 1250 and phase_ms < 1500) { return -options.doublet; }
+    return 0.0f;
+}
+
+void sendRemotePacket(void *) {
+    const float roll_power = doubletRollPower();
+
+    if (quadcopter != nullptr) {
+        quadcopter->setReferenceRates({roll_power * power_to_angular_velocity, 0, 0});
+    }
+
+    static radio::FrameWriter writer{};
+    static uint16_t sequence{0};
+
+    writer.add(radio::Type::Control, radio::ControlMessage{
+        .left_x = 0.0f,
+        .left_y = options.thrust,
+        .right_x = roll_power,
+        .right_y = 0.0f,
+        .mode_toggle = options.armed,
+    });
+
+    const radio::Frame &frame = writer.seal(sequence++, static_cast<uint32_t>(hal::Clock::now()));
+    hal::EspNow::deliver(frame.data, frame.size);
+}
+
+void registerOptions() {
+    hal::Native::addOption("--armed", false, [](const char *) { return options.armed = true; });
+    hal::Native::addOption("--sitl", false, [](const char *) { return options.sitl = true; });
+
+    hal::Native::addOption("--thrust", true, [](const char *value) {
+        options.thrust = static_cast<float>(std::atof(value));
+        return true;
+    });
+    hal::Native::addOption("--seed", true, [](const char *value) {
+        options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        return true;
+    });
+    hal::Native::addOption("--doublet", true, [](const char *value) {
+        options.doublet = static_cast<float>(std::atof(value));
+        return true;
+    });
+    hal::Native::addOption("--rate", true, [](const char *value) {
+        options.rate_hz = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        return true;
+    });
+    hal::Native::addOption("--telemetry", true, [](const char *value) {
+        options.telemetry_path = value;
+        return true;
+    });
+    hal::Native::addOption("--telemetry-rate", true, [](const char *value) {
+        options.telemetry_rate_hz = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        return true;
+    });
+    hal::Native::addOption("--battery", true, [](const char *value) {
+        options.battery_voltage = std::atof(value);
+        return true;
+    });
+    hal::Native::addOption("--blackbox", true, [](const char *value) {
+        options.blackbox_path = value;
+        return true;
+    });
+}
+
+bool start() {
+    static sitl::Config sitl_config{};
+    sitl_config.seed = options.seed;
+    sitl_config.battery_voltage = options.battery_voltage;
+    static sitl::Quadcopter sitl_quadcopter{sitl_config};
+
+    if (options.sitl) {
+        quadcopter = &sitl_quadcopter;
+        quadcopter->attach();
+    }
+
+    if (options.telemetry_path != nullptr) {
+        telemetry_file = std::fopen(options.telemetry_path, "wb");
+        if (telemetry_file == nullptr) {
+            std::fprintf(stderr, "cannot open %s\n", options.telemetry_path);
+            return false;
+        }
+        hal::EspNow::on_send = writeSentPayload;
+    }
+
+    return true;
+}
+
+void applyRateOption() {
+    if (options.rate_hz == 0) { return; }
+
+    static constexpr RateScheduler::Rate rates[]{
+        RateScheduler::Rate::Hz500,
+        RateScheduler::Rate::Hz1000,
+        RateScheduler::Rate::Hz2000,
+        RateScheduler::Rate::Hz4000,
+    };
+
+    for (const auto r: rates) {
+        if (RateScheduler::toHz(r) == options.rate_hz) {
+            RateScheduler::instance().requestRate(r);
+        }
+    }
+}
+
+void applyTelemetryOption() {
+    if (options.telemetry_path == nullptr) { return; }
+
+    static constexpr TelemetryStream::Rate rates[]{
+        TelemetryStream::Rate::Hz50,
+        TelemetryStream::Rate::Hz100,
+        TelemetryStream::Rate::Hz200,
+        TelemetryStream::Rate::Hz500,
+    };
+
+    for (const auto r: rates) {
+        if (TelemetryStream::toHz(r) == options.telemetry_rate_hz) {
+            TelemetryStream::instance().setRate(r);
+        }
+    }
+}
+
+/// Выполняется в loopTask после setup()
+void afterSetup() {
+    // Задачи прошивки с более высоким приоритетом успевают запуститься (RateScheduler::init)
+    vTaskDelay(1);
+    applyRateOption();
+    applyTelemetryOption();
+
+    // Запрос частоты применяется управляющей задачей между тактами и только до включения: пульт стартует после
+    vTaskDelay(2);
+
+    hal::Clock::schedule(hal::Clock::now(), remote_period_us, sendRemotePacket);
+}
+
+void printSitlReport(const sitl::Quadcopter &q) {
+    constexpr double rad_to_deg = 180.0 / M_PI;
+
+    const auto &m = q.getMetrics();
+    const double n = m.airborne_steps > 0 ? static_cast<double>(m.airborne_steps) : 1.0;
+
+    std::fprintf(
+        stderr,
+        "[sitl] hover duty: %.3f, airborne: %.3f s, saturated: %.1f %%\n"
+        "[sitl] rate error RMS (deg/s): roll %.2f, pitch %.2f, yaw %.2f\n"
+        "[sitl] max |roll| %.1f deg, max |pitch| %.1f deg, altitude %.2f .. %.2f m\n"
+        "[sitl] battery: %.2f V open circuit, %.2f V min\n",
+        q.hoverDuty(), static_cast<double>(m.airborne_steps) * sitl::Config{}.step_us * 1e-6,
+        100.0 * static_cast<double>(m.saturated_steps) / n,
+        std::sqrt(m.rate_error_squared[0] / n) * rad_to_deg,
+        std::sqrt(m.rate_error_squared[1] / n) * rad_to_deg,
+        std::sqrt(m.rate_error_squared[2] / n) * rad_to_deg,
+        m.max_abs_roll * rad_to_deg, m.max_abs_pitch * rad_to_deg,
+        m.min_altitude, m.max_altitude,
+        q.getConfig().battery_voltage, m.min_battery_voltage
+    );
+}
+
+void report() {
+    Logger::instance().flush();
+
+    const auto &imu = hal::Imu::stats;
+    const auto &jitter = RateScheduler::instance().getStats();
+    const auto control_ticks = jitter.getSamples() > 0 ? jitter.getSamples() : 1;
+
+    std::fprintf(
+        stderr,
+        "[native] imu: %u samples read, %u missed, %u SPI transactions (%.2f / control tick), %u B, %u interrupts\n",
+        imu.samples_read, imu.samples_missed, imu.spi_transactions,
+        static_cast<double>(imu.spi_transactions) / static_cast<double>(control_ticks), imu.spi_bytes, imu.interrupts
+    );
+
+    std::fprintf(
+        stderr,
+        "[native] scheduler: %u Hz, period min %u / mean %u / p99 %u / max %u us, %u overruns\n",
+        RateScheduler::toHz(RateScheduler::instance().getRate()),
+        jitter.getMin(), jitter.getMean(), jitter.percentile(0.99f), jitter.getMax(), jitter.getOverruns()
+    );
+
+    if (telemetry_file != nullptr) {
+        std::fclose(telemetry_file);
+
+        const auto &stream = TelemetryStream::instance();
+        std::fprintf(
+            stderr,
+            "[native] telemetry: %u batches sent, %u dropped -> %s\n",
+            stream.getBatchesSent(), stream.getBatchesDropped(), options.telemetry_path
+        );
+    }
+
+    std::fprintf(
+        stderr,
+        "[native] flash: %u B written, %u sectors erased, longest write %u us, %u writes past control wake\n",
+        hal::Flash::bytes_written, hal::Flash::sectors_erased,
+        Blackbox::instance().getMaxWriteUs(), Blackbox::instance().getLateWrites()
+    );
+
+    if (options.blackbox_path != nullptr and not hal::Flash::dump(options.blackbox_path)) {
+        std::fprintf(stderr, "cannot write %s\n", options.blackbox_path);
+    }
+
+#if defined(KLYAX_PROFILER)
+    for (uint8_t i = 0; i < Profiler::stages_total; i++) {
+        const auto stage = static_cast<Profiler::Stage>(i);
+        const auto &stats = Profiler::instance().stats(stage);
+        std::fprintf(
+            stderr,
+            "[native] profiler %-4s %8u samples, min %u / mean %u / max %u cycles (host time)\n",
+            Profiler::name(stage), stats.getSamples(), stats.getMin(), stats.getMean(), stats.getMax()
+        );
+    }
+#endif
+
+    if (quadcopter != nullptr) {
+        printSitlReport(*quadcopter);
+    }
+}
+
+struct Registration {
+    Registration() {
+        registerOptions();
+        hal::Native::onStart(start);
+        hal::Native::onSetup(afterSetup);
+        hal::Native::onReport(report);
+    }
+};
+
+Registration registration{};
+
+}
+
+#endif
@@ -1,63 +1,311 @@
 #pragma once
 
+#include <Arduino.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
 
+
+/// Журнал
+/// Вызов log() только форматирует сообщение в ячейку кольцевого буфера (MPSC, без блокировок),
+/// вывод через write_func выполняет фоновая задача Logger::task
+/// Пока задача не запущена (setup, отдельные скетчи), буфер выводится сразу в вызывающей задаче
+///
+/// С флагом KLYAX_LOG_BINARY сообщения не форматируются на борту:
+/// место вызова - constexpr Site (уровень, строка, формат, функция) в .rodata с именем klyax_log_site,
+/// в буфер пишутся только ID места вызова, время и сырые аргументы.
+/// Текст восстанавливает хост по таблице мест вызова из ELF: python -m klyax log firmware.elf <порт>
 struct Logger {
 
     using WriteFunction = void (*)(const char *, size_t);
 
+    /// Размер сообщения вместе с префиксом
+    /// Байт
+    static constexpr size_t message_size = 128;
+
+    /// Ячеек в кольцевом буфере, степень двойки
+    static constexpr uint32_t capacity = 32;
+
+    /// Период вывода фоновой задачей
+    /// Мс
+    static constexpr uint32_t flush_period_ms = 10;
+
+    /// Первый байт бинарного кадра: [маркер][длина][время u32][ID i32][аргументы...]
+    /// Хост ищет маркер только в начале строки: внутри текста 0xB1 - байт UTF-8 ("б" = D0 B1)
+    static constexpr uint8_t binary_marker = 0xB1;
+
+    /// Строковый аргумент обрезается до
+    /// Байт
+    static constexpr size_t binary_string_max = 32;
+
+    /// ID места вызова - смещение его Site относительно этого символа
+    inline static constexpr char id_anchor[] = "klyax-log";
+
+    /// Место вызова для бинарного режима
+    /// Раскладка читается хостом из ELF: level u8, reserved u8, line u16, format\0, function\0
+    template<size_t F, size_t P> struct Site {
+        uint8_t level;
+        uint8_t reserved;
+        uint16_t line;
+        char format[F];
+        char function[P];
+    };
+
+    template<size_t F, size_t P> static constexpr Site<F, P> makeSite(uint8_t level, uint16_t line, const char (&format)[F], const char (&function)[P]) {
+        Site<F, P> site{level, 0, line, {}, {}};
+        for (size_t i = 0; i < F; i++) { site.format[i] = format[i]; }
+        for (size_t i = 0; i < P; i++) { site.function[i] = function[i]; }
+        return site;
+    }
+
     WriteFunction write_func{nullptr};
 
+private:
+
+    /// Ячейка очереди Вьюкова: sequence == позиция - свободна для записи, позиция + 1 - готова к чтению
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        uint8_t length;
+        char text[message_size];
+    };
+
+    Cell cells[capacity];
+    std::atomic<uint32_t> enqueue_position{0};
+    std::atomic<uint32_t> dequeue_position{0};
+
+    std::atomic<uint32_t> dropped{0};
+
+    /// flush() вызывается из любой задачи: о каждой потере сообщает ровно один вызов
+    std::atomic<uint32_t> dropped_reported{0};
+
+    std::atomic<bool> background{false};
+
+public:
+
     static Logger &instance() {
         static Logger instance;
         return instance;
     }
 
-    void log(const char *level, const char *function, const char *format, ...) const {
+    void log(const char *level, const char *function, const char *format, ...) {
         if (write_func == nullptr) { return; }
 
-        char buffer[128];
+        Cell *cell = reserve();
+
+        if (cell == nullptr) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        char *buffer = cell->text;
         size_t pos = 0;
 
         // Форматируем префикс
-        int prefix_len = snprintf(buffer, sizeof(buffer),
+        int prefix_len = snprintf(buffer, message_size,
                                   "[%lu|%s|%s] ",
                                   millis(), level, function);
 
         if (prefix_len > 0) {
-            pos = min(static_cast<size_t>(prefix_len), sizeof(buffer) - 1);
+            pos = min(static_cast<size_t>(prefix_len), message_size - 1);
         }
 
         // Форматируем основное сообщение
-        if (pos < sizeof(buffer)) {
+        if (pos < message_size) {
             va_list args;
             va_start(args, format);
             int msg_len = vsnprintf(buffer + pos,
-                                    sizeof(buffer) - pos,
+                                    message_size - pos,
                                     format,
                                     args);
             va_end(args);
 
             if (msg_len > 0) {
-                pos += min(static_cast<size_t>(msg_len), sizeof(buffer) - pos - 1);
+                pos += min(static_cast<size_t>(msg_len), message_size - pos - 1);
             }
         }
 
         // Добавляем перевод строки
-        if (pos < sizeof(buffer) - 1) {
+        if (pos < message_size - 1) {
             buffer[pos] = '\n';
             pos++;
         } else {
             // Если не хватило места - заменяем последний символ
-            buffer[sizeof(buffer) - 2] = '\n';
-            pos = sizeof(buffer) - 1;
+            buffer[message_size - 2] = '\n';
+            pos = message_size - 1;
+        }
+
+        cell->length = static_cast<uint8_t>(pos);
+        commit(*cell);
+
+        if (not background.load(std::memory_order_relaxed)) {
+            flush();
+        }
+    }
+
+    /// Бинарная запись: ID места вызова, время и аргументы без форматирования
+    template<typename... Args> void logBinary(const void *site, const Args &... args) {
+        if (write_func == nullptr) { return; }
+
+        Cell *cell = reserve();
+
+        if (cell == nullptr) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto *out = reinterpret_cast<uint8_t *>(cell->text);
+        size_t pos = 2;
+
+        const uint32_t timestamp_us = micros();
+        const int32_t id = static_cast<int32_t>(reinterpret_cast<intptr_t>(site) - reinterpret_cast<intptr_t>(id_anchor));
+        putBytes(out, pos, &timestamp_us, sizeof(timestamp_us));
+        putBytes(out, pos, &id, sizeof(id));
+
+        (putArgument(out, pos, args), ...);
+
+        out[0] = binary_marker;
+        out[1] = static_cast<uint8_t>(pos - 2);
+        cell->length = static_cast<uint8_t>(pos);
+        commit(*cell);
+
+        if (not background.load(std::memory_order_relaxed)) {
+            flush();
+        }
+    }
+
+    /// Вывести накопленные сообщения
+    /// Можно вызывать из любой задачи (например, перед перезагрузкой)
+    void flush() {
+        while (true) {
+            uint32_t position = dequeue_position.load(std::memory_order_relaxed);
+            Cell *cell;
+
+            while (true) {
+                cell = &cells[position & (capacity - 1)];
+                const auto sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<int32_t>(sequence - (position + 1));
+
+                if (difference < 0) {
+                    reportDropped();
+                    return;
+                }
+
+                if (difference == 0 and dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+
+                if (difference > 0) {
+                    position = dequeue_position.load(std::memory_order_relaxed);
+                }
+            }
+
+            write_func(cell->text, cell->length);
+            cell->sequence.store(position + capacity, std::memory_order_release);
         }
+    }
 
-        write_func(buffer, pos);
+    /// Сообщения, потерянные из-за переполнения буфера
+    inline uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    /// Фоновая задача вывода
+    static void task(void *) {
+        auto &self = instance();
+        self.background.store(true, std::memory_order_relaxed);
+
+        while (true) {
+            self.flush();
+            vTaskDelay(pdMS_TO_TICKS(flush_period_ms));
+        }
     }
 
 private:
 
-    Logger() = default;
+    Logger() {
+        for (uint32_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /// Захватить ячейку для записи
+    /// nullptr - буфер заполнен
+    Cell *reserve() {
+        uint32_t position = enqueue_position.load(std::memory_order_relaxed);
+
+        while (true) {
+            Cell &cell = cells[position & (capacity - 1)];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<int32_t>(sequence - position);
+
+            if (difference == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &cell;
+                }
+            } else if (difference < 0) {
+                return nullptr;
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void commit(Cell &cell) {
+        const auto position = cell.sequence.load(std::memory_order_relaxed);
+        cell.sequence.store(position + 1, std::memory_order_release);
+    }
+
+    /// Сообщение о потерях выводится сразу, мимо очереди: она может быть снова заполнена
+    void reportDropped();
+
+    static void putBytes(uint8_t *out, size_t &pos, const void *data, size_t size) {
+        if (pos + size > message_size) { return; }
+        std::memcpy(out + pos, data, size);
+        pos += size;
+    }
+
+    /// Аргумент: тег типа и значение
+    /// 'i' / 'u' - 32 бит, 'l' / 'L' - 64 бит, 'f' - float, 's' - длина u8 и байты строки
+    template<typename T> static void putArgument(uint8_t *out, size_t &pos, const T &value) {
+        using V = std::decay_t<T>;
+
+        if constexpr (std::is_same_v<V, const char *> or std::is_same_v<V, char *>) {
+            const size_t length = value == nullptr ? 0 : strnlen(value, binary_string_max);
+            if (pos + 2 + length > message_size) { return; }
+
+            out[pos++] = 's';
+            out[pos++] = static_cast<uint8_t>(length);
+            putBytes(out, pos, value, length);
+
+        } else if constexpr (std::is_floating_point_v<V>) {
+            const auto f = static_cast<float>(value);
+            if (pos + 1 + sizeof(f) > message_size) { return; }
+
+            out[pos++] = 'f';
+            putBytes(out, pos, &f, sizeof(f));
+
+        } else if constexpr (std::is_enum_v<V>) {
+            putArgument(out, pos, static_cast<std::underlying_type_t<V>>(value));
+
+        } else {
+            static_assert(std::is_integral_v<V>, "unsupported log argument type");
+
+            if constexpr (sizeof(V) > 4) {
+                const auto v = static_cast<uint64_t>(value);
+                if (pos + 1 + sizeof(v) > message_size) { return; }
+
+                out[pos++] = std::is_signed_v<V> ? 'l' : 'L';
+                putBytes(out, pos, &v, sizeof(v));
+
+            } else {
+                const auto v = static_cast<uint32_t>(std::is_signed_v<V> ? static_cast<uint32_t>(static_cast<int32_t>(value)) : static_cast<uint32_t>(value));
+                if (pos + 1 + sizeof(v) > message_size) { return; }
+
+                out[pos++] = std::is_signed_v<V> ? 'i' : 'u';
+                putBytes(out, pos, &v, sizeof(v));
+            }
+        }
+    }
 };
 
 /// Debug
@@ -78,34 +326,65 @@ private:
 #define Logger_level Logger_level_debug
 #endif
 
+#if defined(KLYAX_LOG_BINARY)
+#define Logger_write(level, name, format, ...) \
+    do { \
+        static constexpr auto klyax_log_site = Logger::makeSite(level, __LINE__, format, __PRETTY_FUNCTION__); \
+        Logger::instance().logBinary(&klyax_log_site, ##__VA_ARGS__); \
+    } while (false)
+#else
+#define Logger_write(level, name, ...)   Logger::instance().log(name, __PRETTY_FUNCTION__, __VA_ARGS__)
+#endif
+
 #if Logger_level_debug >= Logger_level
-#define Logger_debug(...)   Logger::instance().log("Debug",   __PRETTY_FUNCTION__, __VA_ARGS__)
+#define Logger_debug(...)   Logger_write(Logger_level_debug, "Debug", __VA_ARGS__)
 #else
 #define Logger_debug(...)
 #endif
 
 #if Logger_level_info >= Logger_level
-#define Logger_info(...)   Logger::instance().log("Info",   __PRETTY_FUNCTION__, __VA_ARGS__)
+#define Logger_info(...)   Logger_write(Logger_level_info, "Info", __VA_ARGS__)
 #else
 #define Logger_info(...)
 #endif
 
 #if Logger_level_warn >= Logger_level
-#define Logger_warn(...)   Logger::instance().log("Warn",   __PRETTY_FUNCTION__, __VA_ARGS__)
+#define Logger_warn(...)   Logger_write(Logger_level_warn, "Warn", __VA_ARGS__)
 #else
 #define Logger_warn(...)
 #endif
 
 #if Logger_level_error >= Logger_level
-#define Logger_error(...)   Logger::instance().log("Error",   __PRETTY_FUNCTION__, __VA_ARGS__)
+#define Logger_error(...)   Logger_write(Logger_level_error, "Error", __VA_ARGS__)
 #else
 #define Logger_error(...)
 #endif
 
 #if Logger_level_fatal >= Logger_level
-#define Logger_fatal(...)   Logger::instance().log("Fatal",   __PRETTY_FUNCTION__, __VA_ARGS__)
+#define Logger_fatal(...)   Logger_write(Logger_level_fatal, "Fatal", __VA_ARGS__)
 #else
 #define Logger_fatal(...)
 #endif
 
 
+
+
+inline void Logger::reportDropped() {
+    const auto total = getDropped();
+    uint32_t reported = dropped_reported.load(std::memory_order_relaxed);
+
+    do {
+        if (total == reported) { return; }
+    } while (not dropped_reported.compare_exchange_weak(reported, total, std::memory_order_relaxed));
+
+    char buffer[message_size];
+    const int length = snprintf(
+        buffer, sizeof(buffer),
+        "[%lu|Warn|%s] %u messages dropped\n",
+        millis(), __PRETTY_FUNCTION__, static_cast<unsigned>(total - reported)
+    );
+
+    if (length > 0) {
+        write_func(buffer, min(static_cast<size_t>(length), sizeof(buffer) - 1));
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+/// Тройной буфер: один писатель, один читатель, без блокировок
+/// Писатель публикует значение целиком, читатель всегда получает последнее согласованное значение
+/// Обе стороны wait-free: одна атомарная операция на публикацию и на чтение нового значения
+template<typename T> struct TripleBuffer final {
+
+private:
+
+    static constexpr uint32_t index_mask = 0x03;
+
+    /// Средний буфер содержит неполученное читателем значение
+    static constexpr uint32_t fresh_flag = 0x04;
+
+    T buffers[3]{};
+
+    /// Буфер, в который пишет писатель
+    uint32_t back{0};
+
+    /// Обмен между писателем и читателем: индекс | fresh_flag
+    std::atomic<uint32_t> middle{1};
+
+    /// Буфер, который читает читатель
+    uint32_t front{2};
+
+public:
+
+    /// Буфер писателя для заполнения на месте
+    inline T &writeBuffer() { return buffers[back]; }
+
+    /// Опубликовать заполненный writeBuffer()
+    void publish() {
+        back = middle.exchange(back | fresh_flag, std::memory_order_acq_rel) & index_mask;
+    }
+
+    void publish(const T &value) {
+        writeBuffer() = value;
+        publish();
+    }
+
+    /// Есть опубликованное, но не полученное читателем значение
+    inline bool fresh() const { return (middle.load(std::memory_order_acquire) & fresh_flag) != 0; }
+
+    /// Последнее опубликованное значение
+    const T &read() {
+        if (fresh()) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+        }
+        return buffers[front];
+    }
+};
+
+/// Кольцевая очередь: один писатель, один читатель, без блокировок
+/// N - степень двойки, полезная ёмкость N
+template<typename T, uint32_t N> struct SpscQueue final {
+
+    static_assert(N > 0 and (N & (N - 1)) == 0, "N must be a power of two");
+
+private:
+
+    T items[N]{};
+
+    /// Счётчики растут монотонно, индекс - по модулю N
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+
+    /// Отброшено писателем при полной очереди
+    std::atomic<uint32_t> dropped{0};
+
+public:
+
+    /// Слот писателя для заполнения на месте
+    /// nullptr - очередь заполнена
+    T *reserve() {
+        const auto h = head.load(std::memory_order_relaxed);
+
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &items[h & (N - 1)];
+    }
+
+    /// Опубликовать слот, полученный из reserve()
+    void commit() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T &value) {
+        T *slot = reserve();
+        if (slot == nullptr) { return false; }
+
+        *slot = value;
+        commit();
+        return true;
+    }
+
+    /// Первый элемент очереди
+    /// nullptr - очередь пуста
+    const T *front() const {
+        const auto t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) { return nullptr; }
+        return &items[t & (N - 1)];
+    }
+
+    /// Освободить элемент, полученный из front()
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    inline uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
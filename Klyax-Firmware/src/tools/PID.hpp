@@ -1,60 +1,249 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include "Arduino.h"
 #include "tools/filters.hpp"
 
 
 /// Реализация PID регулятора с внешней зависимостью настроек
-struct PID {
+/// T - тип значений, коэффициентов и шага времени (float, double, Fixed)
+template<typename T> struct BasicPID {
 
 public:
 
     struct Settings {
-        float p, i, d, i_limit;
-        float output_abs_max;
+        T p, i, d, i_limit;
+        T output_abs_max;
+    };
+
+    /// Вклады составляющих в последний выход (до ограничения)
+    struct Terms {
+        T p, i, d;
     };
 
 private:
 
+    /// Максимальный шаг времени, больший считается сбоем
+    /// Сек.
+    static constexpr float dt_max = 0.1f;
 
     const Settings &settings;
-    LowFrequencyFilter<float> dx_filter;
-    float dx{0};
-    float ix{0};
-    float last_error{NAN};
+
+    /// Частота среза ФНЧ производной, 0 - без фильтра
+    /// Гц
+    const float dx_cutoff_hz;
+
+    BiquadFilter<1, T> dx_filter{};
+    T dx{};
+    T ix{};
+    T last_error{};
+    bool has_last_error{false};
+    Terms terms{};
 
 public:
 
-    explicit PID(const Settings &settings, float dx_filter_alpha = 1.0f) :
-        settings{settings}, dx_filter{dx_filter_alpha} {}
+    /// sample_rate_hz - частота вызова calc, при её смене - setSampleRate
+    explicit BasicPID(const Settings &settings, float dx_cutoff_hz = 0, float sample_rate_hz = 1000) :
+        settings{settings}, dx_cutoff_hz{dx_cutoff_hz} {
+        setSampleRate(sample_rate_hz);
+    }
+
+    /// Пересчёт фильтра производной под частоту вызова
+    /// Гц
+    void setSampleRate(float sample_rate_hz) {
+        dx_filter.configure(BiquadCoefficients<T>::lowpass(dx_cutoff_hz, sample_rate_hz));
+    }
+
+    T calc(T error, T dt) {
+        const T zero{};
 
-    float calc(float error, float dt) {
-        if (dt <= 0 or dt > 0.1f) {
-            return 0;
+        if (dt <= zero or dt > static_cast<T>(dt_max)) {
+            return zero;
         }
 
-        if (settings.i != 0) {
+        if (settings.i != zero) {
             ix += error * dt;
             ix = constrain(ix, -settings.i_limit, settings.i_limit);
         }
 
-        if (settings.d != 0 and not std::isnan(last_error)) {
+        if (settings.d != zero and has_last_error) {
             dx = dx_filter.calc((error - last_error) / dt);
         } else {
-            dx = 0;
+            dx = zero;
         }
         last_error = error;
+        has_last_error = true;
 
-        const float output = settings.p * error + settings.i * ix + settings.d * dx;
+        terms = {settings.p * error, settings.i * ix, settings.d * dx};
+
+        const T output = terms.p + terms.i + terms.d;
         return constrain(output, -settings.output_abs_max, settings.output_abs_max);
     }
 
     void reset() {
-        dx = 0;
-        ix = 0;
-        last_error = NAN;
+        dx = {};
+        ix = {};
+        has_last_error = false;
+        dx_filter.reset();
+        terms = {};
     }
 
+    inline const Terms &getTerms() const { return terms; }
+
 };
 
+using PID = BasicPID<float>;
+
+/// N регуляторов (по осям) за один проход
+/// Усиления и состояние хранятся массивами по осям (struct of arrays), в цикле по осям нет ветвлений
+/// Отличия от BasicPID:
+/// - D по измерению: скачок уставки не даёт выброса производной
+/// - упреждение по скорости изменения уставки: kff * d(уставка) / dt через ФНЧ (уставка с пульта меняется ступенями)
+/// - интеграл хранится в единицах выхода, при насыщении выхода подтягивается обратно (back-calculation)
+template<size_t N, typename T = float> struct PidBank final {
+
+public:
+
+    /// Вклады составляющих в последний выход (до ограничения)
+    struct Terms {
+        T p, i, d, ff;
+    };
+
+    /// Скорость возврата интеграла при насыщении выхода
+    /// 1 / Сек.
+    static constexpr float back_calculation_rate = 20.0f;
+
+    /// Добротность биквада производной
+    /// Выше Баттерворта (0.707): подъём +1.2 дБ около 0.7 среза, взамен меньше задержка при том же подавлении
+    static constexpr float dx_q = 1.0f;
+
+private:
+
+    /// Максимальный шаг времени, больший считается сбоем
+    /// Сек.
+    static constexpr float dt_max = 0.1f;
+
+    T kp[N]{}, ki[N]{}, kd[N]{}, kff[N]{};
+
+    /// Пределы интеграла и выхода
+    T i_max[N]{}, output_max[N]{};
+
+    /// Частоты среза ФНЧ производной, 0 - без фильтра
+    /// Гц
+    float dx_cutoff_hz[N]{};
+
+    /// Биквад производной: коэффициенты и состояние по осям
+    BiquadCoefficients<T> dx_coefficients[N]{};
+    T dx_z1[N]{}, dx_z2[N]{};
+
+    /// Частота среза ФНЧ производной уставки, 0 - без фильтра
+    /// Гц
+    float ff_cutoff_hz;
+
+    PtFilter<1, N, T> ff_filter{};
+
+    T integral[N]{};
+    T last_setpoint[N]{};
+    T last_measurement[N]{};
+    bool has_last{false};
+
+    T term_p[N]{}, term_i[N]{}, term_d[N]{}, term_ff[N]{};
+
+public:
+
+    /// sample_rate_hz - частота вызова calc, при её смене - setSampleRate
+    explicit PidBank(const float (&dx_cutoff_hz)[N], float sample_rate_hz = 1000, float ff_cutoff_hz = 0) :
+        ff_cutoff_hz{ff_cutoff_hz} {
+        for (size_t a = 0; a < N; a++) { this->dx_cutoff_hz[a] = dx_cutoff_hz[a]; }
+        setSampleRate(sample_rate_hz);
+    }
+
+    /// Усиления оси из настроек BasicPID
+    /// Интеграл в единицах выхода: предел i * i_limit
+    void setGains(size_t axis, const typename BasicPID<T>::Settings &settings, T feed_forward) {
+        kp[axis] = settings.p;
+        ki[axis] = settings.i;
+        kd[axis] = settings.d;
+        kff[axis] = feed_forward;
+        i_max[axis] = settings.i * settings.i_limit;
+        output_max[axis] = settings.output_abs_max;
+    }
+
+    /// Пересчёт фильтров производных под частоту вызова
+    /// Гц
+    void setSampleRate(float sample_rate_hz) {
+        for (size_t a = 0; a < N; a++) {
+            dx_coefficients[a] = BiquadCoefficients<T>::lowpass(dx_cutoff_hz[a], sample_rate_hz, dx_q);
+            dx_z1[a] = {};
+            dx_z2[a] = {};
+        }
+        ff_filter.configure(ff_cutoff_hz, sample_rate_hz);
+    }
+
+    /// setpoint[N], measurement[N] -> output[N]
+    void calc(const T *setpoint, const T *measurement, T dt, T *output) {
+        const T zero{};
+
+        if (dt <= zero or dt > static_cast<T>(dt_max)) {
+            for (size_t a = 0; a < N; a++) { output[a] = zero; }
+            return;
+        }
+
+        // Первый отсчёт: производные уставки и измерения нулевые
+        if (not has_last) {
+            has_last = true;
+            for (size_t a = 0; a < N; a++) {
+                last_setpoint[a] = setpoint[a];
+                last_measurement[a] = measurement[a];
+            }
+        }
+
+        const T inv_dt = static_cast<T>(1) / dt;
+        const T back_calculation = static_cast<T>(back_calculation_rate);
+
+        T setpoint_rate[N];
+        for (size_t a = 0; a < N; a++) {
+            setpoint_rate[a] = (setpoint[a] - last_setpoint[a]) * inv_dt;
+            last_setpoint[a] = setpoint[a];
+        }
+        ff_filter.calc(setpoint_rate);
+
+        for (size_t a = 0; a < N; a++) {
+            const T error = setpoint[a] - measurement[a];
+
+            const T rate = (last_measurement[a] - measurement[a]) * inv_dt;
+            last_measurement[a] = measurement[a];
+
+            const auto &c = dx_coefficients[a];
+            const T dx = c.b0 * rate + dx_z1[a];
+            dx_z1[a] = c.b1 * rate - c.a1 * dx + dx_z2[a];
+            dx_z2[a] = c.b2 * rate - c.a2 * dx;
+
+            term_p[a] = kp[a] * error;
+            term_i[a] = integral[a];
+            term_d[a] = kd[a] * dx;
+            term_ff[a] = kff[a] * setpoint_rate[a];
+
+            const T raw = term_p[a] + term_i[a] + term_d[a] + term_ff[a];
+            const T limited = constrain(raw, -output_max[a], output_max[a]);
+            output[a] = limited;
+
+            const T next = integral[a] + (ki[a] * error + (limited - raw) * back_calculation) * dt;
+            integral[a] = constrain(next, -i_max[a], i_max[a]);
+        }
+    }
+
+    void reset() {
+        for (size_t a = 0; a < N; a++) {
+            dx_z1[a] = {};
+            dx_z2[a] = {};
+            integral[a] = {};
+            term_p[a] = term_i[a] = term_d[a] = term_ff[a] = {};
+        }
+        ff_filter.reset();
+        has_last = false;
+    }
+
+    inline Terms getTerms(size_t axis) const { return {term_p[axis], term_i[axis], term_d[axis], term_ff[axis]}; }
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+/// Набор режимов полёта, известный при компиляции
+/// Активный режим выбирается во время работы по индексу: вызов - цепочка сравнений с прямыми (встраиваемыми) вызовами,
+/// без виртуальных функций и указателей на функции
+///
+/// Режим - тип с методами:
+/// - interpret(control, dt, sample) -> команда смесителю (у всех режимов один тип)
+/// - afterMix(control, dt, sample) - после выдачи команды моторам
+/// - onDisarm()
+/// - onLoopRate(hz) - пересчёт фильтров, у всех режимов сразу и только без полёта: переключение фильтры не сбрасывает
+/// - onEnter() - режим стал активным: сброс или передача состояния (интегралов) от прежнего режима
+template<typename... Modes> struct ModeSwitch final {
+
+    static_assert(sizeof...(Modes) >= 1 and sizeof...(Modes) < UINT8_MAX, "1 .. 254 modes");
+
+    static constexpr uint8_t modes_total = sizeof...(Modes);
+
+private:
+
+    std::tuple<Modes &...> modes;
+
+    /// Режим, выбранный из другой задачи: применяется в управляющей задаче перед следующим отсчётом
+    std::atomic<uint8_t> requested{0};
+    uint8_t active{0};
+
+    template<typename M> static constexpr uint8_t indexOf() {
+        constexpr bool matches[]{std::is_same<M, Modes>::value...};
+
+        for (uint8_t i = 0; i < modes_total; i++) {
+            if (matches[i]) { return i; }
+        }
+
+        return modes_total;
+    }
+
+    template<typename F, size_t... I> void visitActive(F &&f, std::index_sequence<I...>) {
+        static_cast<void>(((active == I ? (f(std::get<I>(modes)), true) : false) or ...));
+    }
+
+    template<typename F> void visitActive(F &&f) {
+        visitActive(std::forward<F>(f), std::index_sequence_for<Modes...>{});
+    }
+
+    template<typename F, size_t... I> void visitAll(F &&f, std::index_sequence<I...>) {
+        static_cast<void>((f(std::get<I>(modes)), ...));
+    }
+
+    void applyRequested() {
+        const uint8_t index = requested.load(std::memory_order_relaxed);
+        if (index == active) { return; }
+
+        active = index;
+        visitActive([](auto &mode) { mode.onEnter(); });
+    }
+
+public:
+
+    explicit ModeSwitch(Modes &...modes) :
+        modes{modes...} {}
+
+    /// Вызывается из любой задачи
+    template<typename M> void select() {
+        static_assert(indexOf<M>() < modes_total, "mode is not in the switch");
+        requested.store(indexOf<M>(), std::memory_order_relaxed);
+    }
+
+    /// Выбран ли режим (с учётом ещё не применённого выбора)
+    template<typename M> bool isSelected() const {
+        return requested.load(std::memory_order_relaxed) == indexOf<M>();
+    }
+
+    /// Управляющая задача, только без полёта: пересчёт сбрасывает состояние фильтров всех режимов
+    /// Гц
+    void setLoopRate(float hz) {
+        visitAll([hz](auto &mode) { mode.onLoopRate(hz); }, std::index_sequence_for<Modes...>{});
+    }
+
+    template<typename C, typename S> auto interpret(const C &control, float dt, const S &sample) {
+        applyRequested();
+
+        decltype(std::get<0>(modes).interpret(control, dt, sample)) command{};
+        visitActive([&](auto &mode) { command = mode.interpret(control, dt, sample); });
+        return command;
+    }
+
+    template<typename C, typename S> void afterMix(const C &control, float dt, const S &sample) {
+        visitActive([&](auto &mode) { mode.afterMix(control, dt, sample); });
+    }
+
+    void onDisarm() {
+        applyRequested();
+        visitActive([](auto &mode) { mode.onDisarm(); });
+    }
+};
+
+/// Путь отсчёта: источник (датчик + оценка ориентации) -> режим полёта -> смеситель
+/// Этапы - параметры шаблона: весь путь собирается с прямыми вызовами,
+/// на хосте те же этапы подменяются моделями (test/test_pipeline)
+///
+/// Source: update(dt) -> отсчёт, setLoopRate(hz)
+/// Modes: см. ModeSwitch
+/// Mixer: mixin(команда), disable()
+template<typename Source, typename Modes, typename Mixer> struct FlightPipeline final {
+
+    Source &source;
+    Modes &modes;
+    Mixer &mixer;
+
+    /// Частота цикла: пересчёт фильтров всех этапов
+    /// Гц
+    void setLoopRate(float hz) {
+        source.setLoopRate(hz);
+        modes.setLoopRate(hz);
+    }
+
+    auto sense(float dt) { return source.update(dt); }
+
+    /// Команда моторам, затем работа режима, которая может подождать (внешние контуры)
+    template<typename C, typename S> void fly(const C &control, float dt, const S &sample) {
+        mixer.mixin(modes.interpret(control, dt, sample));
+        modes.afterMix(control, dt, sample);
+    }
+
+    void stop() {
+        modes.onDisarm();
+        mixer.disable();
+    }
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+/// Профилировщик этапов управляющего цикла по счётчику тактов CPU
+/// Включается флагом сборки KLYAX_PROFILER, без него Profiler_scope ничего не генерирует
+
+#include <array>
+#include <atomic>
+
+#include "Arduino.h"
+
+
+#if defined(KLYAX_PROFILER)
+
+#include "tools/Singleton.hpp"
+
+/// Статистика одного этапа
+/// Пишет только задача, в которой выполняется этап: сброс из другой задачи - запрос, его применяет add()
+struct StageStats final {
+
+    /// Корзина i: [2^i .. 2^(i+1)) тактов
+    static constexpr uint8_t buckets_total = 24;
+
+private:
+
+    std::array<uint32_t, buckets_total> histogram{};
+
+    uint32_t min_cycles{UINT32_MAX};
+    uint32_t max_cycles{0};
+    uint64_t sum_cycles{0};
+    uint32_t samples{0};
+
+    std::atomic<bool> reset_requested{false};
+
+    void reset() {
+        histogram.fill(0);
+        min_cycles = UINT32_MAX;
+        max_cycles = 0;
+        sum_cycles = 0;
+        samples = 0;
+    }
+
+public:
+
+    /// Вызывается из любой задачи
+    inline void requestReset() { reset_requested.store(true, std::memory_order_relaxed); }
+
+    void add(uint32_t cycles) {
+        // Обычная загрузка, а не exchange: замер в горячем пути
+        if (reset_requested.load(std::memory_order_relaxed)) {
+            reset_requested.store(false, std::memory_order_relaxed);
+            reset();
+        }
+
+        min_cycles = std::min(min_cycles, cycles);
+        max_cycles = std::max(max_cycles, cycles);
+        sum_cycles += cycles;
+        samples += 1;
+
+        const uint8_t bucket = 31 - __builtin_clz(cycles | 1);
+        histogram[std::min<uint8_t>(bucket, buckets_total - 1)] += 1;
+    }
+
+    inline uint32_t getSamples() const { return samples; }
+
+    inline uint32_t getMin() const { return samples > 0 ? min_cycles : 0; }
+
+    inline uint32_t getMax() const { return max_cycles; }
+
+    inline uint32_t getMean() const { return samples > 0 ? static_cast<uint32_t>(sum_cycles / samples) : 0; }
+
+    inline uint32_t getBucket(uint8_t index) const { return histogram[index]; }
+};
+
+struct Profiler final : Singleton<Profiler> {
+    friend struct Singleton<Profiler>;
+
+    enum class Stage : uint8_t {
+        /// Управляющий цикл целиком после пробуждения
+        Control,
+
+        /// Транзакции SPI датчика
+        ImuRead,
+
+        /// Фильтры и оценка ориентации
+        ImuProcess,
+
+        /// Behavior::interpret
+        Interpret,
+
+        /// DroneFrameDriver::mixin
+        Mixin,
+
+        /// Внешний контур угла (AngleModeBehavior)
+        Outer,
+
+        /// PageManager::pollEvents
+        Events,
+
+        /// PageManager::render
+        Render,
+
+        /// espnow::Protocol::send
+        Send,
+    };
+
+    static constexpr uint8_t stages_total = static_cast<uint8_t>(Stage::Send) + 1;
+
+    static const char *name(Stage stage) {
+        switch (stage) {
+            case Stage::Control:
+                return "Loop";
+            case Stage::ImuRead:
+                return "SPI";
+            case Stage::ImuProcess:
+                return "Imu";
+            case Stage::Interpret:
+                return "Bhv";
+            case Stage::Mixin:
+                return "Mix";
+            case Stage::Outer:
+                return "Out";
+            case Stage::Events:
+                return "Evt";
+            case Stage::Render:
+                return "Rnd";
+            case Stage::Send:
+                return "Send";
+        }
+        return "?";
+    }
+
+private:
+
+    std::array<StageStats, stages_total> stages{};
+
+public:
+
+    inline StageStats &stats(Stage stage) { return stages[static_cast<uint8_t>(stage)]; }
+
+    /// Сброс всех этапов: каждый этап сбрасывает своя задача при следующем замере
+    /// Вызывается из любой задачи
+    void requestReset() {
+        for (auto &s: stages) {
+            s.requestReset();
+        }
+    }
+};
+
+/// Замер этапа от создания до конца области видимости
+struct ProfileScope final {
+
+private:
+
+    StageStats &stats;
+    const uint32_t start;
+
+public:
+
+    explicit ProfileScope(Profiler::Stage stage) :
+        stats{Profiler::instance().stats(stage)}, start{ESP.getCycleCount()} {}
+
+    ~ProfileScope() {
+        stats.add(ESP.getCycleCount() - start);
+    }
+};
+
+#define Profiler_scope(stage) const ProfileScope klyax_profile_scope{Profiler::Stage::stage}
+
+#else
+
+#define Profiler_scope(stage) do {} while (false)
+
+#endif
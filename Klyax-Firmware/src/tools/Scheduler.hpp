@@ -0,0 +1,293 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "Arduino.h"
+#include "tools/Logger.hpp"
+#include "tools/Singleton.hpp"
+
+
+/// Статистика периода управляющего цикла
+struct JitterStats final {
+
+    /// Диапазон гистограммы отклонений от номинала
+    /// Мкс
+    static constexpr int32_t range_us = 128;
+
+private:
+
+    /// [0] - меньше -range_us, [1 .. 2 * range_us + 1] - по 1 мкс от -range_us до +range_us, [последний] - больше +range_us
+    std::array<uint32_t, 2 * range_us + 3> histogram{};
+
+    uint32_t nominal_us{0};
+    uint32_t min_us{UINT32_MAX};
+    uint32_t max_us{0};
+    uint64_t sum_us{0};
+    uint32_t samples{0};
+    uint32_t overruns{0};
+
+public:
+
+    void reset(uint32_t nominal_period_us) {
+        histogram.fill(0);
+        nominal_us = nominal_period_us;
+        min_us = UINT32_MAX;
+        max_us = 0;
+        sum_us = 0;
+        samples = 0;
+        overruns = 0;
+    }
+
+    void add(uint32_t period_us) {
+        min_us = std::min(min_us, period_us);
+        max_us = std::max(max_us, period_us);
+        sum_us += period_us;
+        samples += 1;
+
+        const int32_t deviation = static_cast<int32_t>(period_us) - static_cast<int32_t>(nominal_us);
+
+        if (deviation < -range_us) {
+            histogram.front() += 1;
+        } else if (deviation > range_us) {
+            histogram.back() += 1;
+        } else {
+            histogram[deviation + range_us + 1] += 1;
+        }
+    }
+
+    /// Пропущенные такты таймера (цикл не успел)
+    void addOverruns(uint32_t count) { overruns += count; }
+
+    inline uint32_t getSamples() const { return samples; }
+
+    inline uint32_t getOverruns() const { return overruns; }
+
+    /// Мкс
+    inline uint32_t getMin() const { return samples > 0 ? min_us : 0; }
+
+    /// Мкс
+    inline uint32_t getMax() const { return max_us; }
+
+    /// Мкс
+    inline uint32_t getMean() const { return samples > 0 ? static_cast<uint32_t>(sum_us / samples) : 0; }
+
+    /// Перцентиль периода
+    /// fraction: [0.0 .. 1.0]
+    /// Мкс
+    uint32_t percentile(float fraction) const {
+        if (samples == 0) { return 0; }
+
+        const auto target = static_cast<uint32_t>(std::ceil(fraction * static_cast<float>(samples)));
+        uint32_t cumulative = 0;
+
+        for (size_t i = 0; i < histogram.size(); i++) {
+            cumulative += histogram[i];
+            if (cumulative < target) { continue; }
+
+            if (i == 0) { return getMin(); }
+            if (i == histogram.size() - 1) { return getMax(); }
+            return nominal_us + static_cast<int32_t>(i) - range_us - 1;
+        }
+
+        return getMax();
+    }
+};
+
+/// Планировщик управляющего цикла с фиксированной частотой
+/// Аппаратный таймер будит задачу уведомлением FreeRTOS
+/// Смена частоты и сброс статистики из других задач - запросы, их применяет управляющая задача в applyRequests
+struct RateScheduler final : Singleton<RateScheduler> {
+    friend struct Singleton<RateScheduler>;
+
+    enum class Rate : uint8_t {
+        Hz500,
+        Hz1000,
+        Hz2000,
+        Hz4000,
+    };
+
+    /// Гц
+    static constexpr uint32_t toHz(Rate rate) {
+        switch (rate) {
+            case Rate::Hz500:
+                return 500;
+            case Rate::Hz1000:
+                return 1000;
+            case Rate::Hz2000:
+                return 2000;
+            case Rate::Hz4000:
+                return 4000;
+        }
+        return 1000;
+    }
+
+private:
+
+    /// Делитель APB (80 МГц): такт таймера 1 мкс
+    static constexpr uint16_t timer_divider = 80;
+
+    /// Задача, которую будит таймер
+    static inline volatile TaskHandle_t task{nullptr};
+
+    hw_timer_t *timer{nullptr};
+
+    /// Пишет только управляющая задача
+    std::atomic<Rate> rate{Rate::Hz1000};
+
+    /// Наибольшая частота: выше частоты выборки датчика такты получали бы повтор отсчёта
+    std::atomic<Rate> max_rate{Rate::Hz4000};
+
+    /// Запросы из других задач
+    std::atomic<Rate> requested_rate{Rate::Hz1000};
+    std::atomic<bool> stats_reset_requested{false};
+    uint32_t last_wake_us{0};
+    uint32_t last_period_us{0};
+    uint32_t ticks_elapsed{1};
+    bool first_wait{true};
+    JitterStats stats{};
+
+public:
+
+    /// Запуск таймера. Будить будет вызывающую задачу
+    bool init(Rate initial_rate, uint8_t timer_index = 0) {
+        Logger_info("init");
+
+        task = xTaskGetCurrentTaskHandle();
+
+        timer = timerBegin(timer_index, timer_divider, true);
+        if (timer == nullptr) {
+            Logger_error("timer %d begin fail", timer_index);
+            return false;
+        }
+
+        timerAttachInterrupt(timer, RateScheduler::onTick, true);
+        requested_rate.store(initial_rate, std::memory_order_relaxed);
+        applyRate(initial_rate);
+
+        Logger_debug("success");
+        return true;
+    }
+
+    /// Наибольшая частота из поддерживаемых, не выше hz (не ниже 500 Гц)
+    static constexpr Rate fastestAtMost(float hz) {
+        if (hz >= toHz(Rate::Hz4000)) { return Rate::Hz4000; }
+        if (hz >= toHz(Rate::Hz2000)) { return Rate::Hz2000; }
+        if (hz >= toHz(Rate::Hz1000)) { return Rate::Hz1000; }
+        return Rate::Hz500;
+    }
+
+    /// Ограничение частоты: запросы выше отклоняются
+    /// Вызывается из любой задачи, применяется управляющей задачей в applyRequests
+    inline void limitRate(Rate limit) { max_rate.store(limit, std::memory_order_relaxed); }
+
+    inline Rate getMaxRate() const { return max_rate.load(std::memory_order_relaxed); }
+
+    /// Запрос смены частоты
+    /// Вызывается из любой задачи, применяется управляющей задачей в applyRequests
+    inline void requestRate(Rate new_rate) { requested_rate.store(new_rate, std::memory_order_relaxed); }
+
+    /// Запрос сброса статистики
+    /// Вызывается из любой задачи
+    inline void requestStatsReset() { stats_reset_requested.store(true, std::memory_order_relaxed); }
+
+    /// Действующая частота
+    inline Rate getRate() const { return rate.load(std::memory_order_relaxed); }
+
+    /// Частота с учётом ещё не применённого запроса
+    inline Rate getRequestedRate() const { return requested_rate.load(std::memory_order_relaxed); }
+
+    /// Управляющая задача, до wait()
+    /// armed - смена частоты в полёте отклоняется: регуляторы и фильтры пересчитываются под новую частоту
+    void applyRequests(bool armed) {
+        if (stats_reset_requested.exchange(false, std::memory_order_relaxed)) {
+            stats.reset(periodUs());
+        }
+
+        Rate new_rate = requested_rate.load(std::memory_order_relaxed);
+
+        if (new_rate > getMaxRate()) {
+            Logger_warn("rate %u Hz refused: limit %u Hz", static_cast<unsigned>(toHz(new_rate)), static_cast<unsigned>(toHz(getMaxRate())));
+            new_rate = std::min(getRate(), getMaxRate());
+            requested_rate.store(new_rate, std::memory_order_relaxed);
+        }
+
+        if (new_rate == getRate()) { return; }
+
+        if (armed) {
+            requested_rate.store(getRate(), std::memory_order_relaxed);
+            Logger_warn("rate change refused: armed");
+            return;
+        }
+
+        applyRate(new_rate);
+    }
+
+    /// Номинальный период
+    /// Мкс
+    inline uint32_t periodUs() const { return 1000000 / toHz(getRate()); }
+
+    /// Блокирует задачу до следующего такта
+    void wait() {
+        const uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        const uint32_t now_us = micros();
+
+        ticks_elapsed = std::max<uint32_t>(ticks, 1);
+
+        if (first_wait) {
+            first_wait = false;
+            last_period_us = periodUs();
+        } else {
+            last_period_us = now_us - last_wake_us;
+            stats.add(last_period_us);
+            stats.addOverruns(ticks_elapsed - 1);
+        }
+
+        last_wake_us = now_us;
+    }
+
+    /// Шаг времени с предыдущего такта с учётом пропущенных тактов
+    /// Сек.
+    inline float dt() const { return static_cast<float>(ticks_elapsed * periodUs()) * 1e-6f; }
+
+    /// Время последнего пробуждения
+    /// Мкс
+    inline uint32_t getLastWake() const { return last_wake_us; }
+
+    /// Измеренный период последнего такта
+    /// Мкс
+    inline uint32_t getLastPeriod() const { return last_period_us; }
+
+    inline const JitterStats &getStats() const { return stats; }
+
+private:
+
+    /// Управляющая задача
+    void applyRate(Rate new_rate) {
+        rate.store(new_rate, std::memory_order_relaxed);
+        stats.reset(periodUs());
+        first_wait = true;
+
+        if (timer == nullptr) { return; }
+
+        timerAlarmDisable(timer);
+        timerWrite(timer, 0);
+        timerAlarmWrite(timer, periodUs(), true);
+        timerAlarmEnable(timer);
+
+        // Такты старого периода, пришедшие до перезапуска таймера, не должны попасть в dt()
+        ulTaskNotifyTake(pdTRUE, 0);
+    }
+
+    static void IRAM_ATTR onTick() {
+        const TaskHandle_t t = task;
+        if (t == nullptr) { return; }
+
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(t, &higher_priority_task_woken);
+
+        if (higher_priority_task_woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 template<typename T> struct Singleton {
     static T &instance() {
         static T instance{};
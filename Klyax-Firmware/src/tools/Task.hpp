@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Arduino.h"
+#include "tools/Logger.hpp"
+
+
+/// Параметры задачи FreeRTOS, закреплённой за ядром
+struct TaskConfig final {
+
+    const char *name;
+
+    /// Байт
+    uint32_t stack_size;
+
+    /// [0 .. configMAX_PRIORITIES - 1]
+    UBaseType_t priority;
+
+    /// 0 - PRO_CPU (Wi-Fi, ESP-NOW), 1 - APP_CPU
+    BaseType_t core;
+
+    /// Создать задачу
+    bool start(TaskFunction_t function, void *parameter = nullptr) const {
+        const auto result = xTaskCreatePinnedToCore(function, name, stack_size, parameter, priority, nullptr, core);
+
+        if (result != pdPASS) {
+            Logger_error("task '%s' create fail", name);
+            return false;
+        }
+
+        Logger_debug("task '%s': core %d, priority %u", name, core, static_cast<unsigned>(priority));
+        return true;
+    }
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "ela/vec3.hpp"
+
+#include "tools/fastmath.hpp"
+#include "tools/filters.hpp"
+
+
+/// Кватернион ориентации: поворот из связанной системы FLU в земную (Z вверх)
+struct Quaternion final {
+    float w{1.0f};
+    float x{0.0f};
+    float y{0.0f};
+    float z{0.0f};
+
+    /// Углы Эйлера, последовательность Z-Y-X
+    /// roll, pitch, yaw: Рад
+    static Quaternion fromEuler(float roll, float pitch, float yaw) {
+        const float cr = std::cos(roll * 0.5f), sr = std::sin(roll * 0.5f);
+        const float cp = std::cos(pitch * 0.5f), sp = std::sin(pitch * 0.5f);
+        const float cy = std::cos(yaw * 0.5f), sy = std::sin(yaw * 0.5f);
+
+        return {
+            cr * cp * cy + sr * sp * sy,
+            sr * cp * cy - cr * sp * sy,
+            cr * sp * cy + sr * cp * sy,
+            cr * cp * sy - sr * sp * cy,
+        };
+    }
+
+    Quaternion operator*(const Quaternion &q) const {
+        return {
+            w * q.w - x * q.x - y * q.y - z * q.z,
+            w * q.x + x * q.w + y * q.z - z * q.y,
+            w * q.y - x * q.z + y * q.w + z * q.x,
+            w * q.z + x * q.y - y * q.x + z * q.w,
+        };
+    }
+
+    inline Quaternion conjugate() const { return {w, -x, -y, -z}; }
+
+    void normalize() {
+        const float n2 = w * w + x * x + y * y + z * z;
+        if (n2 <= 0.0f) { return; }
+
+        const float k = fastmath::invSqrt(n2);
+        w *= k;
+        x *= k;
+        y *= k;
+        z *= k;
+    }
+
+    /// Интегрирование угловой скорости в связанной системе
+    /// g*: Рад / с, dt: Сек.
+    void integrate(float gx, float gy, float gz, float dt) {
+        const float h = 0.5f * dt;
+        const Quaternion q = *this;
+
+        w += (-q.x * gx - q.y * gy - q.z * gz) * h;
+        x += (q.w * gx + q.y * gz - q.z * gy) * h;
+        y += (q.w * gy - q.x * gz + q.z * gx) * h;
+        z += (q.w * gz + q.x * gy - q.y * gx) * h;
+
+        normalize();
+    }
+
+    /// Направление "вверх" земной системы в связанной
+    ela::vec3f up() const {
+        return {
+            2.0f * (x * z - w * y),
+            2.0f * (w * x + y * z),
+            w * w - x * x - y * y + z * z,
+        };
+    }
+
+    /// Углы Эйлера Z-Y-X {Roll, Pitch, Yaw}
+    /// Рад
+    ela::vec3f toEuler() const {
+        return {
+            fastmath::atan2(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y)),
+            std::asin(std::fmax(-1.0f, std::fmin(1.0f, 2.0f * (w * y - z * x)))),
+            fastmath::atan2(2.0f * (w * z + x * y), 1.0f - 2.0f * (y * y + z * z)),
+        };
+    }
+};
+
+/// Оценка ориентации по гироскопу и акселерометру
+/// Входы в системе FLU:
+/// gyro: Рад / с
+/// accel: G, вектор силы тяжести (в покое {0, 0, -1}), как его выдаёт EasyImu
+/// Выход: {Roll, Pitch, Yaw}, Рад
+struct AttitudeEstimator final {
+
+    enum class Kind : uint8_t {
+        /// Два скалярных комплементарных фильтра по углам акселерометра, рыскание - интеграл gyro.z
+        Complementary,
+
+        /// Кватернион с PI-коррекцией по ошибке направления гравитации (Mahony)
+        Mahony,
+
+        /// Кватернион с шагом градиентного спуска к направлению гравитации (Madgwick)
+        Madgwick,
+    };
+
+    static constexpr uint8_t kinds_total = 3;
+
+    static const char *name(Kind kind) {
+        switch (kind) {
+            case Kind::Complementary:
+                return "Compl";
+            case Kind::Mahony:
+                return "Mahony";
+            case Kind::Madgwick:
+                return "Madgwick";
+        }
+        return "?";
+    }
+
+    struct Settings {
+        /// Complementary: вес предсказания по гироскопу
+        float complementary_alpha;
+
+        /// Mahony: пропорциональный коэффициент
+        /// Рад / с
+        float mahony_kp;
+
+        /// Mahony: интегральный коэффициент (оценка смещения гироскопа)
+        /// Рад / с^2
+        float mahony_ki;
+
+        /// Madgwick: шаг градиента
+        /// Рад / с
+        float madgwick_beta;
+
+        /// Коррекция по акселерометру только при |accel| в [1 - gate .. 1 + gate]
+        /// Mahony, Madgwick
+        /// G
+        float accel_gate;
+    };
+
+    static constexpr Settings default_settings{
+        .complementary_alpha = 0.98f,
+        .mahony_kp = 1.0f,
+        .mahony_ki = 0.02f,
+        .madgwick_beta = 0.1f,
+        .accel_gate = 0.5f,
+    };
+
+private:
+
+    const Settings settings;
+    Kind kind{Kind::Complementary};
+    bool first_step{true};
+
+    ComplementaryFilter<float> roll_filter{settings.complementary_alpha};
+    ComplementaryFilter<float> pitch_filter{settings.complementary_alpha};
+    float yaw{0.0f};
+
+    Quaternion q{};
+
+    /// Интеграл ошибки Mahony
+    /// Рад / с
+    ela::vec3f integral{};
+
+public:
+
+    explicit AttitudeEstimator(const Settings &settings = default_settings) :
+        settings{settings} {}
+
+    inline Kind getKind() const { return kind; }
+
+    /// Смена алгоритма: ориентация заново выставляется по акселерометру на следующем отсчёте
+    void setKind(Kind new_kind) {
+        kind = new_kind;
+        reset();
+    }
+
+    void reset() {
+        first_step = true;
+        roll_filter.reset();
+        pitch_filter.reset();
+        yaw = 0.0f;
+        q = {};
+        integral = {};
+    }
+
+    inline const Quaternion &getQuaternion() const { return q; }
+
+    ela::vec3f update(const ela::vec3f &gyro, const ela::vec3f &accel, float dt) {
+        switch (kind) {
+            case Kind::Complementary:
+                return updateComplementary(gyro, accel, dt);
+
+            case Kind::Mahony:
+                if (first_step) { alignToGravity(accel); }
+                updateMahony(gyro, accel, dt);
+                return q.toEuler();
+
+            case Kind::Madgwick:
+                if (first_step) { alignToGravity(accel); }
+                updateMadgwick(gyro, accel, dt);
+                return q.toEuler();
+        }
+
+        return {};
+    }
+
+    /// Угол в [-Pi .. Pi]
+    /// Рад
+    static inline float normalizeAngle(float angle) noexcept { return fastmath::wrapPi(angle); }
+
+private:
+
+    ela::vec3f updateComplementary(const ela::vec3f &gyro, const ela::vec3f &accel, float dt) {
+        first_step = false;
+
+        const float accel_roll = fastmath::atan2(-accel.y, -accel.z);
+        const float accel_pitch = fastmath::atan2(accel.x, std::sqrt(accel.y * accel.y + accel.z * accel.z));
+        yaw += gyro.z * dt;
+
+        return {
+            normalizeAngle(roll_filter.calc(accel_roll, gyro.x, dt)),
+            normalizeAngle(pitch_filter.calc(accel_pitch, gyro.y, dt)),
+            yaw
+        };
+    }
+
+    /// Начальная ориентация по направлению гравитации, рыскание 0
+    void alignToGravity(const ela::vec3f &accel) {
+        first_step = false;
+        q = Quaternion::fromEuler(
+            fastmath::atan2(-accel.y, -accel.z),
+            fastmath::atan2(accel.x, std::sqrt(accel.y * accel.y + accel.z * accel.z)),
+            0.0f
+        );
+    }
+
+    /// Нормированное измеренное направление "вверх"
+    /// false - модуль вне accel_gate, коррекция пропускается
+    bool measuredUp(const ela::vec3f &accel, float &ax, float &ay, float &az) const {
+        const float n2 = accel.x * accel.x + accel.y * accel.y + accel.z * accel.z;
+        if (n2 <= 0.0f) { return false; }
+
+        const float k = -fastmath::invSqrt(n2);
+        if (std::fabs(n2 * k + 1.0f) > settings.accel_gate) { return false; }
+
+        ax = accel.x * k;
+        ay = accel.y * k;
+        az = accel.z * k;
+        return true;
+    }
+
+    void updateMahony(const ela::vec3f &gyro, const ela::vec3f &accel, float dt) {
+        float gx = gyro.x, gy = gyro.y, gz = gyro.z;
+        float ax, ay, az;
+
+        if (measuredUp(accel, ax, ay, az)) {
+            const ela::vec3f v = q.up();
+
+            // Ошибка: поворот от оценённого "вверх" к измеренному
+            const float ex = ay * v.z - az * v.y;
+            const float ey = az * v.x - ax * v.z;
+            const float ez = ax * v.y - ay * v.x;
+
+            integral.x += settings.mahony_ki * ex * dt;
+            integral.y += settings.mahony_ki * ey * dt;
+            integral.z += settings.mahony_ki * ez * dt;
+
+            gx += settings.mahony_kp * ex + integral.x;
+            gy += settings.mahony_kp * ey + integral.y;
+            gz += settings.mahony_kp * ez + integral.z;
+        }
+
+        q.integrate(gx, gy, gz, dt);
+    }
+
+    void updateMadgwick(const ela::vec3f &gyro, const ela::vec3f &accel, float dt) {
+        const float w = q.w, x = q.x, y = q.y, z = q.z;
+
+        // Производная кватерниона по гироскопу
+        float dw = 0.5f * (-x * gyro.x - y * gyro.y - z * gyro.z);
+        float dx = 0.5f * (w * gyro.x + y * gyro.z - z * gyro.y);
+        float dy = 0.5f * (w * gyro.y - x * gyro.z + z * gyro.x);
+        float dz = 0.5f * (w * gyro.z + x * gyro.y - y * gyro.x);
+
+        float ax, ay, az;
+
+        if (measuredUp(accel, ax, ay, az)) {
+            // Целевая функция f = up(q) - a, градиент J^T f
+            const float fx = 2.0f * (x * z - w * y) - ax;
+            const float fy = 2.0f * (w * x + y * z) - ay;
+            const float fz = 2.0f * (0.5f - x * x - y * y) - az;
+
+            float sw = -2.0f * y * fx + 2.0f * x * fy;
+            float sx = 2.0f * z * fx + 2.0f * w * fy - 4.0f * x * fz;
+            float sy = -2.0f * w * fx + 2.0f * z * fy - 4.0f * y * fz;
+            float sz = 2.0f * x * fx + 2.0f * y * fy;
+
+            const float n2 = sw * sw + sx * sx + sy * sy + sz * sz;
+
+            if (n2 > 0.0f) {
+                const float k = settings.madgwick_beta * fastmath::invSqrt(n2);
+                dw -= sw * k;
+                dx -= sx * k;
+                dy -= sy * k;
+                dz -= sz * k;
+            }
+        }
+
+        q.w += dw * dt;
+        q.x += dx * dt;
+        q.y += dy * dt;
+        q.z += dz * dt;
+        q.normalize();
+    }
+};
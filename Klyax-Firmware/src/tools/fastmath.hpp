@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+/// Быстрые приближения для горячего пути (IMU, управление)
+/// На ESP32 float-FPU есть, но atan2f / fmod - программные и медленные
+/// Максимальные ошибки - константы *_max_error, их и выигрыш у libm проверяет test/test_fastmath:
+/// ядро, которое не быстрее libm, здесь не держим (asin, hypot, sin, cos уступали libm на хосте)
+namespace fastmath {
+
+static constexpr float pi = 3.14159265358979f;
+static constexpr float half_pi = 0.5f * pi;
+static constexpr float two_pi = 2.0f * pi;
+static constexpr float inv_two_pi = 1.0f / two_pi;
+
+/// Абсолютная ошибка atan2
+/// Рад
+static constexpr float atan2_max_error = 1e-5f;
+
+/// Относительная ошибка invSqrt
+static constexpr float inv_sqrt_max_relative_error = 1e-5f;
+
+/// Абсолютная ошибка wrapPi при |angle| < 1000 рад (округление аргумента)
+/// Рад
+static constexpr float wrap_max_error = 1e-4f;
+
+/// 1 / sqrt(x), x > 0
+/// Начальное приближение по битам float, две итерации Ньютона
+inline float invSqrt(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5F375A86u - (bits >> 1);
+
+    float y;
+    std::memcpy(&y, &bits, sizeof(y));
+
+    const float half_x = 0.5f * x;
+    y = y * (1.5f - half_x * y * y);
+    y = y * (1.5f - half_x * y * y);
+    return y;
+}
+
+/// atan(z), |z| <= 1: минимаксный полином 11-й степени
+inline float atanUnit(float z) {
+    const float z2 = z * z;
+    return z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f + z2 * (-0.11643287f + z2 * (0.05265332f + z2 * -0.01172120f)))));
+}
+
+/// atan2(y, x), результат в [-Pi .. Pi]
+/// atan2(0, 0) = 0
+inline float atan2(float y, float x) {
+    const float ax = std::fabs(x);
+    const float ay = std::fabs(y);
+
+    if (ax == 0.0f and ay == 0.0f) { return 0.0f; }
+
+    const bool swap = ay > ax;
+    float angle = atanUnit(swap ? ax / ay : ay / ax);
+
+    if (swap) { angle = half_pi - angle; }
+    if (x < 0.0f) { angle = pi - angle; }
+    return y < 0.0f ? -angle : angle;
+}
+
+/// Угол в [-Pi .. Pi] без fmod и ветвлений
+/// Рад
+inline float wrapPi(float angle) {
+    const float turns = angle * inv_two_pi;
+    const auto n = static_cast<int32_t>(turns + (turns >= 0.0f ? 0.5f : -0.5f));
+    return angle - static_cast<float>(n) * two_pi;
+}
+
+}
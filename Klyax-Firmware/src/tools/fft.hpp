@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+
+/// Спектр вещественного сигнала: окно Ханна и комплексное БПФ radix-2
+/// Таблицы окна и поворотных множителей считаются один раз в конструкторе
+/// N - степень двойки
+template<size_t N> struct RealSpectrum final {
+
+    static_assert(N >= 8 and (N & (N - 1)) == 0, "N must be a power of two");
+
+    /// Полос в спектре: 0 .. N / 2
+    static constexpr size_t bins = N / 2 + 1;
+
+private:
+
+    float window[N]{};
+    float cos_table[N / 2]{};
+    float sin_table[N / 2]{};
+    uint16_t reversed[N]{};
+
+    /// Рабочие массивы (struct of arrays)
+    float re[N]{};
+    float im[N]{};
+
+public:
+
+    RealSpectrum() {
+        for (size_t i = 0; i < N; i++) {
+            window[i] = 0.5f - 0.5f * std::cos(static_cast<float>(M_TWOPI) * static_cast<float>(i) / static_cast<float>(N));
+        }
+
+        for (size_t i = 0; i < N / 2; i++) {
+            const float angle = -static_cast<float>(M_TWOPI) * static_cast<float>(i) / static_cast<float>(N);
+            cos_table[i] = std::cos(angle);
+            sin_table[i] = std::sin(angle);
+        }
+
+        uint8_t bits = 0;
+        while ((size_t{1} << bits) < N) { bits++; }
+
+        for (size_t i = 0; i < N; i++) {
+            uint16_t r = 0;
+            for (uint8_t b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            reversed[i] = r;
+        }
+    }
+
+    /// Квадрат модуля спектра
+    /// input[N] - отсчёты по порядку, начиная с first (кольцевой буфер)
+    /// power[bins]
+    void compute(const float *input, size_t first, float *power) {
+        // Среднее убирается, чтобы нулевая полоса не просачивалась в соседние через окно
+        float mean = 0;
+        for (size_t i = 0; i < N; i++) { mean += input[i]; }
+        mean /= static_cast<float>(N);
+
+        for (size_t i = 0; i < N; i++) {
+            re[reversed[i]] = (input[(first + i) & (N - 1)] - mean) * window[i];
+            im[reversed[i]] = 0;
+        }
+
+        for (size_t size = 2; size <= N; size <<= 1) {
+            const size_t half = size / 2;
+            const size_t step = N / size;
+
+            for (size_t start = 0; start < N; start += size) {
+                for (size_t k = 0; k < half; k++) {
+                    const float wr = cos_table[k * step];
+                    const float wi = sin_table[k * step];
+                    const size_t a = start + k;
+                    const size_t b = a + half;
+
+                    const float tr = re[b] * wr - im[b] * wi;
+                    const float ti = re[b] * wi + im[b] * wr;
+
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+
+        for (size_t k = 0; k < bins; k++) {
+            power[k] = re[k] * re[k] + im[k] * im[k];
+        }
+    }
+};
@@ -1,17 +1,25 @@
 #pragma once
 
-template<typename T> struct LowFrequencyFilter {
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "ela/vec3.hpp"
+
+/// T - тип значения (float, double, ela::vec3f, Fixed)
+/// C - тип коэффициентов: T * C должно давать T
+template<typename T, typename C = float> struct LowFrequencyFilter {
 
 private:
 
-    const float alpha;
-    const float one_minus_alpha{1.0f - alpha};
+    const C alpha;
+    const C one_minus_alpha{static_cast<C>(1) - alpha};
     T filtered{};
     bool first_step{false};
 
 public:
 
-    explicit LowFrequencyFilter(float alpha) noexcept:
+    explicit LowFrequencyFilter(C alpha) noexcept:
         alpha{alpha} {}
 
     const T &calc(const T &x) noexcept {
@@ -21,7 +29,7 @@ public:
             return filtered;
         }
 
-        if (alpha == 1.0) {
+        if (alpha == static_cast<C>(1)) {
             filtered = x;
             return filtered;
         }
@@ -35,27 +43,28 @@ public:
     }
 };
 
-template<typename T> struct ComplementaryFilter {
+/// T - тип значения, C - тип коэффициентов и шага времени
+template<typename T, typename C = float> struct ComplementaryFilter {
 
 private:
 
-    const float alpha;
-    const float one_minus_alpha{1.0f - alpha};
+    const C alpha;
+    const C one_minus_alpha{static_cast<C>(1) - alpha};
     T filtered{};
     bool first_step{true};
 
 public:
 
-    explicit ComplementaryFilter(float alpha) :
+    explicit ComplementaryFilter(C alpha) :
         alpha{alpha} {}
 
-    const T &calc(T x, T dx, float dt) {
+    const T &calc(T x, T dx, C dt) {
         if (first_step) {
             first_step = false;
             filtered = x;
         } else {
             T prediction = filtered + dx * dt;
-            filtered = alpha * prediction + one_minus_alpha * x;
+            filtered = prediction * alpha + x * one_minus_alpha;
         }
 
         return filtered;
@@ -65,3 +74,186 @@ public:
         first_step = true;
     }
 };
+
+/// Коэффициенты биквадратного фильтра (нормированы на a0)
+/// Расчёт по частоте в Гц и частоте дискретизации - один раз при настройке
+template<typename T = float> struct BiquadCoefficients {
+
+    /// Добротность фильтра Баттерворта 2-го порядка
+    static constexpr float butterworth_q = 0.70710678f;
+
+    T b0{static_cast<T>(1)}, b1{}, b2{}, a1{}, a2{};
+
+    /// Без фильтрации
+    static BiquadCoefficients passthrough() { return {}; }
+
+    /// ФНЧ
+    /// cutoff_hz <= 0 или выше 0.45 * sample_rate_hz - без фильтрации
+    static BiquadCoefficients lowpass(float cutoff_hz, float sample_rate_hz, float q = butterworth_q) {
+        if (not isValid(cutoff_hz, sample_rate_hz)) { return passthrough(); }
+
+        const float w0 = static_cast<float>(M_TWOPI) * cutoff_hz / sample_rate_hz;
+        const float cos_w0 = std::cos(w0);
+        const float alpha = std::sin(w0) / (2.0f * q);
+        const float k = 1.0f / (1.0f + alpha);
+
+        return make(
+            0.5f * (1.0f - cos_w0) * k,
+            (1.0f - cos_w0) * k,
+            0.5f * (1.0f - cos_w0) * k,
+            -2.0f * cos_w0 * k,
+            (1.0f - alpha) * k
+        );
+    }
+
+    /// Режекторный фильтр
+    /// q = center_hz / ширина полосы
+    static BiquadCoefficients notch(float center_hz, float sample_rate_hz, float q) {
+        if (not isValid(center_hz, sample_rate_hz)) { return passthrough(); }
+
+        const float w0 = static_cast<float>(M_TWOPI) * center_hz / sample_rate_hz;
+        const float cos_w0 = std::cos(w0);
+        const float alpha = std::sin(w0) / (2.0f * q);
+        const float k = 1.0f / (1.0f + alpha);
+
+        return make(k, -2.0f * cos_w0 * k, k, -2.0f * cos_w0 * k, (1.0f - alpha) * k);
+    }
+
+private:
+
+    static bool isValid(float frequency_hz, float sample_rate_hz) {
+        return frequency_hz > 0.0f and sample_rate_hz > 0.0f and frequency_hz < 0.45f * sample_rate_hz;
+    }
+
+    static BiquadCoefficients make(float b0, float b1, float b2, float a1, float a2) {
+        return {static_cast<T>(b0), static_cast<T>(b1), static_cast<T>(b2), static_cast<T>(a1), static_cast<T>(a2)};
+    }
+};
+
+/// Биквадратный фильтр, Direct Form II transposed
+/// N независимых каналов с общими коэффициентами, состояние по каналам (struct of arrays)
+/// Первый отсчёт выставляет установившееся состояние (без переходного процесса от 0)
+template<size_t N, typename T = float> struct BiquadFilter {
+
+private:
+
+    BiquadCoefficients<T> coefficients{};
+    T z1[N]{};
+    T z2[N]{};
+    bool first_step{true};
+
+public:
+
+    void configure(const BiquadCoefficients<T> &c) {
+        coefficients = c;
+        first_step = true;
+    }
+
+    /// Смена коэффициентов без сброса состояния (подстройка на ходу)
+    inline void retune(const BiquadCoefficients<T> &c) { coefficients = c; }
+
+    inline const BiquadCoefficients<T> &getCoefficients() const { return coefficients; }
+
+    /// Фильтрация на месте: x[N]
+    void calc(T *x) {
+        const auto &c = coefficients;
+
+        if (first_step) {
+            first_step = false;
+
+            for (size_t i = 0; i < N; i++) {
+                z1[i] = x[i] - c.b0 * x[i];
+                z2[i] = c.b2 * x[i] - c.a2 * x[i];
+            }
+        }
+
+        for (size_t i = 0; i < N; i++) {
+            const T y = c.b0 * x[i] + z1[i];
+            z1[i] = c.b1 * x[i] - c.a1 * y + z2[i];
+            z2[i] = c.b2 * x[i] - c.a2 * y;
+            x[i] = y;
+        }
+    }
+
+    T calc(T x) {
+        static_assert(N == 1, "scalar calc requires N == 1");
+        calc(&x);
+        return x;
+    }
+
+    ela::vec3f calc(const ela::vec3f &v) {
+        static_assert(N == 3, "vec3 calc requires N == 3");
+        float x[3]{v.x, v.y, v.z};
+        calc(x);
+        return {x[0], x[1], x[2]};
+    }
+
+    void reset() {
+        first_step = true;
+    }
+};
+
+/// ФНЧ порядка Order из одинаковых звеньев первого порядка (PT1, PT2, PT3)
+/// Частота среза каждого звена поднята так, чтобы у всего фильтра срез (-3 дБ) был на cutoff_hz
+/// N каналов, состояние по каналам (struct of arrays)
+template<uint8_t Order, size_t N, typename T = float> struct PtFilter {
+    static_assert(Order >= 1 and Order <= 3, "order must be 1 .. 3");
+
+private:
+
+    T k{static_cast<T>(1)};
+    T state[Order][N]{};
+    bool first_step{true};
+
+public:
+
+    /// cutoff_hz <= 0 - без фильтрации
+    void configure(float cutoff_hz, float sample_rate_hz) {
+        first_step = true;
+
+        if (cutoff_hz <= 0.0f or sample_rate_hz <= 0.0f) {
+            k = static_cast<T>(1);
+            return;
+        }
+
+        // 1 / sqrt(2^(1 / n) - 1)
+        const float correction = 1.0f / std::sqrt(std::pow(2.0f, 1.0f / Order) - 1.0f);
+        const float rc = 1.0f / (static_cast<float>(M_TWOPI) * cutoff_hz * correction);
+        const float dt = 1.0f / sample_rate_hz;
+        k = static_cast<T>(dt / (rc + dt));
+    }
+
+    void calc(T *x) {
+        if (first_step) {
+            first_step = false;
+
+            for (uint8_t o = 0; o < Order; o++) {
+                for (size_t i = 0; i < N; i++) { state[o][i] = x[i]; }
+            }
+        }
+
+        for (uint8_t o = 0; o < Order; o++) {
+            for (size_t i = 0; i < N; i++) {
+                state[o][i] = state[o][i] + (x[i] - state[o][i]) * k;
+                x[i] = state[o][i];
+            }
+        }
+    }
+
+    T calc(T x) {
+        static_assert(N == 1, "scalar calc requires N == 1");
+        calc(&x);
+        return x;
+    }
+
+    ela::vec3f calc(const ela::vec3f &v) {
+        static_assert(N == 3, "vec3 calc requires N == 3");
+        float x[3]{v.x, v.y, v.z};
+        calc(x);
+        return {x[0], x[1], x[2]};
+    }
+
+    void reset() {
+        first_step = true;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+
+/// Число с фиксированной точкой в формате Q(31 - F).F
+/// Арифметика целочисленная: результат одинаков на хосте и на ESP32 (бит в бит)
+/// Переполнение не контролируется: диапазон [-2^(31 - F) .. 2^(31 - F))
+template<uint8_t F> struct Fixed final {
+    static_assert(F > 0 and F < 31, "fraction bits must be in [1 .. 30]");
+
+    static constexpr uint8_t fraction_bits = F;
+    static constexpr int32_t one = int32_t{1} << F;
+
+    int32_t raw{0};
+
+    constexpr Fixed() = default;
+
+    explicit constexpr Fixed(int value) :
+        raw{static_cast<int32_t>(value * one)} {}
+
+    /// Округление к ближайшему
+    explicit constexpr Fixed(float value) :
+        raw{static_cast<int32_t>(value * static_cast<float>(one) + (value >= 0 ? 0.5f : -0.5f))} {}
+
+    explicit constexpr Fixed(double value) :
+        raw{static_cast<int32_t>(value * static_cast<double>(one) + (value >= 0 ? 0.5 : -0.5))} {}
+
+    static constexpr Fixed fromRaw(int32_t raw) {
+        Fixed result;
+        result.raw = raw;
+        return result;
+    }
+
+    constexpr float toFloat() const { return static_cast<float>(raw) / static_cast<float>(one); }
+
+    explicit constexpr operator float() const { return toFloat(); }
+
+    explicit constexpr operator double() const { return static_cast<double>(raw) / static_cast<double>(one); }
+
+    constexpr Fixed operator-() const { return fromRaw(-raw); }
+
+    constexpr Fixed operator+(Fixed b) const { return fromRaw(raw + b.raw); }
+
+    constexpr Fixed operator-(Fixed b) const { return fromRaw(raw - b.raw); }
+
+    /// Произведение через 64 бит, усечение к -inf
+    constexpr Fixed operator*(Fixed b) const { return fromRaw(static_cast<int32_t>((static_cast<int64_t>(raw) * b.raw) >> F)); }
+
+    /// Делитель не проверяется на 0
+    constexpr Fixed operator/(Fixed b) const { return fromRaw(static_cast<int32_t>((static_cast<int64_t>(raw) * one) / b.raw)); }
+
+    constexpr Fixed &operator+=(Fixed b) { return *this = *this + b; }
+
+    constexpr Fixed &operator-=(Fixed b) { return *this = *this - b; }
+
+    constexpr Fixed &operator*=(Fixed b) { return *this = *this * b; }
+
+    constexpr bool operator==(Fixed b) const { return raw == b.raw; }
+
+    constexpr bool operator!=(Fixed b) const { return raw != b.raw; }
+
+    constexpr bool operator<(Fixed b) const { return raw < b.raw; }
+
+    constexpr bool operator>(Fixed b) const { return raw > b.raw; }
+
+    constexpr bool operator<=(Fixed b) const { return raw <= b.raw; }
+
+    constexpr bool operator>=(Fixed b) const { return raw >= b.raw; }
+};
+
+/// Q15.16: диапазон ±32768, шаг 1.5e-5
+using Q16 = Fixed<16>;
+
+/// Q11.20: диапазон ±2048, шаг 9.5e-7
+using Q20 = Fixed<20>;
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+/// Строка матрицы смешивания: вклад команд в мотор (вклад тяги всегда 1)
+struct MixerRow final {
+    float roll, pitch, yaw;
+};
+
+/// Положение мотора на раме
+struct MotorPlacement final {
+    /// Любые единицы, важно только отношение
+    float forward, left;
+
+    /// +1 - против часовой, -1 - по часовой
+    int8_t spin;
+};
+
+/// Матрица смешивания рамы из N моторов
+template<size_t N> struct FrameGeometry final {
+
+    static constexpr size_t motors_total = N;
+
+    MixerRow rows[N];
+
+    /// Плечи нормируются на наибольшее: отношение крена и тангажа сохраняется
+    /// Положительные команды (FLU, правый винт): крен - к моторам слева (левый борт вверх),
+    /// тангаж - к моторам сзади (нос вниз), рыскание - к моторам против часовой
+    static constexpr FrameGeometry fromPlacement(const MotorPlacement (&motors)[N]) {
+        float arm_max = 0;
+        for (const auto &m : motors) {
+            arm_max = std::max(arm_max, std::max(m.forward < 0 ? -m.forward : m.forward, m.left < 0 ? -m.left : m.left));
+        }
+
+        FrameGeometry geometry{};
+        for (size_t i = 0; i < N; i++) {
+            geometry.rows[i] = {
+                motors[i].left / arm_max,
+                -motors[i].forward / arm_max,
+                static_cast<float>(motors[i].spin),
+            };
+        }
+
+        return geometry;
+    }
+};
+
+/// Рамы: моторы в порядке выходов
+namespace frame {
+
+/// Задний левый, задний правый, передний правый, передний левый
+struct QuadX final {
+    static constexpr auto geometry = FrameGeometry<4>::fromPlacement({
+        {-1.0f, +1.0f, +1},
+        {-1.0f, -1.0f, -1},
+        {+1.0f, -1.0f, +1},
+        {+1.0f, +1.0f, -1},
+    });
+};
+
+/// Задний, правый, передний, левый
+struct QuadPlus final {
+    static constexpr auto geometry = FrameGeometry<4>::fromPlacement({
+        {-1.0f, 0.0f, +1},
+        {0.0f, -1.0f, -1},
+        {+1.0f, 0.0f, +1},
+        {0.0f, +1.0f, -1},
+    });
+};
+
+/// Как QuadX, рама шире, чем длиннее: плечо тангажа короче
+struct QuadH final {
+    static constexpr auto geometry = FrameGeometry<4>::fromPlacement({
+        {-0.6f, +1.0f, +1},
+        {-0.6f, -1.0f, -1},
+        {+0.6f, -1.0f, +1},
+        {+0.6f, +1.0f, -1},
+    });
+};
+
+/// По часовой от переднего правого: моторы через 60°, правый и левый - поперёк
+struct HexX final {
+    static constexpr auto geometry = FrameGeometry<6>::fromPlacement({
+        {+0.866f, -0.5f, +1},
+        {0.0f, -1.0f, -1},
+        {-0.866f, -0.5f, +1},
+        {-0.866f, +0.5f, -1},
+        {0.0f, +1.0f, +1},
+        {+0.866f, +0.5f, -1},
+    });
+};
+
+}
+
+/// Смеситель по матрице рамы с групповым ограничением (airmode)
+/// Вклад крена, тангажа и рыскания шире диапазона [0 .. 1] - сжимается для всех моторов одинаково,
+/// затем тяга сдвигается так, чтобы все моторы остались в диапазоне: соотношение команд ориентации сохраняется
+/// и на малом, и на полном газе. Верх диапазона - потолок выхода (ceiling, просадка питания). Без airmode (до первого подъёма газа) нижний сдвиг не делается: на земле моторы стоят
+template<typename Frame> struct MatrixMixer final {
+
+    static constexpr size_t motors_total = decltype(Frame::geometry)::motors_total;
+
+    /// airmode включается, когда тяга первый раз достигнет
+    static constexpr float airmode_activate_thrust = 0.25f;
+
+private:
+
+    bool airmode{false};
+
+public:
+
+    /// Выключить airmode до следующего подъёма газа (снятие с охраны)
+    inline void reset() { airmode = false; }
+
+    inline bool isAirmode() const { return airmode; }
+
+    /// outputs: [0.0 .. ceiling]
+    /// ceiling - наибольшая команда, которую мотор ещё выполнит (ThrustLinearizer::getThrustMax)
+    void mix(float thrust, float roll, float pitch, float yaw, float (&outputs)[motors_total], float ceiling = 1.0f) {
+        constexpr auto &rows = Frame::geometry.rows;
+
+        airmode = airmode or thrust >= airmode_activate_thrust;
+
+        float low = 0;
+        float high = 0;
+
+        for (size_t i = 0; i < motors_total; i++) {
+            outputs[i] = roll * rows[i].roll + pitch * rows[i].pitch + yaw * rows[i].yaw;
+            low = std::min(low, outputs[i]);
+            high = std::max(high, outputs[i]);
+        }
+
+        // Ориентация не помещается в диапазон: сжатие всех моторов одним множителем
+        const float range = high - low;
+
+        if (range > ceiling) {
+            const float k = ceiling / range;
+            for (auto &output : outputs) { output *= k; }
+            low *= k;
+            high *= k;
+        }
+
+        thrust = std::min(std::max(thrust, 0.0f), ceiling - high);
+        if (airmode) { thrust = std::max(thrust, -low); }
+
+        for (auto &output : outputs) {
+            output = std::max(output + thrust, 0.0f);
+        }
+    }
+};
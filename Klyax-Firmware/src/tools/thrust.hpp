@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+/// Таблица линеаризации тяги: скважность [0 .. 1] на равномерной сетке тяги [0 .. 1]
+/// Хранится в Storage: по умолчанию строится из модели при компиляции, заменяется замером на стенде
+struct ThrustLut final {
+
+    static constexpr uint8_t points = 33;
+    static constexpr uint8_t segments = points - 1;
+
+    /// Скважность для тяги i / segments
+    float duty[points];
+
+    /// Напряжение питания при снятии кривой
+    /// В
+    float nominal_voltage;
+
+    /// Обращение замера
+    /// thrust_at_duty[K]: тяга при скважности k / (K - 1), неубывающая, нормируется на последнюю точку
+    template<size_t K> static constexpr ThrustLut fromSamples(const float (&thrust_at_duty)[K], float nominal_voltage) {
+        static_assert(K >= 2, "at least two samples");
+        return fromSamples(thrust_at_duty, K, nominal_voltage);
+    }
+
+    /// Замер, полученный во время работы (см. isValidSamples)
+    static constexpr ThrustLut fromSamples(const float *thrust_at_duty, size_t count, float nominal_voltage) {
+        ThrustLut lut{};
+        lut.nominal_voltage = nominal_voltage;
+
+        const float max_thrust = thrust_at_duty[count - 1];
+        size_t k = 1;
+
+        for (uint8_t i = 0; i < points; i++) {
+            const float thrust = max_thrust * static_cast<float>(i) / static_cast<float>(segments);
+            while (k < count - 1 and thrust_at_duty[k] < thrust) { k++; }
+
+            const float t0 = thrust_at_duty[k - 1];
+            const float t1 = thrust_at_duty[k];
+            const float f = t1 > t0 ? (thrust - t0) / (t1 - t0) : 0.0f;
+
+            lut.duty[i] = (static_cast<float>(k - 1) + f) / static_cast<float>(count - 1);
+        }
+
+        return lut;
+    }
+
+    /// Не меньше двух точек, тяга неубывающая, последняя больше нуля
+    static bool isValidSamples(const float *thrust_at_duty, size_t count) {
+        if (count < 2 or thrust_at_duty[0] < 0.0f or thrust_at_duty[count - 1] <= 0.0f) { return false; }
+
+        for (size_t k = 1; k < count; k++) {
+            if (thrust_at_duty[k] < thrust_at_duty[k - 1]) { return false; }
+        }
+
+        return true;
+    }
+
+    /// Модель: тяга = (1 - expo) * d + expo * d^2
+    /// expo = 1 - чистая квадратичная (тяга ~ обороты^2, обороты ~ скважность)
+    static constexpr ThrustLut fromExpo(float expo, float nominal_voltage) {
+        constexpr size_t samples_total = 257;
+        float samples[samples_total]{};
+
+        for (size_t k = 0; k < samples_total; k++) {
+            const float d = static_cast<float>(k) / static_cast<float>(samples_total - 1);
+            samples[k] = (1.0f - expo) * d + expo * d * d;
+        }
+
+        return fromSamples(samples, nominal_voltage);
+    }
+};
+
+/// Перевод тяги в такты ШИМ по ThrustLut
+/// Отрезки таблицы заранее приведены к offset + slope * x (x = тяга * segments) в тактах ШИМ с поправкой напряжения:
+/// на мотор одно умножение-сложение вместо умножения на период
+struct ThrustLinearizer final {
+
+    /// Пределы поправки напряжения
+    static constexpr float voltage_factor_min = 0.8f;
+    static constexpr float voltage_factor_max = 1.5f;
+
+private:
+
+    struct Segment {
+        float offset, slope;
+    };
+
+    Segment table[ThrustLut::segments]{};
+
+    /// Такты ШИМ
+    float duty_limit{0};
+
+    float voltage_factor{1.0f};
+
+    /// Тяга, при которой скважность с поправкой напряжения достигает периода [0 .. 1]
+    float thrust_max{1.0f};
+
+public:
+
+    /// duty_max - полный период ШИМ в тактах
+    /// voltage_factor = номинальное / текущее напряжение: скважность растёт при разряде
+    void configure(const ThrustLut &lut, uint32_t duty_max, float factor) {
+        voltage_factor = std::min(std::max(factor, voltage_factor_min), voltage_factor_max);
+        duty_limit = static_cast<float>(duty_max);
+
+        const float scale = duty_limit * voltage_factor;
+
+        for (uint8_t i = 0; i < ThrustLut::segments; i++) {
+            const float d0 = lut.duty[i] * scale;
+            const float d1 = lut.duty[i + 1] * scale;
+            table[i].slope = d1 - d0;
+            table[i].offset = d0 - table[i].slope * static_cast<float>(i);
+        }
+
+        // Просадка: полный период достигается раньше полной тяги
+        const float duty_reachable = 1.0f / voltage_factor;
+        thrust_max = 1.0f;
+
+        for (uint8_t i = 0; i < ThrustLut::segments; i++) {
+            if (lut.duty[i + 1] < duty_reachable) { continue; }
+
+            const float span = lut.duty[i + 1] - lut.duty[i];
+            const float f = span > 0 ? (duty_reachable - lut.duty[i]) / span : 0.0f;
+            thrust_max = std::min((static_cast<float>(i) + f) / static_cast<float>(ThrustLut::segments), 1.0f);
+            break;
+        }
+    }
+
+    inline float getVoltageFactor() const { return voltage_factor; }
+
+    /// Наибольшая тяга без упора в период ШИМ: потолок смесителя
+    inline float getThrustMax() const { return thrust_max; }
+
+    /// thrust [0.0 .. 1.0] -> [0 .. duty_max]
+    inline uint32_t toDuty(float thrust) const {
+        const float x = std::min(std::max(thrust, 0.0f), 1.0f) * static_cast<float>(ThrustLut::segments);
+        const auto i = std::min(static_cast<uint32_t>(x), static_cast<uint32_t>(ThrustLut::segments - 1));
+        const float duty = table[i].offset + table[i].slope * x;
+        return static_cast<uint32_t>(std::min(duty, duty_limit));
+    }
+};
@@ -0,0 +1,280 @@
+#include "Arduino.h"
+#include "EasyImu.hpp"
+#include "tools/attitude.hpp"
+
+#if defined(KLYAX_NATIVE)
+#include <cstdlib>
+#include <cstring>
+#endif
+
+// Сравнение алгоритмов оценки ориентации: такты на отсчёт и ошибка крена / тангажа
+// Синтетика: известная траектория, гироскоп с шумом и смещением, акселерометр с шумом
+// Запись (только native): CSV самописца, KLYAX_BLACKBOX_CSV=session-001.csv
+// Эталон записи - углы, посчитанные на борту
+
+
+/// Период отсчёта (FIFO, 1125 Гц)
+/// Сек.
+static constexpr float sample_dt = 1.0f / 1125.0f;
+
+/// Время сходимости, не входит в ошибку
+/// Сек.
+static constexpr float settle_s = 2.0f;
+
+struct Sample {
+    ela::vec3f gyro;
+    ela::vec3f accel;
+    ela::vec3f truth;
+    float dt;
+};
+
+struct ErrorStats {
+    double sum_sq{0};
+    float max{0};
+    uint32_t count{0};
+
+    void add(float error) {
+        const float e = std::fabs(AttitudeEstimator::normalizeAngle(error));
+        sum_sq += e * e;
+        max = std::max(max, e);
+        count += 1;
+    }
+
+    inline float rmsDeg() const { return count > 0 ? static_cast<float>(std::sqrt(sum_sq / count)) * RAD_TO_DEG : 0; }
+
+    inline float maxDeg() const { return max * RAD_TO_DEG; }
+};
+
+/// Источник отсчётов
+/// next(): false - данные кончились
+struct Scenario {
+    const char *name;
+
+    virtual ~Scenario() = default;
+
+    virtual void restart() = 0;
+
+    virtual bool next(Sample &sample) = 0;
+};
+
+/// Синтетическая траектория по углам Эйлера
+struct SyntheticScenario final : Scenario {
+
+    /// Амплитуды
+    /// Рад
+    float roll_amplitude, pitch_amplitude;
+
+    /// Рад / с
+    float yaw_rate;
+
+    float duration_s;
+
+    /// Смещение гироскопа по X
+    /// Рад / с
+    float gyro_bias;
+
+    uint32_t step{0};
+    uint32_t seed{1};
+
+    SyntheticScenario(const char *name, float roll_amplitude, float pitch_amplitude, float yaw_rate, float duration_s, float gyro_bias) :
+        roll_amplitude{roll_amplitude}, pitch_amplitude{pitch_amplitude}, yaw_rate{yaw_rate}, duration_s{duration_s}, gyro_bias{gyro_bias} {
+        this->name = name;
+    }
+
+    void restart() override {
+        step = 0;
+        seed = 1;
+    }
+
+    bool next(Sample &sample) override {
+        const float t = static_cast<float>(step) * sample_dt;
+        if (t > duration_s) { return false; }
+        step += 1;
+
+        const Quaternion q0 = attitude(t);
+        const Quaternion q1 = attitude(t + sample_dt);
+
+        // Угловая скорость в связанной системе: 2 * q0^-1 * q1 / dt
+        const Quaternion dq = q0.conjugate() * q1;
+        const float k = 2.0f / sample_dt;
+
+        sample.gyro = {
+            dq.x * k + gyro_bias + noise(0.01f),
+            dq.y * k + noise(0.01f),
+            dq.z * k + noise(0.01f),
+        };
+
+        const ela::vec3f up = q0.up();
+        sample.accel = {-up.x + noise(0.02f), -up.y + noise(0.02f), -up.z + noise(0.02f)};
+        sample.truth = q0.toEuler();
+        sample.dt = sample_dt;
+        return true;
+    }
+
+private:
+
+    Quaternion attitude(float t) const {
+        return Quaternion::fromEuler(
+            roll_amplitude * std::sin(static_cast<float>(M_TWOPI) * 0.5f * t),
+            pitch_amplitude * std::sin(static_cast<float>(M_TWOPI) * 0.3f * t + 1.0f),
+            yaw_rate * t
+        );
+    }
+
+    /// Равномерный шум [-amplitude .. amplitude]
+    float noise(float amplitude) {
+        seed = seed * 1664525u + 1013904223u;
+        return amplitude * (static_cast<float>(seed >> 8) * (2.0f / 16777216.0f) - 1.0f);
+    }
+};
+
+#if defined(KLYAX_NATIVE)
+
+/// CSV сессии самописца (python -m klyax blackbox)
+struct RecordedScenario final : Scenario {
+
+    enum Column : uint8_t {
+        TimeUs,
+        GyroX, GyroY, GyroZ,
+        AccelX, AccelY, AccelZ,
+        Roll, Pitch, Yaw,
+        ColumnsTotal,
+    };
+
+    static constexpr const char *column_names[ColumnsTotal] = {
+        "time_us",
+        "gyro_x_dps", "gyro_y_dps", "gyro_z_dps",
+        "accel_x_mg", "accel_y_mg", "accel_z_mg",
+        "roll", "pitch", "yaw",
+    };
+
+    const char *path;
+    FILE *file{nullptr};
+
+    /// Те же фильтры, что в EasyImu (один отсчёт на запись, 1 кГц)
+    BiquadFilter<3> gyro_filter{};
+    PtFilter<2, 3> accel_filter{};
+
+    int indices[ColumnsTotal]{};
+    double last_time_us{-1};
+
+    explicit RecordedScenario(const char *path) :
+        path{path} {
+        name = "recorded";
+    }
+
+    ~RecordedScenario() {
+        if (file != nullptr) { fclose(file); }
+    }
+
+    void restart() override {
+        if (file != nullptr) { fclose(file); }
+        file = fopen(path, "r");
+        last_time_us = -1;
+        gyro_filter.configure(BiquadCoefficients<>::lowpass(EasyImu::gyro_cutoff_hz, 1000));
+        accel_filter.configure(EasyImu::accel_cutoff_hz, 1000);
+
+        char line[1024];
+        if (file == nullptr or fgets(line, sizeof(line), file) == nullptr) { return; }
+
+        int index = 0;
+        for (char *token = strtok(line, ",\r\n"); token != nullptr; token = strtok(nullptr, ",\r\n"), index++) {
+            for (int c = 0; c < ColumnsTotal; c++) {
+                if (strcmp(token, column_names[c]) == 0) { indices[c] = index; }
+            }
+        }
+    }
+
+    bool next(Sample &sample) override {
+        char line[1024];
+        double values[64]{};
+
+        if (file == nullptr or fgets(line, sizeof(line), file) == nullptr) { return false; }
+
+        int index = 0;
+        for (char *token = strtok(line, ",\r\n"); token != nullptr and index < 64; token = strtok(nullptr, ",\r\n")) {
+            values[index++] = atof(token);
+        }
+
+        const auto v = [&](Column c) { return static_cast<float>(values[indices[c]]); };
+
+        constexpr float deg_to_rad = M_PI / 180.0f;
+        const ela::vec3f gyro = EasyImu::transformToFLU(-v(GyroX), -v(GyroY), -v(GyroZ));
+        const ela::vec3f accel = EasyImu::transformToFLU(v(AccelX), v(AccelY), v(AccelZ));
+
+        sample.gyro = gyro_filter.calc(gyro * deg_to_rad);
+        sample.accel = accel_filter.calc(accel * 0.001f);
+        sample.truth = {v(Roll), v(Pitch), v(Yaw)};
+        sample.dt = last_time_us < 0 ? 0.001f : static_cast<float>((values[indices[TimeUs]] - last_time_us) * 1e-6);
+        last_time_us = values[indices[TimeUs]];
+        return true;
+    }
+};
+
+#endif
+
+static void run(Scenario &scenario, AttitudeEstimator::Kind kind) {
+    AttitudeEstimator estimator{};
+    estimator.setKind(kind);
+    scenario.restart();
+
+    ErrorStats roll{}, pitch{};
+    Sample sample{};
+    float t = 0;
+    uint64_t cycles = 0;
+    uint32_t updates = 0;
+
+    while (scenario.next(sample)) {
+        const uint32_t start = ESP.getCycleCount();
+        const ela::vec3f orientation = estimator.update(sample.gyro, sample.accel, sample.dt);
+        cycles += ESP.getCycleCount() - start;
+        updates += 1;
+
+        t += sample.dt;
+        if (t < settle_s) { continue; }
+
+        roll.add(orientation.x - sample.truth.x);
+        pitch.add(orientation.y - sample.truth.y);
+    }
+
+    Serial.printf(
+        "%-10s %-8s %7.0f cyc/upd  roll RMS %6.2f max %6.2f  pitch RMS %6.2f max %6.2f deg\n",
+        scenario.name, AttitudeEstimator::name(kind),
+        updates > 0 ? static_cast<double>(cycles) / updates : 0.0,
+        roll.rmsDeg(), roll.maxDeg(), pitch.rmsDeg(), pitch.maxDeg()
+    );
+}
+
+static void runAll(Scenario &scenario) {
+    for (uint8_t k = 0; k < AttitudeEstimator::kinds_total; k++) {
+        run(scenario, static_cast<AttitudeEstimator::Kind>(k));
+    }
+}
+
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    Serial.printf("CPU %u MHz, dt %.6f s\n", static_cast<unsigned>(ESP.getCpuFreqMHz()), sample_dt);
+
+    SyntheticScenario gentle{"gentle", 0.3f, 0.2f, 0.2f, 20.0f, 0.0f};
+    SyntheticScenario aggressive{"aggressive", 1.2f, 1.2f, 1.0f, 20.0f, 0.0f};
+    SyntheticScenario biased{"biased", 0.5f, 0.3f, 0.5f, 20.0f, 0.02f};
+
+    runAll(gentle);
+    runAll(aggressive);
+    runAll(biased);
+
+#if defined(KLYAX_NATIVE)
+    const char *path = getenv("KLYAX_BLACKBOX_CSV");
+    if (path != nullptr) {
+        RecordedScenario recorded{path};
+        runAll(recorded);
+    }
+#endif
+}
+
+void loop() {
+    delay(1000);
+}
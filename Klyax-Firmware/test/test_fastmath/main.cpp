@@ -0,0 +1,130 @@
+#include "Arduino.h"
+#include "tools/fastmath.hpp"
+
+#if defined(KLYAX_NATIVE)
+#include "hal/Native.hpp"
+#endif
+
+// Микро-бенчмарк tools/fastmath: такты на вызов против libm и проверка заявленной ошибки
+// Запуск на цели (pio test / прошивка скетча) и на хосте (native)
+// FAIL, если ошибка больше заявленной или ядро не быстрее libm (native: код выхода 1)
+
+
+static constexpr uint32_t samples = 20000;
+
+/// Не даёт компилятору выбросить вычисления
+static volatile float sink;
+
+static uint32_t failures = 0;
+
+/// Равномерный отсчёт из [from .. to]
+static float at(uint32_t i, float from, float to) {
+    return from + (to - from) * static_cast<float>(i) / static_cast<float>(samples - 1);
+}
+
+template<typename F> static float cyclesPerCall(F &&function) {
+    float accumulator = 0;
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < samples; i++) {
+        accumulator += function(i);
+    }
+
+    const uint32_t cycles = ESP.getCycleCount() - start;
+    sink = accumulator;
+    return static_cast<float>(cycles) / samples;
+}
+
+/// error(i): ошибка на отсчёте i
+template<typename E> static float maxError(E &&error) {
+    float result = 0;
+
+    for (uint32_t i = 0; i < samples; i++) {
+        result = std::max(result, error(i));
+    }
+
+    return result;
+}
+
+static void report(const char *name, float fast_cycles, float libm_cycles, float error, float bound) {
+    const bool accurate = error <= bound;
+    const bool faster = fast_cycles < libm_cycles;
+    if (not (accurate and faster)) { failures += 1; }
+
+    Serial.printf(
+        "%-8s fast %6.1f cyc  libm %6.1f cyc  x%4.1f  error %.2e <= %.0e %s%s\n",
+        name, fast_cycles, libm_cycles, libm_cycles / fast_cycles, error, bound,
+        accurate and faster ? "PASS" : "FAIL", faster ? "" : " (slower than libm)"
+    );
+}
+
+static void benchAtan2() {
+    // Точки на окружности и внутри: все октанты
+    const auto y = [](uint32_t i) { return at(i, 0, 1) * std::sin(at(i, -20, 20)); };
+    const auto x = [](uint32_t i) { return at(i, 0, 1) * std::cos(at(i, -20, 20)) + 1e-3f; };
+
+    report(
+        "atan2",
+        cyclesPerCall([&](uint32_t i) { return fastmath::atan2(y(i), x(i)); }),
+        cyclesPerCall([&](uint32_t i) { return std::atan2(y(i), x(i)); }),
+        maxError([&](uint32_t i) { return std::fabs(fastmath::atan2(y(i), x(i)) - std::atan2(y(i), x(i))); }),
+        fastmath::atan2_max_error
+    );
+}
+
+static void benchInvSqrt() {
+    const auto x = [](uint32_t i) { return at(i, 1e-3f, 1e3f); };
+
+    report(
+        "invSqrt",
+        cyclesPerCall([&](uint32_t i) { return fastmath::invSqrt(x(i)); }),
+        cyclesPerCall([&](uint32_t i) { return 1.0f / std::sqrt(x(i)); }),
+        maxError([&](uint32_t i) {
+            const float exact = 1.0f / std::sqrt(x(i));
+            return std::fabs(fastmath::invSqrt(x(i)) - exact) / exact;
+        }),
+        fastmath::inv_sqrt_max_relative_error
+    );
+}
+
+static void benchWrap() {
+    const auto x = [](uint32_t i) { return at(i, -999, 999); };
+    const auto reference = [](float angle) {
+        angle = static_cast<float>(std::fmod(angle + M_PI, M_TWOPI));
+        return static_cast<float>(angle >= 0 ? angle - M_PI : angle + M_PI);
+    };
+
+    report(
+        "wrapPi",
+        cyclesPerCall([&](uint32_t i) { return fastmath::wrapPi(x(i)); }),
+        cyclesPerCall([&](uint32_t i) { return reference(x(i)); }),
+        maxError([&](uint32_t i) {
+            // Pi и -Pi - один угол
+            const float e = std::fabs(fastmath::wrapPi(x(i)) - reference(x(i)));
+            return std::min(e, std::fabs(e - fastmath::two_pi));
+        }),
+        fastmath::wrap_max_error
+    );
+}
+
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    Serial.printf("CPU %u MHz, %u samples\n", static_cast<unsigned>(ESP.getCpuFreqMHz()), static_cast<unsigned>(samples));
+
+    benchAtan2();
+    benchInvSqrt();
+    benchWrap();
+
+    Serial.printf("%s: %u failures\n", failures == 0 ? "PASS" : "FAIL", static_cast<unsigned>(failures));
+
+#if defined(KLYAX_NATIVE)
+    if (failures != 0) { hal::Native::exit_status = EXIT_FAILURE; }
+#endif
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,264 @@
+#include "Arduino.h"
+#include "EasyImu.hpp"
+#include "tools/filters.hpp"
+#include "tools/fixed.hpp"
+#include "tools/PID.hpp"
+
+#if defined(KLYAX_NATIVE)
+#include "hal/Native.hpp"
+#endif
+
+// Фильтры и PID для float, double и фиксированной точки (Q16, Q20)
+// Такты на шаг, отклонение от эталона double и хэш выходов
+// Хэш Q-типов должен совпадать на хосте и на ESP32: целочисленная арифметика бит в бит
+// Фазовая задержка на частоте среза контура угловой скорости: прежние EMA против биквадов / PT2
+// Новый фильтр обязан выигрывать и по задержке, и по подавлению шума, иначе FAIL (native: код выхода 1)
+
+
+static constexpr uint32_t steps = 4000;
+
+/// Сек.
+static constexpr float step_dt = 0.001f;
+
+/// Входной сигнал и его производная: сумма гармоник и детерминированный шум
+struct Input {
+    float x[steps];
+    float dx[steps];
+
+    Input() {
+        constexpr auto w1 = static_cast<float>(M_TWOPI * 2.0);
+        constexpr auto w2 = static_cast<float>(M_TWOPI * 37.0);
+        uint32_t seed = 1;
+
+        for (uint32_t i = 0; i < steps; i++) {
+            const float t = static_cast<float>(i) * step_dt;
+            seed = seed * 1664525u + 1013904223u;
+            const float noise = 0.05f * (static_cast<float>(seed >> 8) * (2.0f / 16777216.0f) - 1.0f);
+
+            x[i] = 0.6f * std::sin(w1 * t) + 0.2f * std::sin(w2 * t) + noise;
+            dx[i] = 0.6f * w1 * std::cos(w1 * t) + 0.2f * w2 * std::cos(w2 * t);
+        }
+    }
+};
+
+static Input input{};
+
+/// Выходы одного типа
+struct Outputs {
+    double lpf[steps];
+    double complementary[steps];
+    double pid[steps];
+};
+
+struct Result {
+    float lpf_cycles, complementary_cycles, pid_cycles;
+    uint32_t hash;
+};
+
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+template<typename T> static Result run(Outputs &out) {
+    static T x[steps], dx[steps], y[steps];
+
+    for (uint32_t i = 0; i < steps; i++) {
+        x[i] = static_cast<T>(input.x[i]);
+        dx[i] = static_cast<T>(input.dx[i]);
+    }
+
+    const T dt = static_cast<T>(step_dt);
+    Result result{};
+    result.hash = 2166136261u;
+
+    const auto finish = [&](double *destination, uint32_t cycles) {
+        for (uint32_t i = 0; i < steps; i++) {
+            destination[i] = static_cast<double>(y[i]);
+            result.hash = fnv1a(result.hash, &y[i], sizeof(T));
+        }
+        return static_cast<float>(cycles) / steps;
+    };
+
+    {
+        LowFrequencyFilter<T, T> filter{static_cast<T>(0.2f)};
+        const uint32_t start = ESP.getCycleCount();
+        for (uint32_t i = 0; i < steps; i++) { y[i] = filter.calc(x[i]); }
+        result.lpf_cycles = finish(out.lpf, ESP.getCycleCount() - start);
+    }
+
+    {
+        ComplementaryFilter<T, T> filter{static_cast<T>(0.98f)};
+        const uint32_t start = ESP.getCycleCount();
+        for (uint32_t i = 0; i < steps; i++) { y[i] = filter.calc(x[i], dx[i], dt); }
+        result.complementary_cycles = finish(out.complementary, ESP.getCycleCount() - start);
+    }
+
+    {
+        const typename BasicPID<T>::Settings settings{
+            .p = static_cast<T>(1.2f),
+            .i = static_cast<T>(0.5f),
+            .d = static_cast<T>(0.01f),
+            .i_limit = static_cast<T>(0.5f),
+            .output_abs_max = static_cast<T>(1.0f),
+        };
+        BasicPID<T> pid{settings, 120.0f, 1.0f / step_dt};
+        const uint32_t start = ESP.getCycleCount();
+        for (uint32_t i = 0; i < steps; i++) { y[i] = pid.calc(x[i], dt); }
+        result.pid_cycles = finish(out.pid, ESP.getCycleCount() - start);
+    }
+
+    return result;
+}
+
+static double maxDeviation(const double *a, const double *b) {
+    double result = 0;
+
+    for (uint32_t i = 0; i < steps; i++) {
+        result = std::max(result, std::fabs(a[i] - b[i]));
+    }
+
+    return result;
+}
+
+static Outputs reference{}, outputs{};
+
+template<typename T> static void report(const char *name) {
+    const Result r = run<T>(outputs);
+
+    Serial.printf(
+        "%-6s LPF %5.1f cyc %.1e  Compl %5.1f cyc %.1e  PID %5.1f cyc %.1e  hash %08x\n",
+        name,
+        r.lpf_cycles, maxDeviation(outputs.lpf, reference.lpf),
+        r.complementary_cycles, maxDeviation(outputs.complementary, reference.complementary),
+        r.pid_cycles, maxDeviation(outputs.pid, reference.pid),
+        static_cast<unsigned>(r.hash)
+    );
+}
+
+
+/// Частота среза контура угловой скорости
+/// Гц
+static constexpr float crossover_hz = 30.0f;
+
+/// Частота шума (вибрации моторов) для оценки подавления
+/// Гц
+static constexpr float noise_hz = 400.0f;
+
+struct Response {
+    /// Мс
+    float delay_ms;
+
+    /// Дб
+    float gain_db;
+};
+
+/// Отклик на синус frequency_hz после установления
+template<typename F> static Response measure(F &&filter, float frequency_hz, float sample_rate_hz) {
+    const auto settle = static_cast<uint32_t>(sample_rate_hz);
+    const auto window = static_cast<uint32_t>(sample_rate_hz);
+    const double w = M_TWOPI * frequency_hz / sample_rate_hz;
+    double in_phase = 0, quadrature = 0;
+
+    for (uint32_t n = 0; n < settle + window; n++) {
+        const float y = filter(static_cast<float>(std::sin(w * n)));
+        if (n < settle) { continue; }
+
+        in_phase += y * std::sin(w * n);
+        quadrature += y * std::cos(w * n);
+    }
+
+    const double phase = std::atan2(-quadrature, in_phase);
+    const double gain = 2.0 * std::sqrt(in_phase * in_phase + quadrature * quadrature) / window;
+
+    return {
+        static_cast<float>(phase / (M_TWOPI * frequency_hz) * 1000.0),
+        static_cast<float>(20.0 * std::log10(gain)),
+    };
+}
+
+static uint32_t failures = 0;
+
+/// Сравнение прежнего EMA (alpha) с новым фильтром
+template<typename F> static void comparePhase(const char *name, float sample_rate_hz, float alpha, F &&make_filter) {
+    const auto ema = [&]() {
+        return [filter = LowFrequencyFilter<float>{alpha}](float x) mutable { return filter.calc(x); };
+    };
+
+    const Response old_crossover = measure(ema(), crossover_hz, sample_rate_hz);
+    const Response old_noise = measure(ema(), noise_hz, sample_rate_hz);
+    const Response new_crossover = measure(make_filter(), crossover_hz, sample_rate_hz);
+    const Response new_noise = measure(make_filter(), noise_hz, sample_rate_hz);
+
+    const bool pass = new_crossover.delay_ms < old_crossover.delay_ms and new_noise.gain_db < old_noise.gain_db;
+    if (not pass) { failures += 1; }
+
+    Serial.printf(
+        "%-8s %4.0f Hz  delay @%.0f Hz: EMA %.2f ms -> %.2f ms  gain @%.0f Hz: EMA %5.1f dB -> %5.1f dB  %s\n",
+        name, sample_rate_hz,
+        crossover_hz, old_crossover.delay_ms, new_crossover.delay_ms,
+        noise_hz, old_noise.gain_db, new_noise.gain_db,
+        pass ? "PASS" : "FAIL"
+    );
+}
+
+static void benchPhase() {
+    const auto biquad = [](float cutoff_hz, float sample_rate_hz, float q = BiquadCoefficients<>::butterworth_q) {
+        return [cutoff_hz, sample_rate_hz, q]() {
+            BiquadFilter<1> filter{};
+            filter.configure(BiquadCoefficients<>::lowpass(cutoff_hz, sample_rate_hz, q));
+            return [filter](float x) mutable { return filter.calc(x); };
+        };
+    };
+
+    const auto pt2 = [](float cutoff_hz, float sample_rate_hz) {
+        return [cutoff_hz, sample_rate_hz]() {
+            PtFilter<2, 1> filter{};
+            filter.configure(cutoff_hz, sample_rate_hz);
+            return [filter](float x) mutable { return filter.calc(x); };
+        };
+    };
+
+    // Срезы производной: AcrobaticModeBehavior::roll_pitch_dx_cutoff_hz, yaw_dx_cutoff_hz
+    constexpr float dx_q = PidBank<1>::dx_q;
+
+    comparePhase("gyro", 1125, 0.35f, biquad(EasyImu::gyro_cutoff_hz, 1125));
+    comparePhase("accel", 1125, 0.2f, pt2(EasyImu::accel_cutoff_hz, 1125));
+    comparePhase("D yaw", 1000, 0.8f, biquad(370, 1000, dx_q));
+
+    // Прежний EMA менял срез вместе с частотой цикла
+    comparePhase("D r/p", 1000, 0.2f, biquad(170, 1000, dx_q));
+    comparePhase("D r/p", 2000, 0.2f, biquad(170, 2000, dx_q));
+    comparePhase("D r/p", 4000, 0.2f, biquad(170, 4000, dx_q));
+
+    Serial.printf("%s: %u failures\n", failures == 0 ? "PASS" : "FAIL", static_cast<unsigned>(failures));
+
+#if defined(KLYAX_NATIVE)
+    if (failures != 0) { hal::Native::exit_status = EXIT_FAILURE; }
+#endif
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    Serial.printf("CPU %u MHz, %u steps, deviation from double\n", static_cast<unsigned>(ESP.getCpuFreqMHz()), static_cast<unsigned>(steps));
+
+    run<double>(reference);
+
+    report<double>("double");
+    report<float>("float");
+    report<Q16>("Q16");
+    report<Q20>("Q20");
+
+    benchPhase();
+}
+
+void loop() {
+    delay(1000);
+}
@@ -21,7 +21,7 @@ void setup() {
 
     delay(1000);
 
-    while (not imu.init(GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_23, GPIO_NUM_5)) {
+    while (not imu.init(GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_23, GPIO_NUM_5, GPIO_NUM_4)) {
         delay(1000);
     }
 
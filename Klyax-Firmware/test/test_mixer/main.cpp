@@ -0,0 +1,206 @@
+#include "Arduino.h"
+#include "tools/mixer.hpp"
+#include "tools/thrust.hpp"
+
+// Перевод тяги в такты ШИМ: линейное умножение на период против ThrustLinearizer
+// Такты на мотор и отклонение таблицы от точного обращения модели
+// Смеситель: четыре строки X с ограничением каждого мотора против MatrixMixer, такты на вызов
+// Доля команд ориентации, дошедшая до моторов на краях диапазона газа
+
+
+static constexpr uint32_t samples_total = 4096;
+
+/// Такты ШИМ (LEDC, 10 бит)
+static constexpr uint32_t duty_max = 1023;
+
+static constexpr float expo = 0.8f;
+
+static constexpr ThrustLut lut = ThrustLut::fromExpo(expo, 3.8f);
+
+static float thrust[samples_total];
+static uint32_t duty[samples_total];
+
+/// Прежний перевод: MotorPwm::toDuty
+static uint32_t linearDuty(float value) {
+    value = constrain(value, 0.0f, 1.0f);
+    return static_cast<uint32_t>(value * static_cast<float>(duty_max));
+}
+
+static float benchLinear() {
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < samples_total; i++) {
+        duty[i] = linearDuty(thrust[i]);
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / samples_total;
+}
+
+static float benchLut(const ThrustLinearizer &linearizer) {
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < samples_total; i++) {
+        duty[i] = linearizer.toDuty(thrust[i]);
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / samples_total;
+}
+
+/// Точное обращение модели: (1 - expo) * d + expo * d^2 = t
+static float exactDuty(float t) {
+    const float b = 1.0f - expo;
+    return (-b + std::sqrt(b * b + 4.0f * expo * t)) / (2.0f * expo);
+}
+
+/// Наибольшее отклонение от точного обращения
+/// Такты ШИМ
+static float maxError() {
+    float result = 0;
+
+    for (uint32_t i = 0; i < samples_total; i++) {
+        const float expected = exactDuty(constrain(thrust[i], 0.0f, 1.0f)) * static_cast<float>(duty_max);
+        result = std::max(result, std::fabs(static_cast<float>(duty[i]) - expected));
+    }
+
+    return result;
+}
+
+static constexpr uint32_t mixes_total = 4096;
+
+static constexpr uint8_t motors = 4;
+
+struct MixInput {
+    float thrust, roll, pitch, yaw;
+};
+
+static MixInput mix_input[mixes_total];
+static float mix_output[mixes_total][motors];
+
+/// Прежний смеситель: знаки X в коде, каждый мотор ограничивается отдельно
+static void fourLineMix(const MixInput &c, float (&out)[motors]) {
+    out[3] = c.thrust + c.roll - c.pitch - c.yaw;
+    out[2] = c.thrust - c.roll - c.pitch + c.yaw;
+    out[0] = c.thrust + c.roll + c.pitch + c.yaw;
+    out[1] = c.thrust - c.roll + c.pitch - c.yaw;
+
+    for (auto &o : out) { o = constrain(o, 0.0f, 1.0f); }
+}
+
+static float benchFourLine() {
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < mixes_total; i++) {
+        fourLineMix(mix_input[i], mix_output[i]);
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / mixes_total;
+}
+
+static float benchMatrix() {
+    MatrixMixer<frame::QuadX> mixer{};
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < mixes_total; i++) {
+        const MixInput &c = mix_input[i];
+        mixer.mix(c.thrust, c.roll, c.pitch, c.yaw, mix_output[i]);
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / mixes_total;
+}
+
+/// Дошедшие до моторов крен и рыскание в долях запрошенных
+/// Проекция выходов на столбцы матрицы QuadX
+static void delivered(const float (&out)[motors], const MixInput &c, float &roll, float &yaw) {
+    constexpr auto &rows = frame::QuadX::geometry.rows;
+    roll = 0;
+    yaw = 0;
+
+    for (uint8_t i = 0; i < motors; i++) {
+        roll += out[i] * rows[i].roll;
+        yaw += out[i] * rows[i].yaw;
+    }
+
+    roll /= motors * c.roll;
+    yaw /= motors * c.yaw;
+}
+
+static void authority(const char *name, const MixInput &c, float ceiling = 1.0f) {
+    float old_out[motors];
+    fourLineMix(c, old_out);
+
+    // Газ уже поднимался: airmode включён
+    MatrixMixer<frame::QuadX> mixer{};
+    float new_out[motors];
+    mixer.mix(MatrixMixer<frame::QuadX>::airmode_activate_thrust, 0, 0, 0, new_out);
+
+    mixer.mix(c.thrust, c.roll, c.pitch, c.yaw, new_out, ceiling);
+
+    float old_roll, old_yaw, new_roll, new_yaw;
+    delivered(old_out, c, old_roll, old_yaw);
+    delivered(new_out, c, new_roll, new_yaw);
+
+    Serial.printf(
+        "%-5s thrust %.2f: four-line roll %4.2f yaw %4.2f  matrix roll %4.2f yaw %4.2f\n",
+        name, c.thrust, old_roll, old_yaw, new_roll, new_yaw
+    );
+}
+
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    // Немного за пределами [0 .. 1]: ограничение входит в замер
+    for (uint32_t i = 0; i < samples_total; i++) {
+        thrust[i] = -0.02f + 1.04f * static_cast<float>(i) / static_cast<float>(samples_total - 1);
+    }
+
+    ThrustLinearizer linearizer{};
+    linearizer.configure(lut, duty_max, 1.0f);
+
+    const float linear_cycles = benchLinear();
+    const float lut_cycles = benchLut(linearizer);
+    const float error = maxError();
+
+    // Разряженная батарея: скважность выше, не выходит за период
+    linearizer.configure(lut, duty_max, 3.8f / 3.3f);
+    const uint32_t half = linearizer.toDuty(0.5f);
+    const uint32_t full = linearizer.toDuty(1.0f);
+    const float ceiling = linearizer.getThrustMax();
+    const uint32_t at_ceiling = linearizer.toDuty(ceiling);
+
+    Serial.printf(
+        "CPU %u MHz, %u samples, %u segments\n"
+        "linear %5.1f cyc/motor  LUT %5.1f cyc/motor  max error %.2f ticks\n"
+        "3.3 V: thrust 0.5 -> %u, 1.0 -> %u of %u, mixer ceiling %.3f -> %u\n",
+        static_cast<unsigned>(ESP.getCpuFreqMHz()), static_cast<unsigned>(samples_total), static_cast<unsigned>(ThrustLut::segments),
+        linear_cycles, lut_cycles, error,
+        static_cast<unsigned>(half), static_cast<unsigned>(full), static_cast<unsigned>(duty_max),
+        ceiling, static_cast<unsigned>(at_ceiling)
+    );
+
+    uint32_t seed = 1;
+    const auto random = [&seed](float amplitude) {
+        seed = seed * 1664525u + 1013904223u;
+        return amplitude * (static_cast<float>(seed >> 8) * (2.0f / 16777216.0f) - 1.0f);
+    };
+
+    for (auto &c : mix_input) {
+        c = {0.5f + random(0.5f), random(0.3f), random(0.3f), random(0.1f)};
+    }
+
+    const float four_line_cycles = benchFourLine();
+    const float matrix_cycles = benchMatrix();
+
+    Serial.printf("four-line %5.1f cyc/mix  MatrixMixer<QuadX> %5.1f cyc/mix\n", four_line_cycles, matrix_cycles);
+
+    authority("high", {0.95f, 0.3f, 0.0f, 0.1f});
+    authority("low", {0.05f, 0.3f, 0.0f, 0.1f});
+
+    // Просадка: смеситель сжимает команды до потолка выхода, моторы не упираются в период после него
+    authority("3.3V", {0.95f, 0.3f, 0.0f, 0.1f}, ceiling);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,175 @@
+#include "Arduino.h"
+#include "tools/PID.hpp"
+
+// PidBank<3> против трёх скалярных PID::calc: такты на шаг по трём осям
+// Совпадение выходов на удержании (уставка постоянна, упреждения нет - D по измерению равен D по ошибке)
+// Выход из насыщения: ограничение интеграла против обратного пересчёта на модели оси
+
+
+static constexpr uint32_t steps = 4000;
+static constexpr uint8_t axes = 3;
+
+/// Сек.
+static constexpr float step_dt = 0.001f;
+
+/// Гц
+static constexpr float dx_cutoff_hz[axes]{120.0f, 120.0f, 400.0f};
+
+static const PID::Settings settings[axes]{
+    {.p = 0.05f, .i = 0.01f, .d = 0.0002f, .i_limit = 0.1f, .output_abs_max = 1.0f},
+    {.p = 0.05f, .i = 0.01f, .d = 0.0002f, .i_limit = 0.1f, .output_abs_max = 1.0f},
+    {.p = 0.03f, .i = 0.005f, .d = 0.0002f, .i_limit = 0.1f, .output_abs_max = 1.0f},
+};
+
+/// Измерения по осям: гармоники и детерминированный шум
+/// Рад / с
+struct Input {
+    float measurement[steps][axes];
+
+    Input() {
+        uint32_t seed = 1;
+
+        for (uint32_t i = 0; i < steps; i++) {
+            const float t = static_cast<float>(i) * step_dt;
+
+            for (uint8_t a = 0; a < axes; a++) {
+                seed = seed * 1664525u + 1013904223u;
+                const float noise = 0.05f * (static_cast<float>(seed >> 8) * (2.0f / 16777216.0f) - 1.0f);
+                measurement[i][a] = 0.5f * std::sin(static_cast<float>(M_TWOPI) * (2.0f + a) * t) + noise;
+            }
+        }
+    }
+};
+
+static Input input{};
+
+static float scalar_output[steps][axes];
+static float bank_output[steps][axes];
+
+static float benchScalar() {
+    PID pids[axes]{
+        PID{settings[0], dx_cutoff_hz[0], 1.0f / step_dt},
+        PID{settings[1], dx_cutoff_hz[1], 1.0f / step_dt},
+        PID{settings[2], dx_cutoff_hz[2], 1.0f / step_dt},
+    };
+
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < steps; i++) {
+        for (uint8_t a = 0; a < axes; a++) {
+            scalar_output[i][a] = pids[a].calc(-input.measurement[i][a], step_dt);
+        }
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / steps;
+}
+
+static float benchBank() {
+    PidBank<axes> bank{dx_cutoff_hz, 1.0f / step_dt};
+    for (uint8_t a = 0; a < axes; a++) { bank.setGains(a, settings[a], 0.0f); }
+
+    const float setpoint[axes]{};
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < steps; i++) {
+        bank.calc(setpoint, input.measurement[i], step_dt, bank_output[i]);
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / steps;
+}
+
+/// Наибольшее расхождение после установления фильтров производной
+/// Скалярный PID выставляет фильтр по первой производной, банк начинает с нуля
+/// Интеграл банка обновляется после выхода: расхождение порядка i * ошибка * dt
+static float maxDeviation() {
+    static constexpr uint32_t settle_steps = 50;
+    float result = 0;
+
+    for (uint32_t i = settle_steps; i < steps; i++) {
+        for (uint8_t a = 0; a < axes; a++) {
+            result = std::max(result, std::fabs(scalar_output[i][a] - bank_output[i][a]));
+        }
+    }
+
+    return result;
+}
+
+
+/// Ось: угловая скорость первого порядка от выхода регулятора
+struct Plant {
+    /// Рад / с на единицу выхода
+    static constexpr float gain = 20.0f;
+
+    /// Сек.
+    static constexpr float tau = 0.05f;
+
+    float rate{0};
+
+    float step(float output) {
+        rate += (gain * output - rate) * (step_dt / tau);
+        return rate;
+    }
+};
+
+/// Уставка выше достижимой 1 с, затем 0
+/// Мс после снятия уставки до |скорость| < 0.1 Рад / с
+template<typename C> static float windup(C &&controller) {
+    static constexpr uint32_t saturated_steps = 1000;
+    static constexpr float unreachable = 40.0f;
+
+    Plant plant{};
+    uint32_t last_outside = saturated_steps;
+
+    for (uint32_t i = 0; i < 2 * saturated_steps; i++) {
+        const float setpoint = i < saturated_steps ? unreachable : 0.0f;
+        plant.step(controller(setpoint, plant.rate));
+
+        if (i >= saturated_steps and std::fabs(plant.rate) >= 0.1f) { last_outside = i; }
+    }
+
+    return static_cast<float>(last_outside - saturated_steps) * step_dt * 1000.0f;
+}
+
+static void benchWindup() {
+    static constexpr PID::Settings integral_heavy{.p = 0.05f, .i = 0.5f, .d = 0.0f, .i_limit = 2.0f, .output_abs_max = 1.0f};
+
+    PID scalar{integral_heavy};
+    const float clamp_ms = windup([&](float setpoint, float rate) {
+        return scalar.calc(setpoint - rate, step_dt);
+    });
+
+    PidBank<1> bank{{0.0f}, 1.0f / step_dt};
+    bank.setGains(0, integral_heavy, 0.0f);
+    const float back_calculation_ms = windup([&](float setpoint, float rate) {
+        float output;
+        bank.calc(&setpoint, &rate, step_dt, &output);
+        return output;
+    });
+
+    Serial.printf(
+        "windup recovery: I clamp %4.0f ms  back-calculation %4.0f ms\n",
+        clamp_ms, back_calculation_ms
+    );
+}
+
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    Serial.printf("CPU %u MHz, %u steps x %u axes\n", static_cast<unsigned>(ESP.getCpuFreqMHz()), static_cast<unsigned>(steps), static_cast<unsigned>(axes));
+
+    const float scalar_cycles = benchScalar();
+    const float bank_cycles = benchBank();
+
+    Serial.printf(
+        "3x PID  %6.1f cyc/step  PidBank<3> %6.1f cyc/step  x%4.2f  max deviation %.1e\n",
+        scalar_cycles, bank_cycles, scalar_cycles / bank_cycles, maxDeviation()
+    );
+
+    benchWindup();
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,298 @@
+#include "Arduino.h"
+#include "tools/PID.hpp"
+#include "tools/Pipeline.hpp"
+
+// FlightPipeline с моделями вместо датчика и моторов: тот же путь отсчёта собирается на хосте
+// Такты на шаг: ModeSwitch (прямые вызовы) против виртуальных режимов через указатель
+// Выходы обоих путей должны совпасть бит в бит
+// Режимы переключаются в полёте: пересчёт фильтров (сброс их состояния) допустим только до первого шага
+
+
+static constexpr uint32_t steps = 20000;
+
+/// Смена режима каждые
+static constexpr uint32_t switch_period = 1000;
+
+/// Сек.
+static constexpr float step_dt = 0.001f;
+
+/// Отсчёт модели датчика
+struct Sample {
+    /// Рад / с
+    float rate[3];
+
+    /// Рад
+    float angle[2];
+};
+
+/// Стики
+struct Control {
+    float thrust;
+    float stick[3];
+};
+
+struct Command {
+    float thrust, roll, pitch, yaw;
+};
+
+/// Модель датчика: детерминированные колебания
+struct ScriptedSource {
+    uint32_t step{0};
+
+    Sample update(float dt) {
+        const float t = static_cast<float>(step++) * dt;
+        return {
+            {0.4f * std::sin(7.0f * t), 0.3f * std::cos(5.0f * t), 0.1f * std::sin(3.0f * t)},
+            {0.2f * std::sin(1.3f * t), 0.1f * std::cos(0.7f * t)},
+        };
+    }
+
+    void setLoopRate(float hz) {}
+};
+
+/// Смеситель: накапливает команды вместо моторов
+struct RecordingMixer {
+    double sum{0};
+    uint32_t commands{0};
+
+    void mixin(const Command &c) {
+        sum += c.thrust + 3.0 * c.roll + 5.0 * c.pitch + 7.0 * c.yaw;
+        commands += 1;
+    }
+
+    void disable() {}
+};
+
+/// Пересчёты фильтров режимами после начала полёта
+static uint32_t rate_changes_in_flight = 0;
+
+static bool flying = false;
+
+static void countLoopRate() {
+    if (flying) { rate_changes_in_flight += 1; }
+}
+
+/// Режимы как в прошивке: прямой, контур угловой скорости, контур угла поверх него
+
+struct DirectMode {
+    Command interpret(const Control &c, float dt, const Sample &s) {
+        return {c.thrust, c.stick[0], c.stick[1], c.stick[2]};
+    }
+
+    void afterMix(const Control &c, float dt, const Sample &s) {}
+
+    void onDisarm() {}
+
+    void onLoopRate(float hz) { countLoopRate(); }
+
+    void onEnter() {}
+};
+
+static constexpr PID::Settings rate_settings{.p = 0.05f, .i = 0.01f, .d = 0.0002f, .i_limit = 0.1f, .output_abs_max = 1.0f};
+
+struct RateMode {
+    PidBank<3> pid{{120.0f, 120.0f, 400.0f}};
+
+    RateMode() {
+        for (uint8_t a = 0; a < 3; a++) { pid.setGains(a, rate_settings, 0.0005f); }
+    }
+
+    Command drive(float thrust, const float (&setpoint)[3], float dt, const Sample &s) {
+        float output[3];
+        pid.calc(setpoint, s.rate, dt, output);
+        return {thrust, output[0], output[1], -output[2]};
+    }
+
+    Command interpret(const Control &c, float dt, const Sample &s) {
+        const float setpoint[3]{3.0f * c.stick[0], 3.0f * c.stick[1], 3.0f * c.stick[2]};
+        return drive(c.thrust, setpoint, dt, s);
+    }
+
+    void afterMix(const Control &c, float dt, const Sample &s) {}
+
+    void onDisarm() { pid.reset(); }
+
+    void onLoopRate(float hz) {
+        countLoopRate();
+        pid.setSampleRate(hz);
+    }
+
+    void onEnter() {}
+};
+
+struct LevelMode {
+    static constexpr uint8_t divisor = 4;
+
+    RateMode &rates;
+    PidBank<2> angle_pid{{0.0f, 0.0f}};
+    float rate_setpoint[2]{};
+    uint8_t ticks{0};
+
+    explicit LevelMode(RateMode &rates) :
+        rates{rates} {
+        static constexpr PID::Settings angle_settings{.p = 6.0f, .i = 0.0f, .d = 0.0f, .i_limit = 0.0f, .output_abs_max = 3.0f};
+        for (uint8_t a = 0; a < 2; a++) { angle_pid.setGains(a, angle_settings, 0.0f); }
+    }
+
+    Command interpret(const Control &c, float dt, const Sample &s) {
+        const float setpoint[3]{rate_setpoint[0], rate_setpoint[1], 3.0f * c.stick[2]};
+        return rates.drive(c.thrust, setpoint, dt, s);
+    }
+
+    void afterMix(const Control &c, float dt, const Sample &s) {
+        if (++ticks < divisor) { return; }
+        ticks = 0;
+
+        const float target[2]{0.5f * c.stick[0], 0.5f * c.stick[1]};
+        angle_pid.calc(target, s.angle, dt * divisor, rate_setpoint);
+    }
+
+    void onDisarm() {
+        angle_pid.reset();
+        rate_setpoint[0] = rate_setpoint[1] = 0;
+        ticks = 0;
+    }
+
+    void onLoopRate(float hz) { countLoopRate(); }
+
+    void onEnter() { onDisarm(); }
+};
+
+/// Все режимы и их состояние: у каждого пути свой набор
+struct Modes {
+    DirectMode direct{};
+    RateMode rate{};
+    LevelMode level{rate};
+};
+
+static Control controlAt(uint32_t i) {
+    const float t = static_cast<float>(i) * step_dt;
+    return {0.6f, {0.3f * std::sin(2.0f * t), 0.2f * std::cos(3.0f * t), 0.1f}};
+}
+
+struct Result {
+    float cycles;
+    double sum;
+};
+
+/// Номер режима на шаге i: меняется во время работы
+static volatile uint8_t schedule_offset = 0;
+
+static uint8_t modeAt(uint32_t i) { return static_cast<uint8_t>((i / switch_period + schedule_offset) % 3); }
+
+static Result runStatic() {
+    Modes m{};
+    ScriptedSource source{};
+    RecordingMixer mixer{};
+
+    using Switch = ModeSwitch<DirectMode, RateMode, LevelMode>;
+    Switch modes{m.direct, m.rate, m.level};
+    FlightPipeline<ScriptedSource, Switch, RecordingMixer> pipeline{source, modes, mixer};
+    pipeline.setLoopRate(1.0f / step_dt);
+
+    flying = true;
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < steps; i++) {
+        switch (modeAt(i)) {
+            case 0:
+                modes.select<DirectMode>();
+                break;
+            case 1:
+                modes.select<RateMode>();
+                break;
+            default:
+                modes.select<LevelMode>();
+                break;
+        }
+
+        const Sample sample = pipeline.sense(step_dt);
+        pipeline.fly(controlAt(i), step_dt, sample);
+    }
+
+    flying = false;
+    return {static_cast<float>(ESP.getCycleCount() - start) / steps, mixer.sum};
+}
+
+/// Прежняя схема: базовый класс с виртуальными функциями и указатель на активный режим
+struct VirtualMode {
+    virtual Command interpret(const Control &c, float dt, const Sample &s) = 0;
+
+    virtual void afterMix(const Control &c, float dt, const Sample &s) {}
+
+    virtual void onLoopRate(float hz) {}
+
+    virtual void onEnter() {}
+
+    virtual ~VirtualMode() = default;
+};
+
+template<typename M> struct VirtualAdapter final : VirtualMode {
+    M &mode;
+
+    explicit VirtualAdapter(M &mode) :
+        mode{mode} {}
+
+    Command interpret(const Control &c, float dt, const Sample &s) override { return mode.interpret(c, dt, s); }
+
+    void afterMix(const Control &c, float dt, const Sample &s) override { mode.afterMix(c, dt, s); }
+
+    void onLoopRate(float hz) override { mode.onLoopRate(hz); }
+
+    void onEnter() override { mode.onEnter(); }
+};
+
+static Result runVirtual() {
+    Modes m{};
+    ScriptedSource source{};
+    RecordingMixer mixer{};
+
+    VirtualAdapter<DirectMode> direct{m.direct};
+    VirtualAdapter<RateMode> rate{m.rate};
+    VirtualAdapter<LevelMode> level{m.level};
+    VirtualMode *const modes[]{&direct, &rate, &level};
+
+    // Частота задаётся без полёта сразу всем режимам
+    for (VirtualMode *mode: modes) { mode->onLoopRate(1.0f / step_dt); }
+    VirtualMode *active = modes[0];
+
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < steps; i++) {
+        VirtualMode *next = modes[modeAt(i)];
+        if (next != active) {
+            active = next;
+            active->onEnter();
+        }
+
+        const Sample sample = source.update(step_dt);
+        const Control control = controlAt(i);
+        mixer.mixin(active->interpret(control, step_dt, sample));
+        active->afterMix(control, step_dt, sample);
+    }
+
+    return {static_cast<float>(ESP.getCycleCount() - start) / steps, mixer.sum};
+}
+
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    const Result direct = runStatic();
+    const Result dispatched = runVirtual();
+
+    Serial.printf(
+        "%u steps, mode switch every %u\n"
+        "ModeSwitch %6.1f cyc/step  virtual %6.1f cyc/step  x%4.2f  outputs %s\n"
+        "filter reconfigurations in flight: %u (expected 0)\n",
+        static_cast<unsigned>(steps), static_cast<unsigned>(switch_period),
+        direct.cycles, dispatched.cycles, dispatched.cycles / direct.cycles,
+        direct.sum == dispatched.sum ? "MATCH" : "DIFFER",
+        static_cast<unsigned>(rate_changes_in_flight)
+    );
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,167 @@
+#include "Arduino.h"
+#include <Radio.hpp>
+
+// Посылки ESP-NOW: такты на CRC, проверку и разбор посылки с четырьмя сообщениями
+// Посылки в замерах разные (номер, время): CRC постоянной посылки компилятор может вынести из цикла
+// Нативная сборка: такты - время хоста, пересчитанное на частоту ESP32, не такты ESP32
+// Порча каждого бита посылки должна отбрасываться проверкой
+// Номера посылок: потери, повтор, переупорядочивание и перезапуск отправителя
+
+
+static constexpr uint32_t frames_total = 1024;
+
+/// Разных посылок в замере, степень двойки
+static constexpr uint32_t variants_total = 16;
+
+struct Counters {
+    uint32_t control;
+    uint32_t menu;
+    uint32_t bytes;
+};
+
+static void onControl(Counters &counters, const uint8_t *, uint8_t size) {
+    counters.control += 1;
+    counters.bytes += size;
+}
+
+static void onMenu(Counters &counters, const uint8_t *, uint8_t size) {
+    counters.menu += 1;
+    counters.bytes += size;
+}
+
+static constexpr auto dispatcher = radio::Dispatcher<Counters>{}
+    .on(radio::Type::Control, onControl)
+    .on(radio::Type::Menu, onMenu);
+
+static radio::Frame makeFrame(uint16_t sequence) {
+    radio::FrameWriter writer{};
+
+    const radio::ControlMessage control{0.1f, -0.2f, 0.3f, -0.4f, 1};
+    writer.add(radio::Type::Control, control);
+    writer.add(radio::Type::Menu, radio::MenuMessage{2});
+    writer.add(radio::Type::Control, control);
+    writer.add(radio::Type::Menu, radio::MenuMessage{3});
+
+    return writer.seal(sequence, micros() + sequence * 997u);
+}
+
+static float benchCrc(const radio::Frame (&frames)[variants_total]) {
+    volatile radio::Crc sink = 0;
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < frames_total; i++) {
+        const radio::Frame &frame = frames[i & (variants_total - 1)];
+        sink = sink + radio::crc16(frame.data, frame.size);
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / frames_total;
+}
+
+static float benchReceive(const radio::Frame (&frames)[variants_total], Counters &counters) {
+    const uint32_t start = ESP.getCycleCount();
+
+    for (uint32_t i = 0; i < frames_total; i++) {
+        const radio::Frame &frame = frames[i & (variants_total - 1)];
+        radio::Header header;
+        if (radio::check(frame.data, frame.size, header) != radio::Status::Ok) { continue; }
+
+        radio::forEach(frame.data, header, [&counters](uint8_t type, const uint8_t *payload, uint8_t size) {
+            dispatcher.dispatch(counters, type, payload, size);
+        });
+    }
+
+    return static_cast<float>(ESP.getCycleCount() - start) / frames_total;
+}
+
+/// Посылки с одним испорченным битом, прошедшие проверку
+static uint32_t undetectedBitFlips(const radio::Frame &frame) {
+    uint32_t result = 0;
+
+    for (uint32_t bit = 0; bit < frame.size * 8u; bit++) {
+        radio::Frame corrupted = frame;
+        corrupted.data[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+
+        radio::Header header;
+        if (radio::check(corrupted.data, corrupted.size, header) == radio::Status::Ok) { result += 1; }
+    }
+
+    return result;
+}
+
+static void sequence() {
+    radio::SequenceTracker tracker{};
+    uint32_t stale = 0;
+
+    // 0 1 2 [3 4 потеряны] 5 [4 опоздал] 6 [6 повтор]
+    for (uint16_t s : {0, 1, 2, 5, 4, 6, 6}) {
+        if (tracker.accept(s) == radio::SequenceTracker::Order::Stale) { stale += 1; }
+    }
+
+    Serial.printf(
+        "sequence: lost %u stale %u (expected 2, 2)\n",
+        static_cast<unsigned>(tracker.getLost()), static_cast<unsigned>(stale)
+    );
+
+    // Отправитель перезапущен после посылки 99: номера снова с нуля
+    radio::SequenceTracker restart{};
+    for (uint16_t s = 0; s < 100; s++) { restart.accept(s); }
+
+    uint32_t accepted = 0;
+    for (uint16_t s = 0; s < 16; s++) {
+        if (restart.accept(s) == radio::SequenceTracker::Order::Newer) { accepted += 1; }
+    }
+
+    Serial.printf(
+        "sequence: after restart accepted %u of 16 (expected %u)\n",
+        static_cast<unsigned>(accepted), static_cast<unsigned>(16 - radio::SequenceTracker::restart_after + 1)
+    );
+
+    // Переход через ноль
+    radio::SequenceTracker wrap{};
+    wrap.accept(65534);
+    wrap.accept(65535);
+    const bool wrapped = wrap.accept(0) == radio::SequenceTracker::Order::Newer;
+
+    Serial.printf("sequence: wrap 65535 -> 0 %s, lost %u\n", wrapped ? "ok" : "FAIL", static_cast<unsigned>(wrap.getLost()));
+}
+
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    radio::Frame frames[variants_total];
+    for (uint32_t v = 0; v < variants_total; v++) { frames[v] = makeFrame(static_cast<uint16_t>(v + 1)); }
+
+    const radio::Frame &frame = frames[0];
+    Counters counters{};
+
+    const float crc_cycles = benchCrc(frames);
+    const float receive_cycles = benchReceive(frames, counters);
+
+#if defined(KLYAX_NATIVE)
+    static constexpr const char *clock_note = " (host time)";
+#else
+    static constexpr const char *clock_note = "";
+#endif
+
+    Serial.printf(
+        "CPU %u MHz, frame %u bytes, 4 messages, %u different frames\n"
+        "crc16 %6.1f cyc/frame  check + dispatch %6.1f cyc/frame%s\n"
+        "dispatched: control %u menu %u (expected %u each)\n",
+        static_cast<unsigned>(ESP.getCpuFreqMHz()), static_cast<unsigned>(frame.size), static_cast<unsigned>(variants_total),
+        crc_cycles, receive_cycles, clock_note,
+        static_cast<unsigned>(counters.control), static_cast<unsigned>(counters.menu), static_cast<unsigned>(2 * frames_total)
+    );
+
+    Serial.printf(
+        "bit flips: %u of %u undetected\n",
+        static_cast<unsigned>(undetectedBitFlips(frame)), static_cast<unsigned>(frame.size * 8u)
+    );
+
+    sequence();
+}
+
+void loop() {
+    delay(1000);
+}
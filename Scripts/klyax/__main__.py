@@ -2,9 +2,13 @@
 
 import sys
 
+from klyax.cli import BlackboxCommandRunner
 from klyax.cli import CleanupCommandRunner
 from klyax.cli import CommandLineInterface
 from klyax.cli import DisplayModelCommandRunner
+from klyax.cli import LogCommandRunner
+from klyax.cli import TelemetryCommandRunner
+from klyax.cli import ThrustCommandRunner
 from klyax.cli import UpdateReadmeCommandRunner
 
 
@@ -13,6 +17,10 @@ def _start():
         CleanupCommandRunner,
         UpdateReadmeCommandRunner,
         DisplayModelCommandRunner,
+        TelemetryCommandRunner,
+        BlackboxCommandRunner,
+        LogCommandRunner,
+        ThrustCommandRunner,
     ))
 
     args = cli.parse_args(None)
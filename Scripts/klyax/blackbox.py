@@ -0,0 +1,168 @@
+"""
+Klyax blackbox dump decoder
+
+Mirrors Klyax-Firmware/src/Blackbox.hpp
+
+- Sector scanning
+- Delta + zigzag + varint record decoding
+- Session grouping
+"""
+
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass
+from dataclasses import field
+from typing import ClassVar
+from typing import Final
+from typing import Iterator
+from typing import MutableMapping
+from typing import MutableSequence
+from typing import Sequence
+from typing import final
+
+SECTOR_MAGIC: Final = 0x3142424B
+"""'KBB1'"""
+
+SECTOR_SIZE: Final = 4096
+
+END_OF_SECTOR: Final = 0xFF
+"""Erased length byte"""
+
+_GYRO: Final = 16.4
+_ACCEL: Final = 16.384
+_ANGLE: Final = 10000.0
+_RATE: Final = 1000.0
+_UNIT: Final = 10000.0
+
+FIELDS: Final[Sequence[tuple[str, float]]] = (
+    ("time_us", 1.0),
+    ("gyro_x_dps", _GYRO),
+    ("gyro_y_dps", _GYRO),
+    ("gyro_z_dps", _GYRO),
+    ("accel_x_mg", _ACCEL),
+    ("accel_y_mg", _ACCEL),
+    ("accel_z_mg", _ACCEL),
+    ("roll", _ANGLE),
+    ("pitch", _ANGLE),
+    ("yaw", _ANGLE),
+    ("roll_rate", _RATE),
+    ("pitch_rate", _RATE),
+    ("yaw_rate", _RATE),
+    ("control_roll", _UNIT),
+    ("control_pitch", _UNIT),
+    ("control_yaw", _UNIT),
+    ("control_thrust", _UNIT),
+    ("armed", 1.0),
+    ("pid_roll_p", _UNIT),
+    ("pid_roll_i", _UNIT),
+    ("pid_roll_d", _UNIT),
+    ("pid_pitch_p", _UNIT),
+    ("pid_pitch_i", _UNIT),
+    ("pid_pitch_d", _UNIT),
+    ("pid_yaw_p", _UNIT),
+    ("pid_yaw_i", _UNIT),
+    ("pid_yaw_d", _UNIT),
+    ("motor_back_left", _UNIT),
+    ("motor_back_right", _UNIT),
+    ("motor_front_right", _UNIT),
+    ("motor_front_left", _UNIT),
+)
+"""Column name and scale (raw value / scale = physical value), Blackbox::Field order"""
+
+
+@final
+@dataclass(kw_only=True)
+class Session:
+    """Recording from arm to disarm"""
+
+    number: int
+
+    columns: Sequence[MutableSequence[float]] = field(default_factory=lambda: tuple([] for _ in FIELDS))
+    """Values by Blackbox::Field"""
+
+    sectors: int = 0
+
+    @property
+    def records(self) -> int:
+        """Records in session"""
+        return len(self.columns[0])
+
+
+@final
+class BlackboxDecoder:
+    """Decodes raw 'blackbox' partition dump"""
+
+    _header: ClassVar = struct.Struct("<IHBBI")
+
+    def __init__(self) -> None:
+        self.sessions: Final[MutableMapping[int, Session]] = dict()
+        """Sessions by number"""
+
+        self.corrupted_sectors: int = 0
+
+    def decode(self, dump: bytes) -> Sequence[Session]:
+        """Decode the whole dump"""
+        for offset in range(0, len(dump) - SECTOR_SIZE + 1, SECTOR_SIZE):
+            if not self._decode_sector(dump[offset:offset + SECTOR_SIZE]):
+                break
+
+        return tuple(self.sessions[n] for n in sorted(self.sessions))
+
+    def _decode_sector(self, sector: bytes) -> bool:
+        magic, session_number, fields, _, _ = self._header.unpack_from(sector)
+
+        if magic != SECTOR_MAGIC:
+            return False
+
+        if fields != len(FIELDS):
+            self.corrupted_sectors += 1
+            return True
+
+        session = self.sessions.setdefault(session_number, Session(number=session_number))
+        session.sectors += 1
+
+        previous = [0] * len(FIELDS)
+
+        for values in _iter_records(sector, self._header.size, len(FIELDS)):
+            for i, delta in enumerate(values):
+                previous[i] += delta
+                session.columns[i].append(previous[i] / FIELDS[i][1])
+
+        return True
+
+
+def _iter_records(sector: bytes, offset: int, fields: int) -> Iterator[Sequence[int]]:
+    while offset < len(sector) and sector[offset] != END_OF_SECTOR:
+        length = sector[offset]
+        end = offset + 1 + length
+
+        if end > len(sector):
+            return
+
+        values = _decode_varints(sector[offset + 1:end])
+
+        if len(values) != fields:
+            return
+
+        yield values
+        offset = end
+
+
+def _decode_varints(data: bytes) -> Sequence[int]:
+    values = list()
+    value = 0
+    shift = 0
+
+    for b in data:
+        value |= (b & 0x7F) << shift
+        shift += 7
+
+        if b & 0x80:
+            continue
+
+        values.append((value >> 1) ^ -(value & 1))
+        value = 0
+        shift = 0
+
+    return values
@@ -8,6 +8,7 @@ Klyax CLI
 
 from __future__ import annotations
 
+import csv
 import sys
 from abc import ABC
 from abc import abstractmethod
@@ -24,11 +25,19 @@ from typing import Optional
 from typing import Sequence
 from typing import final
 
+from klyax.blackbox import BlackboxDecoder
+from klyax.blackbox import FIELDS
+from klyax.elf import ElfFile
+from klyax.log import LogDecoder
+from klyax.log import load_sites
 from klyax.models import AssemblyUnitModel
 from klyax.models import Model
 from klyax.models import ModelRegistry
 from klyax.models import PartModel
 from klyax.project import Project
+from klyax.telemetry import Sample
+from klyax.telemetry import TelemetryDecoder
+from klyax.telemetry import read_payloads
 
 
 @dataclass(kw_only=True)
@@ -333,3 +342,355 @@ class UpdateReadmeCommandRunner(CommandRunner):
 
     def run(self) -> None:
         pass
+
+
+@final
+@dataclass(kw_only=True)
+class TelemetryCommandRunner(CommandRunner):
+    """Decodes binary telemetry stream into CSV"""
+
+    source: str
+    """Bridge-framed payload file or serial port"""
+
+    output: Path
+    """CSV output file"""
+
+    baudrate: int
+    """Serial port baudrate"""
+
+    @classmethod
+    def name(cls) -> str:
+        return "telemetry"
+
+    @classmethod
+    def configure_parser(cls, p: ArgumentParser) -> None:
+        p.add_argument(
+            "source",
+            help="File or serial port (requires pyserial) with bridge-framed payloads: u8 length + ESP-NOW payload"
+        )
+
+        p.add_argument(
+            "-o", "--output",
+            type=Path,
+            default=Path("telemetry.csv"),
+            help="CSV output file"
+        )
+
+        p.add_argument(
+            "-b", "--baudrate",
+            type=int,
+            default=921600,
+            help="Serial port baudrate"
+        )
+
+    @classmethod
+    def create(cls, args: Namespace) -> CommandRunner:
+        return cls(
+            source=args.source,
+            output=args.output,
+            baudrate=args.baudrate,
+        )
+
+    def run(self) -> None:
+        decoder = TelemetryDecoder()
+        samples = 0
+
+        with self._open_source() as stream, self.output.open("w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(Sample.csv_header())
+
+            try:
+                for payload in read_payloads(stream):
+                    for sample in decoder.decode(payload):
+                        writer.writerow(sample.csv_row())
+                        samples += 1
+
+            except KeyboardInterrupt:
+                pass
+
+        self.log_info(f"{samples=} -> {self.output}")
+        self.log_info(f"{decoder.sequence.lost=} {decoder.sequence.stale=} {decoder.frames_rejected=} {decoder.messages_skipped=}")
+
+    def _open_source(self):
+        path = Path(self.source)
+
+        if path.is_file():
+            return path.open("rb")
+
+        import serial
+
+        return serial.Serial(self.source, self.baudrate)
+
+
+@final
+@dataclass(kw_only=True)
+class BlackboxCommandRunner(CommandRunner):
+    """Extracts blackbox partition dump into per-session columnar CSV files"""
+
+    dump: Path
+    """Raw partition dump"""
+
+    output: Path
+    """Output folder"""
+
+    @classmethod
+    def name(cls) -> str:
+        return "blackbox"
+
+    @classmethod
+    def configure_parser(cls, p: ArgumentParser) -> None:
+        p.add_argument(
+            "dump",
+            type=Path,
+            help="Raw 'blackbox' partition dump (esptool.py read_flash 0x1F0000 0x200000 dump.bin)"
+        )
+
+        p.add_argument(
+            "-o", "--output",
+            type=Path,
+            default=Path("blackbox"),
+            help="Output folder"
+        )
+
+    @classmethod
+    def create(cls, args: Namespace) -> CommandRunner:
+        return cls(
+            dump=args.dump,
+            output=args.output,
+        )
+
+    def run(self) -> None:
+        decoder = BlackboxDecoder()
+        sessions = decoder.decode(self.dump.read_bytes())
+
+        if len(sessions) == 0:
+            self.log_info(f"No sessions in {self.dump}")
+            return
+
+        self.output.mkdir(parents=True, exist_ok=True)
+
+        for session in sessions:
+            path = self.output / f"session-{session.number:03}.csv"
+
+            with path.open("w", newline="") as f:
+                writer = csv.writer(f)
+                writer.writerow(name for name, _ in FIELDS)
+                writer.writerows(zip(*session.columns))
+
+            self.log_info(f"{session.number=} {session.records=} {session.sectors=} -> {path}")
+
+        if decoder.corrupted_sectors > 0:
+            self.log_error(f"{decoder.corrupted_sectors=}")
+
+
+@final
+@dataclass(kw_only=True)
+class LogCommandRunner(CommandRunner):
+    """Formats binary log (KLYAX_LOG_BINARY) using the call site table from firmware ELF"""
+
+    elf: Path
+    """Firmware ELF with symbols"""
+
+    source: str
+    """Captured serial output file or serial port"""
+
+    baudrate: int
+    """Serial port baudrate"""
+
+    @classmethod
+    def name(cls) -> str:
+        return "log"
+
+    @classmethod
+    def configure_parser(cls, p: ArgumentParser) -> None:
+        p.add_argument(
+            "elf",
+            type=Path,
+            help="Firmware ELF of the same build (.pio/build/mhetesp32minikit/firmware.elf)"
+        )
+
+        p.add_argument(
+            "source",
+            help="Captured serial output file or serial port (requires pyserial)"
+        )
+
+        p.add_argument(
+            "-b", "--baudrate",
+            type=int,
+            default=115200,
+            help="Serial port baudrate"
+        )
+
+    @classmethod
+    def create(cls, args: Namespace) -> CommandRunner:
+        return cls(
+            elf=args.elf,
+            source=args.source,
+            baudrate=args.baudrate,
+        )
+
+    def run(self) -> None:
+        sites = load_sites(ElfFile.load(self.elf))
+        self.log_info(f"{len(sites)=}")
+
+        decoder = LogDecoder(sites)
+
+        with self._open_source() as stream:
+            try:
+                while True:
+                    # Serial: all pending bytes, at least one (blocking)
+                    data = stream.read(getattr(stream, "in_waiting", 4096) or 1)
+
+                    if len(data) == 0:
+                        break
+
+                    for item in decoder.feed(data):
+                        sys.stdout.write(item if isinstance(item, str) else f"{item}\n")
+
+                    sys.stdout.flush()
+
+            except KeyboardInterrupt:
+                pass
+
+        if decoder.unknown_ids > 0:
+            self.log_error(f"{decoder.unknown_ids=}: ELF does not match firmware")
+
+    def _open_source(self):
+        path = Path(self.source)
+
+        if path.is_file():
+            return path.open("rb")
+
+        import serial
+
+        return serial.Serial(self.source, self.baudrate)
+
+
+@final
+@dataclass(kw_only=True)
+class ThrustCommandRunner(CommandRunner):
+    """Sends a bench-measured thrust curve to the firmware (serial command thrust-lut)"""
+
+    samples: Path
+    """CSV with columns duty, thrust"""
+
+    voltage: float
+    """Supply voltage during the measurement (V)"""
+
+    points: int
+    """Uniform duty grid size sent to the firmware"""
+
+    port: Optional[str]
+    """Serial port, None - print the command"""
+
+    baudrate: int
+    """Serial port baudrate"""
+
+    POINTS_MAX: ClassVar[int] = 65
+    """Firmware limit (runSerialCommand in main.cpp)"""
+
+    @classmethod
+    def name(cls) -> str:
+        return "thrust"
+
+    @classmethod
+    def configure_parser(cls, p: ArgumentParser) -> None:
+        p.add_argument(
+            "samples",
+            type=Path,
+            help="CSV with header and columns duty [0.0 .. 1.0], thrust (any unit, non-decreasing)"
+        )
+
+        p.add_argument(
+            "-v", "--voltage",
+            type=float,
+            required=True,
+            help="Supply voltage during the measurement (V)"
+        )
+
+        p.add_argument(
+            "-n", "--points",
+            type=int,
+            default=33,
+            help=f"Uniform duty grid size [2 .. {cls.POINTS_MAX}]"
+        )
+
+        p.add_argument(
+            "-p", "--port",
+            default=None,
+            help="Serial port of the drone (requires pyserial), without it the command is printed"
+        )
+
+        p.add_argument(
+            "-b", "--baudrate",
+            type=int,
+            default=115200,
+            help="Serial port baudrate"
+        )
+
+    @classmethod
+    def create(cls, args: Namespace) -> CommandRunner:
+        return cls(
+            samples=args.samples,
+            voltage=args.voltage,
+            points=args.points,
+            port=args.port,
+            baudrate=args.baudrate,
+        )
+
+    def run(self) -> None:
+        if not 2 <= self.points <= self.POINTS_MAX:
+            raise ValueError(f"points must be 2 .. {self.POINTS_MAX}")
+
+        if self.voltage <= 0:
+            raise ValueError("voltage must be positive")
+
+        thrust = self._resample(self._load())
+        command = f"thrust-lut {self.voltage:.3f} " + " ".join(f"{t:.5g}" for t in thrust) + "\n"
+
+        if self.port is None:
+            sys.stdout.write(command)
+            return
+
+        import serial
+
+        with serial.Serial(self.port, self.baudrate) as port:
+            port.write(command.encode("ascii"))
+
+        self.log_info(f"{len(thrust)=} -> {self.port}: applied by the firmware when disarmed")
+
+    def _load(self) -> list[tuple[float, float]]:
+        with self.samples.open(newline="") as f:
+            rows = [(float(row["duty"]), float(row["thrust"])) for row in csv.DictReader(f)]
+
+        rows.sort()
+
+        # No PWM - no thrust
+        if len(rows) == 0 or rows[0][0] > 0:
+            rows.insert(0, (0.0, 0.0))
+
+        if rows[-1][0] < 1.0:
+            raise ValueError(f"{self.samples}: measurement must reach duty 1.0, got {rows[-1][0]}")
+
+        for (_, t0), (_, t1) in zip(rows, rows[1:]):
+            if t1 < t0:
+                raise ValueError(f"{self.samples}: thrust must not decrease with duty")
+
+        return rows
+
+    def _resample(self, rows: Sequence[tuple[float, float]]) -> list[float]:
+        """Thrust at duty k / (points - 1), linear interpolation"""
+        thrust = []
+        j = 1
+
+        for k in range(self.points):
+            duty = k / (self.points - 1)
+
+            while j < len(rows) - 1 and rows[j][0] < duty:
+                j += 1
+
+            (d0, t0), (d1, t1) = rows[j - 1], rows[j]
+            f = (duty - d0) / (d1 - d0) if d1 > d0 else 0.0
+            thrust.append(t0 + (t1 - t0) * min(max(f, 0.0), 1.0))
+
+        return thrust
@@ -0,0 +1,121 @@
+"""
+Minimal ELF reader
+
+- Section headers
+- Symbol table (.symtab)
+- Reading bytes at a virtual address
+"""
+
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Final
+from typing import Iterator
+from typing import Sequence
+from typing import final
+
+_SHT_SYMTAB: Final = 2
+_SHT_NOBITS: Final = 8
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Section:
+    name: str
+    type: int
+    address: int
+    offset: int
+    size: int
+    link: int
+    entry_size: int
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Symbol:
+    name: str
+    """Mangled name"""
+
+    address: int
+    size: int
+
+
+@final
+class ElfFile:
+    """ELF32 / ELF64 file with symbol table"""
+
+    def __init__(self, data: bytes) -> None:
+        if data[:4] != b"\x7fELF":
+            raise ValueError("Not an ELF file")
+
+        self._data: Final = data
+        self._is_64: Final = data[4] == 2
+        self._endian: Final = "<" if data[5] == 1 else ">"
+        self.sections: Final = self._read_sections()
+
+    @classmethod
+    def load(cls, path: Path) -> ElfFile:
+        return cls(path.read_bytes())
+
+    def symbols(self) -> Iterator[Symbol]:
+        for section in self.sections:
+            if section.type != _SHT_SYMTAB:
+                continue
+
+            strtab = self.sections[section.link]
+
+            for offset in range(section.offset, section.offset + section.size, section.entry_size):
+                if self._is_64:
+                    name, _, _, _, address, size = struct.unpack_from(self._endian + "IBBHQQ", self._data, offset)
+                else:
+                    name, address, size, _, _, _ = struct.unpack_from(self._endian + "IIIBBH", self._data, offset)
+
+                yield Symbol(name=self._string(strtab.offset + name), address=address, size=size)
+
+    def read(self, address: int, size: int) -> bytes:
+        """Bytes at virtual address from an allocated section with file contents"""
+        for section in self.sections:
+            if section.type == _SHT_NOBITS or section.address == 0:
+                continue
+
+            if section.address <= address and address + size <= section.address + section.size:
+                start = section.offset + address - section.address
+                return self._data[start:start + size]
+
+        raise ValueError(f"Address {address:#x} is not in the file")
+
+    def _read_sections(self) -> Sequence[Section]:
+        if self._is_64:
+            offset, = struct.unpack_from(self._endian + "Q", self._data, 0x28)
+            entry_size, count, names_index = struct.unpack_from(self._endian + "HHH", self._data, 0x3A)
+            entry_format = self._endian + "IIQQQQIIQQ"
+        else:
+            offset, = struct.unpack_from(self._endian + "I", self._data, 0x20)
+            entry_size, count, names_index = struct.unpack_from(self._endian + "HHH", self._data, 0x2E)
+            entry_format = self._endian + "IIIIIIIIII"
+
+        raw = [
+            struct.unpack_from(entry_format, self._data, offset + i * entry_size)
+            for i in range(count)
+        ]
+
+        names_offset = raw[names_index][4] if raw else 0
+
+        return tuple(
+            Section(
+                name=self._string(names_offset + name),
+                type=kind,
+                address=address,
+                offset=file_offset,
+                size=size,
+                link=link,
+                entry_size=symbol_size,
+            )
+            for name, kind, _, address, file_offset, size, link, _, _, symbol_size in raw
+        )
+
+    def _string(self, offset: int) -> str:
+        end = self._data.index(b"\0", offset)
+        return self._data[offset:end].decode("ascii", errors="replace")
@@ -0,0 +1,206 @@
+"""
+Klyax binary log decoder
+
+Mirrors Klyax-Firmware/src/tools/Logger.hpp (KLYAX_LOG_BINARY)
+
+- Call site table from firmware ELF symbols (klyax_log_site)
+- Frame stream decoding and printf-style formatting on the host
+"""
+
+from __future__ import annotations
+
+import codecs
+import re
+import struct
+from dataclasses import dataclass
+from typing import Final
+from typing import Iterator
+from typing import Mapping
+from typing import Optional
+from typing import Sequence
+from typing import final
+
+from klyax.elf import ElfFile
+
+FRAME_MARKER: Final = 0xB1
+"""First byte of a binary log frame, only at a line start: 0xB1 is also a UTF-8 continuation byte ("б" = D0 B1)"""
+
+SITE_SYMBOL: Final = "14klyax_log_site"
+"""Part of the mangled name of every call site"""
+
+ANCHOR_SYMBOL: Final = "Logger9id_anchor"
+"""Part of the mangled name of the ID anchor"""
+
+LEVELS: Final = ("Debug", "Info", "Warn", "Error", "Fatal")
+
+_SITE_HEADER: Final = struct.Struct("<BBH")
+_FRAME_HEADER: Final = struct.Struct("<Ii")
+
+_CONVERSION: Final = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t|L)?([diuxXoeEfFgGcsp%])")
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Site:
+    """Logger call site"""
+
+    level: int
+    line: int
+    format: str
+    """Python %-format converted from printf format"""
+
+    function: str
+
+    @property
+    def level_name(self) -> str:
+        return LEVELS[self.level] if self.level < len(LEVELS) else str(self.level)
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Message:
+    timestamp_us: int
+    site: Optional[Site]
+    """None for unknown ID (firmware and ELF mismatch)"""
+
+    id: int
+    args: Sequence[object]
+
+    def __str__(self) -> str:
+        if self.site is None:
+            return f"[{self.timestamp_us // 1000}|?|id {self.id}] {self.args}"
+
+        try:
+            text = self.site.format % tuple(self.args)
+
+        except (TypeError, ValueError):
+            text = f"{self.site.format!r} % {self.args}"
+
+        return f"[{self.timestamp_us // 1000}|{self.site.level_name}|{self.site.function}] {text}"
+
+
+def load_sites(elf: ElfFile) -> Mapping[int, Site]:
+    """Call site table: ID (offset from Logger::id_anchor) -> Site"""
+    symbols = tuple(elf.symbols())
+
+    anchor = next((s for s in symbols if ANCHOR_SYMBOL in s.name), None)
+
+    if anchor is None:
+        raise ValueError("Logger::id_anchor not found: firmware built without KLYAX_LOG_BINARY?")
+
+    sites = dict()
+
+    for symbol in symbols:
+        if SITE_SYMBOL not in symbol.name or symbol.size <= _SITE_HEADER.size:
+            continue
+
+        data = elf.read(symbol.address, symbol.size)
+        level, _, line = _SITE_HEADER.unpack_from(data)
+        format_text, function, *_ = data[_SITE_HEADER.size:].split(b"\0")
+
+        sites[symbol.address - anchor.address] = Site(
+            level=level,
+            line=line,
+            format=_to_python_format(format_text.decode("utf-8", errors="replace")),
+            function=function.decode("utf-8", errors="replace"),
+        )
+
+    return sites
+
+
+@final
+class LogDecoder:
+    """Splits byte stream into binary frames, other bytes are passed as text
+
+    A frame starts only at a line start: stream start, after a newline or right after another frame.
+    Inside a text line 0xB1 is text (Cyrillic UTF-8), the line runs up to its newline.
+    """
+
+    def __init__(self, sites: Mapping[int, Site]) -> None:
+        self._sites: Final = sites
+        self._buffer = bytearray()
+        self._line_start = True
+        self._text: Final = codecs.getincrementaldecoder("utf-8")(errors="replace")
+        self.unknown_ids = 0
+
+    def feed(self, data: bytes) -> Iterator[Message | str]:
+        self._buffer.extend(data)
+
+        while len(self._buffer) > 0:
+            if not self._line_start or self._buffer[0] != FRAME_MARKER:
+                newline = self._buffer.find(b"\n")
+                end = len(self._buffer) if newline < 0 else newline + 1
+                self._line_start = newline >= 0
+
+                text = self._text.decode(bytes(self._buffer[:end]))
+                del self._buffer[:end]
+
+                if len(text) > 0:
+                    yield text
+
+                continue
+
+            if len(self._buffer) < 2 or len(self._buffer) < 2 + self._buffer[1]:
+                return
+
+            length = self._buffer[1]
+            body = bytes(self._buffer[2:2 + length])
+            del self._buffer[:2 + length]
+
+            if length < _FRAME_HEADER.size:
+                continue
+
+            timestamp_us, site_id = _FRAME_HEADER.unpack_from(body)
+            site = self._sites.get(site_id)
+
+            if site is None:
+                self.unknown_ids += 1
+
+            yield Message(timestamp_us=timestamp_us, site=site, id=site_id, args=_parse_args(body[_FRAME_HEADER.size:]))
+
+
+def _parse_args(data: bytes) -> Sequence[object]:
+    args = list()
+    pos = 0
+
+    while pos < len(data):
+        tag = chr(data[pos])
+        pos += 1
+
+        if tag == "i":
+            args.extend(struct.unpack_from("<i", data, pos))
+            pos += 4
+        elif tag == "u":
+            args.extend(struct.unpack_from("<I", data, pos))
+            pos += 4
+        elif tag == "l":
+            args.extend(struct.unpack_from("<q", data, pos))
+            pos += 8
+        elif tag == "L":
+            args.extend(struct.unpack_from("<Q", data, pos))
+            pos += 8
+        elif tag == "f":
+            args.extend(struct.unpack_from("<f", data, pos))
+            pos += 4
+        elif tag == "s":
+            length = data[pos]
+            args.append(data[pos + 1:pos + 1 + length].decode("utf-8", errors="replace"))
+            pos += 1 + length
+        else:
+            break
+
+    return args
+
+
+def _to_python_format(printf_format: str) -> str:
+    def convert(match: re.Match) -> str:
+        flags, conversion = match.groups()
+
+        if conversion == "u":
+            conversion = "d"
+        elif conversion == "p":
+            conversion = "x"
+
+        return f"%{flags}{conversion}"
+
+    return _CONVERSION.sub(convert, printf_format.rstrip("\n"))
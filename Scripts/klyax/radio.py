@@ -0,0 +1,149 @@
+"""
+Klyax ESP-NOW wire format
+
+Mirrors Klyax-Firmware/lib/Telemetry/src/Radio.hpp
+
+- Frame: header (version, message count, sequence, timestamp), messages [type, size, payload], CRC-16/CCITT-FALSE
+- Sequence tracking: lost and stale (reordered or repeated) frames
+"""
+
+from __future__ import annotations
+
+import binascii
+import struct
+from dataclasses import dataclass
+from enum import IntEnum
+from enum import unique
+from typing import ClassVar
+from typing import Final
+from typing import Optional
+from typing import Sequence
+from typing import final
+
+VERSION: Final = 1
+"""Incremented on any incompatible format change"""
+
+MAX_PAYLOAD_SIZE: Final = 250
+"""ESP-NOW payload limit (bytes)"""
+
+
+@unique
+class MessageType(IntEnum):
+    CONTROL = 0
+    MENU = 1
+    TUI_PAGE = 2
+    TELEMETRY = 3
+
+
+@unique
+class Status(IntEnum):
+    OK = 0
+    SIZE = 1
+    VERSION = 2
+    CRC = 3
+    LAYOUT = 4
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Header:
+    version: int
+
+    sequence: int
+    """Sender frame number"""
+
+    timestamp_us: int
+    """Sender clock"""
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Message:
+    type: int
+    """MessageType value, unknown types are kept as is"""
+
+    payload: bytes
+
+
+@final
+class FrameParser:
+    """Validates frames and splits them into messages"""
+
+    _header: ClassVar = struct.Struct("<BBHI")
+    _message: ClassVar = struct.Struct("<BB")
+    _crc: ClassVar = struct.Struct("<H")
+
+    @classmethod
+    def parse(cls, payload: bytes) -> tuple[Status, Optional[Header], Sequence[Message]]:
+        """Messages are returned only from a fully valid frame"""
+        if not cls._header.size + cls._crc.size <= len(payload) <= MAX_PAYLOAD_SIZE:
+            return Status.SIZE, None, ()
+
+        version, count, sequence, timestamp_us = cls._header.unpack_from(payload)
+
+        if version != VERSION:
+            return Status.VERSION, None, ()
+
+        end = len(payload) - cls._crc.size
+        crc, = cls._crc.unpack_from(payload, end)
+
+        if crc != binascii.crc_hqx(payload[:end], 0xFFFF):
+            return Status.CRC, None, ()
+
+        messages = []
+        cursor = cls._header.size
+
+        for _ in range(count):
+            if cursor + cls._message.size > end:
+                return Status.LAYOUT, None, ()
+
+            message_type, size = cls._message.unpack_from(payload, cursor)
+            cursor += cls._message.size
+            messages.append(Message(type=message_type, payload=payload[cursor:cursor + size]))
+            cursor += size
+
+        if cursor != end:
+            return Status.LAYOUT, None, ()
+
+        return Status.OK, Header(version=version, sequence=sequence, timestamp_us=timestamp_us), tuple(messages)
+
+
+@final
+class SequenceTracker:
+    """Frame numbers of one sender (same rules as radio::SequenceTracker)"""
+
+    restart_after: ClassVar = 8
+    """Stale numbers in a row treated as a sender restart"""
+
+    def __init__(self) -> None:
+        self.last: Optional[int] = None
+
+        self.lost: int = 0
+        """Gaps in frame numbers"""
+
+        self.stale: int = 0
+        """Repeated or older than already accepted"""
+
+        self._stale_in_row: int = 0
+
+    def accept(self, sequence: int) -> bool:
+        """False - stale frame"""
+        if self.last is None:
+            self.last = sequence
+            return True
+
+        delta = (sequence - self.last) & 0xFFFF
+
+        if delta == 0 or delta >= 0x8000:
+            self.stale += 1
+            self._stale_in_row += 1
+
+            if self._stale_in_row < self.restart_after:
+                return False
+
+            delta = 1
+
+        self._stale_in_row = 0
+        self.lost += delta - 1
+        self.last = sequence
+        return True
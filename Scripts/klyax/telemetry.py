@@ -0,0 +1,163 @@
+"""
+Klyax binary telemetry decoder
+
+Mirrors Klyax-Firmware/lib/Telemetry/src/Telemetry.hpp
+
+- Payload stream reader (bridge framing: u8 length + ESP-NOW payload)
+- Telemetry message decoding from radio frames (klyax.radio)
+"""
+
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass
+from typing import BinaryIO
+from typing import ClassVar
+from typing import Final
+from typing import Iterator
+from typing import Sequence
+from typing import final
+
+from klyax.radio import FrameParser
+from klyax.radio import MessageType
+from klyax.radio import SequenceTracker
+from klyax.radio import Status
+
+AXES: Final = ("roll", "pitch", "yaw")
+TERMS: Final = ("p", "i", "d")
+MOTORS: Final = ("back_left", "back_right", "front_right", "front_left")
+
+
+@final
+@dataclass(frozen=True, kw_only=True)
+class Sample:
+    """Telemetry sample in physical units"""
+
+    sequence: int
+    """Radio frame sequence number"""
+
+    timestamp_us: int
+
+    orientation: Sequence[float]
+    """Roll, Pitch, Yaw (rad)"""
+
+    rates: Sequence[float]
+    """Roll, Pitch, Yaw rates (rad/s)"""
+
+    motors: Sequence[float]
+    """Motor commands [0.0 .. 1.0] in DroneFrameDriver::MotorIndex order"""
+
+    pid: Sequence[Sequence[float]]
+    """[axis][P, I, D] rate PID terms"""
+
+    period_us: int
+    busy_us: int
+
+    battery: float
+    """Battery voltage (V), 0 when not connected"""
+
+    @classmethod
+    def csv_header(cls) -> Sequence[str]:
+        """Column names matching `csv_row`"""
+        return (
+            "sequence",
+            "timestamp_us",
+            *(f"{a}" for a in AXES),
+            *(f"{a}_rate" for a in AXES),
+            *(f"motor_{m}" for m in MOTORS),
+            *(f"pid_{a}_{t}" for a in AXES for t in TERMS),
+            "period_us",
+            "busy_us",
+            "battery_v",
+        )
+
+    def csv_row(self) -> Sequence[object]:
+        """Values matching `csv_header`"""
+        return (
+            self.sequence,
+            self.timestamp_us,
+            *self.orientation,
+            *self.rates,
+            *self.motors,
+            *(term for axis in self.pid for term in axis),
+            self.period_us,
+            self.busy_us,
+            self.battery,
+        )
+
+
+@final
+class TelemetryDecoder:
+    """Decodes telemetry messages from ESP-NOW payloads"""
+
+    _frame: ClassVar = struct.Struct("<I3h3h4H9hHHH")
+
+    _orientation_scale: ClassVar = 10000.0
+    _rate_scale: ClassVar = 500.0
+    _motor_scale: ClassVar = 65535.0
+    _pid_term_scale: ClassVar = 10000.0
+    _battery_scale: ClassVar = 1000.0
+
+    def __init__(self) -> None:
+        self.sequence = SequenceTracker()
+        """Frame numbers of the drone: lost and stale frames"""
+
+        self.frames_rejected: int = 0
+        """Payloads that failed validation (size, version, CRC, layout)"""
+
+        self.messages_skipped: int = 0
+        """Messages that are not telemetry (e.g. TUI pages)"""
+
+    def decode(self, payload: bytes) -> Sequence[Sample]:
+        """Decode one payload. Invalid payloads and other messages yield nothing"""
+        status, header, messages = FrameParser.parse(payload)
+
+        if status != Status.OK:
+            self.frames_rejected += 1
+            return ()
+
+        self.sequence.accept(header.sequence)
+        samples = []
+
+        for message in messages:
+            if message.type != MessageType.TELEMETRY or len(message.payload) != self._frame.size:
+                self.messages_skipped += 1
+                continue
+
+            samples.append(self._decode_frame(header.sequence, message.payload, 0))
+
+        return tuple(samples)
+
+    def _decode_frame(self, sequence: int, payload: bytes, offset: int) -> Sample:
+        v = self._frame.unpack_from(payload, offset)
+
+        return Sample(
+            sequence=sequence,
+            timestamp_us=v[0],
+            orientation=tuple(x / self._orientation_scale for x in v[1:4]),
+            rates=tuple(x / self._rate_scale for x in v[4:7]),
+            motors=tuple(x / self._motor_scale for x in v[7:11]),
+            pid=tuple(
+                tuple(x / self._pid_term_scale for x in v[11 + a * 3:14 + a * 3])
+                for a in range(len(AXES))
+            ),
+            period_us=v[20],
+            busy_us=v[21],
+            battery=v[22] / self._battery_scale,
+        )
+
+
+def read_payloads(stream: BinaryIO) -> Iterator[bytes]:
+    """Read bridge-framed payloads (u8 length + payload) until end of stream"""
+    while True:
+        length = stream.read(1)
+
+        if len(length) == 0:
+            return
+
+        payload = stream.read(length[0])
+
+        if len(payload) < length[0]:
+            return
+
+        yield payload